@@ -81,6 +81,25 @@ AC_DEFUN(gedcom_LIBICONV_HAS_ANSEL, [
   ])
 ])
 
+dnl gedcom_THREAD_LOCAL()
+dnl Checks whether the compiler supports thread-local variables
+dnl THREAD_LOCAL is set to the storage class for them (empty if none)
+AC_DEFUN(gedcom_THREAD_LOCAL, [
+  AC_CACHE_CHECK(for thread-local storage, ac_cv_thread_local, [
+    AC_TRY_COMPILE([
+static __thread int tls_var = 0;
+], [ tls_var++; ],
+      ac_cv_thread_local=yes, ac_cv_thread_local=no)
+  ])
+  if test "$ac_cv_thread_local" = yes; then
+    AC_DEFINE_UNQUOTED(THREAD_LOCAL, __thread,
+                       [Storage class for thread-local variables])
+  else
+    AC_DEFINE_UNQUOTED(THREAD_LOCAL, ,
+                       [Storage class for thread-local variables])
+  fi
+])
+
 dnl gedcom_SYS_NEWLINE()
 dnl Checks how newline is written on the system
 dnl SYS_NEWLINE is set to one of the following:
@@ -29,17 +29,13 @@
 #include "gedcom_internal.h"
 #include "buffer.h"
 #include "age.h"
+#include "parser.h"
 
-struct age_value age_s;
-struct age_value def_age_val;
+struct age_value def_age_val = { AGE_UNRECOGNIZED, AGE_NO_MODIFIER,
+				 -1, -1, -1, "" };
 
-void cleanup_age_buffer();
-struct safe_buffer age_buffer = { NULL, 0, NULL, 0, cleanup_age_buffer };
-
-void cleanup_age_buffer()
-{
-  cleanup_buffer(&age_buffer);
-}
+#define age_s      (PARSER->age_s)
+#define age_buffer (PARSER->age_buffer)
 
 void copy_age(struct age_value *to, struct age_value from)
 {
@@ -139,7 +135,6 @@ struct age_value gedcom_parse_age(const char* line_value)
 {
   const char *ptr = line_value;
   init_age(&age_s);
-  init_age(&def_age_val);
 
   if (*ptr == '<') {
     age_s.mod = AGE_LESS_THAN;
@@ -186,9 +181,9 @@ char* gedcom_age_to_string(const struct age_value* val)
 
   switch (val->mod) {
     case AGE_LESS_THAN:
-      safe_buf_append(&age_buffer, "<"); break;
+      safe_buf_addstr(&age_buffer, "<"); break;
     case AGE_GREATER_THAN:
-      safe_buf_append(&age_buffer, ">"); break;
+      safe_buf_addstr(&age_buffer, ">"); break;
     default:
       break;
   }
@@ -196,13 +191,13 @@ char* gedcom_age_to_string(const struct age_value* val)
   switch (val->type) {
     case AGE_UNRECOGNIZED:
       reset_buffer(&age_buffer);
-      safe_buf_append(&age_buffer, val->phrase); break;
+      safe_buf_addstr(&age_buffer, val->phrase); break;
     case AGE_CHILD:
-      safe_buf_append(&age_buffer, "CHILD"); break;
+      safe_buf_addstr(&age_buffer, "CHILD"); break;
     case AGE_INFANT:
-      safe_buf_append(&age_buffer, "INFANT"); break;
+      safe_buf_addstr(&age_buffer, "INFANT"); break;
     case AGE_STILLBORN:
-      safe_buf_append(&age_buffer, "STILLBORN"); break;
+      safe_buf_addstr(&age_buffer, "STILLBORN"); break;
     case AGE_NUMERIC:
       if (val->years != -1) {
 	num = 1;
@@ -210,13 +205,13 @@ char* gedcom_age_to_string(const struct age_value* val)
       }
       if (val->months != -1) {
 	if (num)
-	  safe_buf_append(&age_buffer, " ");
+	  safe_buf_addstr(&age_buffer, " ");
 	num = 1;
 	safe_buf_append(&age_buffer, "%dm", val->months);
       }
       if (val->days != -1) {
 	if (num)
-	  safe_buf_append(&age_buffer, " ");
+	  safe_buf_addstr(&age_buffer, " ");
 	num = 1;
 	safe_buf_append(&age_buffer, "%dd", val->days);
       }
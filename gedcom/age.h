@@ -28,8 +28,6 @@
 #include "gedcom_internal.h"
 #include "gedcom.h"
 
-extern struct age_value age_s;
-
 void copy_age(struct age_value *to, struct age_value from);
 
 #define GEDCOM_MAKE_AGE(VAR, AGE) \
@@ -0,0 +1,253 @@
+/* Batched delivery of records.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#include "gedcom_internal.h"
+#include "gedcom.h"
+#include "parser.h"
+#include "batch.h"
+#include "parallel.h"
+
+/* While a record is parsed for a batch callback, its lines are collected
+   here: the lines and their values in two arrays, and the strings in a
+   chain of blocks.  Nothing is freed between records: the arrays and the
+   blocks are reused for the next record, so that after the first few
+   records a batch costs no allocations at all.  The blocks never move, so
+   the strings stay valid while the arrays grow.
+*/
+
+#define BATCH_INITIAL_LINES  64
+#define BATCH_BLOCK_SIZE     16384
+
+struct batch_block {
+  struct batch_block* next;
+  size_t              size;
+  char                data[1];
+};
+
+struct batch {
+  Gedcom_rec          rec;
+  int                 failed;
+  struct batch_line*  lines;
+  Gedcom_val_struct*  values;
+  int                 nr_of_lines;
+  int                 max_lines;
+  struct batch_block* blocks;
+  struct batch_block* current;    /* the block that is being filled */
+  size_t              used;       /* the used part of the current block */
+};
+
+/** This function allows to subscribe to complete records of a certain
+    type: when such a record is parsed, the callback gets all its lines at
+    once, in the order of the file.  This is an alternative to the start
+    and end callbacks of the record and its elements, which costs one call
+    per record instead of two calls per line.  The callbacks of
+    \ref gedcom_subscribe_to_record() and
+    \ref gedcom_subscribe_to_element() are still called for the record and
+    its elements, before the batch callback.
+
+    The lines, and everything they point to, are only valid during the
+    callback: the buffers are reused for the next record.
+    
+    You can only register once for a given record type.
+    \param rec The record to subscribe to (see the
+    <a href="interface.html#Record_identifiers">interface details</a>)
+    \param cb The batch callback, or \c NULL to unsubscribe
+ */
+void gedcom_subscribe_to_record_batch(Gedcom_rec rec, Gedcom_rec_batch_cb cb)
+{
+  if (cb && PARSER->record_batch_callback[rec])
+    gedcom_error(_("Internal error: Duplicate registration for record type %d"), rec);
+  PARSER->record_batch_callback[rec] = cb;
+}
+
+static char* batch_strdup(struct batch* b, const char* str)
+{
+  size_t len;
+  char* copy;
+
+  if (!str)
+    return NULL;
+  len = strlen(str) + 1;
+  while (!b->current || b->used + len > b->current->size) {
+    if (b->current && b->current->next) {
+      /* A block from a previous record */
+      b->current = b->current->next;
+    }
+    else {
+      size_t size = (len > BATCH_BLOCK_SIZE ? len : BATCH_BLOCK_SIZE);
+      struct batch_block* block
+	= (struct batch_block*)malloc(sizeof(struct batch_block) + size);
+      if (!block) {
+	MEMORY_ERROR;
+	b->failed = 1;
+	return NULL;
+      }
+      block->size = size;
+      block->next = NULL;
+      if (b->current)
+	b->current->next = block;
+      else
+	b->blocks = block;
+      b->current = block;
+    }
+    b->used = 0;
+  }
+  copy = b->current->data + b->used;
+  memcpy(copy, str, len);
+  b->used += len;
+  return copy;
+}
+
+static int grow_lines(struct batch* b)
+{
+  int new_max = (b->max_lines ? b->max_lines * 2 : BATCH_INITIAL_LINES);
+  struct batch_line* new_lines;
+  Gedcom_val_struct* new_values;
+
+  new_lines = (struct batch_line*)realloc(b->lines,
+					  new_max * sizeof(struct batch_line));
+  if (!new_lines)
+    return 0;
+  b->lines = new_lines;
+  new_values = (Gedcom_val_struct*)realloc(b->values,
+					   new_max * sizeof(Gedcom_val_struct));
+  if (!new_values)
+    return 0;
+  b->values    = new_values;
+  b->max_lines = new_max;
+  return 1;
+}
+
+static void add_line(struct batch* b, int id, int level, const char* xref,
+		     struct tag_struct tag, const char* raw_value,
+		     Gedcom_val parsed_value)
+{
+  struct batch_line* line;
+  Gedcom_val_struct* value;
+
+  if (b->failed)
+    return;
+  if (b->nr_of_lines == b->max_lines && !grow_lines(b)) {
+    MEMORY_ERROR;
+    b->failed = 1;
+    return;
+  }
+
+  line  = &b->lines[b->nr_of_lines];
+  value = &b->values[b->nr_of_lines];
+  b->nr_of_lines++;
+
+  line->level     = level;
+  line->id        = id;
+  line->tag       = batch_strdup(b, tag.string);
+  line->tag_value = tag.value;
+  line->xref      = xref;
+  line->raw_value = batch_strdup(b, raw_value);
+
+  /* The value is copied, since the grammar reuses its value structs for
+     every line; the pointer to it is only set when the record is
+     delivered, because the array can still move */
+  if (parsed_value) {
+    *value = *GV_RESOLVE(parsed_value);
+    if (value->type == GV_CHAR_PTR)
+      value->value.string_val = batch_strdup(b, value->value.string_val);
+  }
+  else {
+    value->type     = GV_NULL;
+    value->deferred = NULL;
+    value->value.string_val = NULL;
+  }
+}
+
+/* Called from start_record, if there is a batch callback for the record */
+void batch_start_record(Gedcom_rec rec, int level, Gedcom_val xref,
+			struct tag_struct tag, char *raw_value,
+			Gedcom_val parsed_value)
+{
+  struct batch* b = PARSER->batch;
+  const char* xref_str = NULL;
+
+  if (!b) {
+    b = (struct batch*)calloc(1, sizeof(struct batch));
+    if (!b) {
+      MEMORY_ERROR;
+      PARSER->batch_active = 0;
+      return;
+    }
+    PARSER->batch = b;
+  }
+  b->rec         = rec;
+  b->failed      = 0;
+  b->nr_of_lines = 0;
+  b->current     = b->blocks;
+  b->used        = 0;
+  PARSER->batch_active = 1;
+
+  /* The string of an xref_value lives as long as the xref table */
+  if (xref && xref->type == GV_XREF_PTR && xref->value.xref_val)
+    xref_str = xref->value.xref_val->string;
+  add_line(b, rec, level, xref_str, tag, raw_value, parsed_value);
+}
+
+/* Called from start_element while a batch is active */
+void batch_add_element(Gedcom_elt elt, int level, struct tag_struct tag,
+		       char *raw_value, Gedcom_val parsed_value)
+{
+  add_line(PARSER->batch, elt, level, NULL, tag, raw_value, parsed_value);
+}
+
+/* Called from end_record while a batch is active: delivers the record */
+void batch_end_record(Gedcom_rec rec)
+{
+  struct batch* b = PARSER->batch;
+  Gedcom_rec_batch_cb cb = PARSER->record_batch_callback[rec];
+  int i;
+
+  PARSER->batch_active = 0;
+  if (b->rec != rec || b->failed || cb == NULL)
+    return;
+
+  for (i = 0; i < b->nr_of_lines; i++)
+    b->lines[i].parsed_value = &b->values[i];
+  if (PARSER->recorder)
+    record_batch(rec, b->lines, b->nr_of_lines);
+  else
+    (*cb)(rec, b->lines, b->nr_of_lines);
+}
+
+void cleanup_batch()
+{
+  struct batch* b = PARSER->batch;
+  if (b) {
+    struct batch_block* block = b->blocks;
+    while (block) {
+      struct batch_block* next = block->next;
+      free(block);
+      block = next;
+    }
+    free(b->lines);
+    free(b->values);
+    free(b);
+    PARSER->batch = NULL;
+  }
+  PARSER->batch_active = 0;
+}
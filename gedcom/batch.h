@@ -0,0 +1,37 @@
+/* Header for batch.c
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include "gedcom_internal.h"
+#include "gedcom.h"
+
+void batch_start_record(Gedcom_rec rec, int level, Gedcom_val xref,
+			struct tag_struct tag, char *raw_value,
+			Gedcom_val parsed_value);
+void batch_add_element(Gedcom_elt elt, int level, struct tag_struct tag,
+		       char *raw_value, Gedcom_val parsed_value);
+void batch_end_record(Gedcom_rec rec);
+void cleanup_batch();
+
+#endif /* __BATCH_H */
@@ -31,10 +31,45 @@
 #define INITIAL_BUF_SIZE 65536
 #endif
 
+/* The contents of a buffer are always null-terminated, but the rest of the
+   buffer is not zeroed: buflen tells where the contents end.
+
+   A buffer that grew beyond SHRINK_BUF_SIZE (e.g. for one very long note)
+   is shrunk back to that size after SHRINK_AFTER_RESETS resets in a row
+   with contents that would have fit in it */
+#define SHRINK_BUF_SIZE     65536
+#define SHRINK_AFTER_RESETS 64
+
+#ifndef va_copy
+#  ifdef __va_copy
+#    define va_copy(dest, src)  __va_copy(dest, src)
+#  else
+#    define va_copy(dest, src)  memcpy(&(dest), &(src), sizeof(va_list))
+#  endif
+#endif
+
+static void shrink_buffer(struct safe_buffer* b)
+{
+  if (b->buflen < SHRINK_BUF_SIZE)
+    b->small_resets++;
+  else
+    b->small_resets = 0;
+  if (b->small_resets >= SHRINK_AFTER_RESETS) {
+    char* new_buffer = realloc(b->buffer, SHRINK_BUF_SIZE);
+    if (new_buffer) {
+      b->buffer  = new_buffer;
+      b->bufsize = SHRINK_BUF_SIZE;
+    }
+    b->small_resets = 0;
+  }
+}
+
 void reset_buffer(struct safe_buffer* b)
 {
   if (b && b->buffer != NULL) {
-    memset(b->buffer, 0, b->bufsize);
+    if (b->bufsize > SHRINK_BUF_SIZE)
+      shrink_buffer(b);
+    b->buffer[0] = '\0';
     b->buf_end = b->buffer;
     b->buflen  = 0;
   }
@@ -42,8 +77,14 @@ void reset_buffer(struct safe_buffer* b)
 
 void cleanup_buffer(struct safe_buffer *b)
 {
-  if (b && b->buffer)
+  if (b && b->buffer) {
     free(b->buffer);
+    b->buffer  = NULL;
+    b->bufsize = 0;
+    b->buf_end = NULL;
+    b->buflen  = 0;
+    b->small_resets = 0;
+  }
 }
 
 void init_buffer(struct safe_buffer *b)
@@ -52,9 +93,10 @@ void init_buffer(struct safe_buffer *b)
     b->buffer = (char *)malloc(INITIAL_BUF_SIZE);
     if (b->buffer) {
       b->bufsize = INITIAL_BUF_SIZE;
-      memset(b->buffer, 0, b->bufsize);
+      b->buffer[0] = '\0';
       b->buf_end = b->buffer;
       b->buflen  = 0;
+      b->small_resets = 0;
       if (b->cleanup_func && atexit(b->cleanup_func) != 0) {
 	fprintf(stderr, _("Could not register buffer cleanup function"));
 	fprintf(stderr, "\n");
@@ -68,19 +110,72 @@ void init_buffer(struct safe_buffer *b)
   }
 }
 
-void grow_buffer(struct safe_buffer *b)
+/* Makes room for at least one more character (and the terminating null
+   character); returns 0 if there is no memory */
+int grow_buffer(struct safe_buffer *b)
+{
+  return reserve_buffer(b, 1);
+}
+
+/* Makes sure that len more characters (and the terminating null character)
+   fit in the buffer; returns 0 if there is no memory */
+int reserve_buffer(struct safe_buffer *b, size_t len)
 {
-  char* new_buffer;
-  size_t old_size = b->bufsize;
-  b->bufsize *= 2;
-  new_buffer = realloc(b->buffer, b->bufsize);
-  if (new_buffer) {
-    b->buffer = new_buffer;
-    memset(b->buffer + old_size, 0, b->bufsize - old_size);
+  init_buffer(b);
+  if (!b->buffer)
+    return 0;
+  if (b->buflen + len >= b->bufsize) {
+    size_t new_size = b->bufsize;
+    char* new_buffer;
+    while (b->buflen + len >= new_size)
+      new_size *= 2;
+    new_buffer = realloc(b->buffer, new_size);
+    if (!new_buffer)
+      return 0;
+    b->buffer  = new_buffer;
+    b->bufsize = new_size;
     b->buf_end = b->buffer + b->buflen;
   }
-  else
-    b->buffer = NULL;
+  return 1;
+}
+
+/* Appends len characters of s, which don't need to be null-terminated */
+int safe_buf_addmem(struct safe_buffer *b, const char *s, size_t len)
+{
+  if (!b || !reserve_buffer(b, len))
+    return 0;
+  memcpy(b->buf_end, s, len);
+  b->buf_end += len;
+  b->buflen  += len;
+  *b->buf_end = '\0';
+  return len;
+}
+
+/* Appends the string s as is (i.e. it is not a format) */
+int safe_buf_addstr(struct safe_buffer *b, const char *s)
+{
+  return safe_buf_addmem(b, s, strlen(s));
+}
+
+/* Returns the contents of the buffer as a string that the caller must free,
+   and starts a new buffer; returns NULL if there is no memory */
+char* detach_buffer(struct safe_buffer *b)
+{
+  char* str;
+  init_buffer(b);
+  str = b->buffer;
+  if (str) {
+    char* shrunk = realloc(str, b->buflen + 1);
+    if (shrunk)
+      str = shrunk;
+    b->buffer  = NULL;
+    b->bufsize = 0;
+    b->buf_end = NULL;
+    b->buflen  = 0;
+    b->small_resets = 0;
+    init_buffer(b);
+  }
+  return str;
 }
 
 int safe_buf_vappend(struct safe_buffer *b, const char *s, va_list ap)
@@ -92,15 +187,19 @@ int safe_buf_vappend(struct safe_buffer *b, const char *s, va_list ap)
       int rest_size = b->bufsize - b->buflen;
       
 #if HAVE_VSNPRINTF
-      res = vsnprintf(b->buf_end, rest_size, s, ap);
+      va_list aq;
+      va_copy(aq, ap);
+      res = vsnprintf(b->buf_end, rest_size, s, aq);
+      va_end(aq);
       
       if (res > -1 && res < rest_size) {
 	b->buf_end = b->buf_end + res;
 	b->buflen  = b->buflen + res;
 	break;
       }
-      else {
-	grow_buffer(b);
+      else if (!reserve_buffer(b, res > -1 ? (size_t)res : b->bufsize)) {
+	res = 0;
+	break;
       }
 #else /* not HAVE_VSNPRINTF */
 #  if HAVE_VSPRINTF
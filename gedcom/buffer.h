@@ -33,27 +33,29 @@ struct safe_buffer {
   char* buf_end;
   size_t buflen;   /* used size */
   void (*cleanup_func)(void);
+  int small_resets;
 };
 
 void init_buffer(struct safe_buffer* b);
 void reset_buffer(struct safe_buffer* b);
 void cleanup_buffer(struct safe_buffer* b);
-void grow_buffer(struct safe_buffer* b);
+int  grow_buffer(struct safe_buffer* b);
+int  reserve_buffer(struct safe_buffer* b, size_t len);
 
 int safe_buf_vappend(struct safe_buffer* b, const char* s, va_list ap);
 int safe_buf_append(struct safe_buffer* b, const char* s, ...);
+int safe_buf_addmem(struct safe_buffer* b, const char* s, size_t len);
+int safe_buf_addstr(struct safe_buffer* b, const char* s);
 char* get_buf_string(struct safe_buffer* b);
+char* detach_buffer(struct safe_buffer* b);
 
 #define SAFE_BUF_ADDCHAR(b, ch)                                               \
   {                                                                           \
     struct safe_buffer *buf = b;                                              \
     char c = ch;                                                              \
-    if (buf && buf->buffer == NULL)                                           \
-      init_buffer(buf);                                                       \
-    if (buf && buf->buffer) {                                                 \
-      if (buf->buflen == buf->bufsize)                                        \
-	grow_buffer(buf);                                                     \
+    if (buf && (buf->buflen + 1 < buf->bufsize || grow_buffer(buf))) {        \
       *buf->buf_end++ = c;                                                    \
+      *buf->buf_end   = '\0';                                                 \
       buf->buflen++;                                                          \
     }                                                                         \
   }
@@ -0,0 +1,165 @@
+/* Validity checks for calendar dates.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#include "gedcom_internal.h"
+#include "calendar.h"
+
+/* The routines in the calendar directory don't check whether a date is
+   valid: e.g. GregorianToSdn(1900, 2, 30) gives the SDN of 2 March 1900.
+   Instead of converting the SDN back to check this, the functions below
+   check the day against the length of the month.
+
+   The checks are only done where they give the same result as converting
+   back; outside that range (e.g. Hebrew years for which there is no entry
+   in the table below) calendar_date_valid returns -1.
+*/
+
+/* Range in which the arithmetic of gregor.c and julian.c is exact */
+#define MIN_YEAR   -4714
+#define MAX_YEAR   1000000
+
+static const int month_days[13] =
+  { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+/* Year numbers are -1 for 1 B.C., etc. (there is no year 0) */
+static int gregorian_leap(int year)
+{
+  if (year < 0) year++;
+  return (year % 4 == 0) && (year % 100 != 0 || year % 400 == 0);
+}
+
+static int julian_leap(int year)
+{
+  if (year < 0) year++;
+  return (year % 4 == 0);
+}
+
+static int gregorian_month_days(int year, int month)
+{
+  if (month == 2 && gregorian_leap(year))
+    return 29;
+  return month_days[month];
+}
+
+static int julian_month_days(int year, int month)
+{
+  if (month == 2 && julian_leap(year))
+    return 29;
+  return month_days[month];
+}
+
+/* French republican calendar: 12 months of 30 days, followed by 5 or 6
+   complementary days, in the years 1 to 14 (this is the arithmetic of
+   french.c) */
+static int french_month_days(int year, int month)
+{
+  if (month < 13)
+    return 30;
+  return ((year + 1) * 1461) / 4 - (year * 1461) / 4 - 360;
+}
+
+/* Hebrew calendar: the length of the year (353, 354 or 355 days in a
+   common year, 383, 384 or 385 in a leap year) determines the length of
+   the months.  Computing the length needs the molad of two years, so it
+   is precomputed here for the years 5000 to 6199 (1239 to 2439 A.D.), with
+   one character per year: '0' to '5' mean 353, 354, 355, 383, 384, 385.
+*/
+#define HEBREW_FIRST_YEAR  5000
+#define HEBREW_LAST_YEAR   6199
+
+static const char hebrew_year_type[] =
+  "312513213215024231250152312510512315015204232152132132510512"
+  "315024204223152132132510512312504223123152132150152312312504"
+  "223125105132150242312321521323125105132150242042501521323125"
+  "105123152042231501521321505123123242042231251321321505123123"
+  "215042231251321321502423125015231251051231501520423215213213"
+  "251051231502420422315213213251051231232420422315213215015231"
+  "231250422312510513215015231232152132312510513215024204250152"
+  "132312510512315204223150152132150512312324204223125132132150"
+  "512312321504223125132132150242312501523123125105150152042321"
+  "521321325105123150242042231521321325105123123242042231521321"
+  "501523123125042231251051321501523123215213231251051321502420"
+  "423215213231251051231520422315015213215051231231520422312513"
+  "213215051231232150422312513213215024231250152312312510515015"
+  "204232152132132510512315024204223152132132510512312324204223"
+  "152132132150512312504223125105132150152312321521323125105132"
+  "150242042321521323125105123150242042501521321505123123152042"
+  "231251321321505123123215042231251321321502423125015231231251"
+  "051501520423125015213251051231502420422315213213251051231232"
+  "420422315213213215051231250422312312513215015231232152132312"
+  "510513215024204232152132312510512315024204250152132150512312";
+
+static const int hebrew_year_length[6] = { 353, 354, 355, 383, 384, 385 };
+
+/* Months are numbered as in jewish.c: 6 is Adar I (Adar in a common
+   year), 7 is Adar II (only in a leap year) */
+static int hebrew_month_days(int year, int month)
+{
+  int length = hebrew_year_length[hebrew_year_type[year - HEBREW_FIRST_YEAR]
+				  - '0'];
+  int leap   = (length > 380);
+  switch (month) {
+    case 2:  return (length % 10 == 5 ? 30 : 29);   /* Heshvan */
+    case 3:  return (length % 10 == 3 ? 29 : 30);   /* Kislev */
+    case 6:  return (leap ? 30 : 29);               /* Adar I */
+    case 7:  return (leap ? 29 : 0);                /* Adar II */
+    case 1: case 5: case 8: case 10: case 12:
+      return 30;
+    default:
+      return 29;
+  }
+}
+
+/* Returns 1 if the given date exists in the given calendar, 0 if it
+   doesn't, and -1 if this can't be determined here (the date must then be
+   checked by converting it to SDN and back).  A date that exists can still
+   be outside the range of the calendar routines, which then return 0. */
+int calendar_date_valid(Calendar_type cal, int year, int month, int day)
+{
+  int days;
+  switch (cal) {
+    case CAL_GREGORIAN:
+    case CAL_JULIAN:
+      if (year < MIN_YEAR || year > MAX_YEAR)
+	return -1;
+      if (year == 0 || month < 1 || month > 12)
+	return 0;
+      days = (cal == CAL_GREGORIAN ? gregorian_month_days(year, month)
+	                           : julian_month_days(year, month));
+      break;
+    case CAL_HEBREW:
+      if (year < HEBREW_FIRST_YEAR || year > HEBREW_LAST_YEAR)
+	return -1;
+      if (month < 1 || month > 13)
+	return 0;
+      days = hebrew_month_days(year, month);
+      break;
+    case CAL_FRENCH_REV:
+      if (year < 1 || year > 14 || month < 1 || month > 13)
+	return 0;
+      days = french_month_days(year, month);
+      break;
+    default:
+      return 0;
+  }
+  return (day >= 1 && day <= days);
+}
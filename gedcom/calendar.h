@@ -0,0 +1,30 @@
+/* Header for calendar.c
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#ifndef __CALENDAR_H
+#define __CALENDAR_H
+
+#include "gedcom.h"
+
+int calendar_date_valid(Calendar_type cal, int year, int month, int day);
+
+#endif /* __CALENDAR_H */
@@ -28,21 +28,15 @@
 #include "buffer.h"
 #include "gedcom_internal.h"
 #include "gedcom.h"
+#include "parser.h"
 
-int compat_enabled = 1;
-Gedcom_compat compat_options = 0;
-int compatibility  = 0;
-int compatibility_program = 0;
-int compatibility_version = 0;
-const char* default_charset = "";
-
-void cleanup_compat_buffer();
-struct safe_buffer compat_buffer = { NULL, 0, NULL, 0, cleanup_compat_buffer };
-
-void cleanup_compat_buffer()
-{
-  cleanup_buffer(&compat_buffer);
-}
+#define compat_enabled        (!PARSER->compat_disabled)
+#define compat_options        (PARSER->compat_options)
+#define compatibility         (PARSER->compatibility)
+#define compatibility_program (PARSER->compatibility_program)
+#define compatibility_version (PARSER->compatibility_version)
+#define compat_state          (PARSER->compat_state)
+#define compat_prefix         (PARSER->compat_prefix)
 
 #define SUBMITTER_LINK         "@__COMPAT__SUBM__@"
 #define SLGC_FAMC_LINK         "@__COMPAT__FAM_SLGC__@"
@@ -155,11 +149,6 @@ int compat_matrix[] =
   /* C_NONSTD_SOUR_TAGS */    C_EASYTREE,
 };
 
-union _COMPAT_STATE {
-  int i;
-  void* vp;
-} compat_state[C_NR_OF_RULES];
-
 /* Compatibility handling */
 
 /** Allows to enable/disable the compatibility mode.
@@ -170,7 +159,7 @@ union _COMPAT_STATE {
  */
 void gedcom_set_compat_handling(int enable_compat)
 {
-  compat_enabled = enable_compat;
+  PARSER->compat_disabled = !enable_compat;
 }
 
 /** Allows to set some options for the compatibility handling.
@@ -236,7 +225,7 @@ void compute_compatibility()
   /* Reinitialize compatibility */
   int i;
   int version = 0;
-  default_charset = "";
+  PARSER->default_charset = "";
   compatibility = 0;
   for (i = 0; i < C_NR_OF_RULES; i++)
     compat_state[i].i = 0;
@@ -261,7 +250,7 @@ void compute_compatibility()
       break;
   }
   if (compatibility) {
-    default_charset = data[compatibility_program].default_charset;
+    PARSER->default_charset = data[compatibility_program].default_charset;
     enable_compat_msg(data[compatibility_program].name, version);
   }
 }
@@ -292,6 +281,17 @@ void compat_close()
   compatibility = 0;
 }
 
+/* Called at the end of a parallel parse, with the number of family links
+   that the worker parsers generated for C_NO_SLGC_FAMC */
+void compat_parallel_close(int slgc_famc_links)
+{
+  if (slgc_famc_links > 0) {
+    compat_state[C_NO_SLGC_FAMC].i = 1;
+    compat_generate_slgc_famc_fam();
+  }
+  compat_close();
+}
+
 /********************************************************************/
 /*  C_NO_SUBMITTER                                                  */
 /********************************************************************/
@@ -411,7 +411,7 @@ int compat_generate_char(Gedcom_ctxt parent)
   ts.value  = TAG_CHAR;
 
   /* Must strdup, because default_charset is const char */
-  charset   = strdup(default_charset);
+  charset   = strdup(PARSER->default_charset);
   if (! charset)
     MEMORY_ERROR;
   else {
@@ -422,7 +422,7 @@ int compat_generate_char(Gedcom_ctxt parent)
     /* close "1 CHAR" */
     end_element(ELT_HEAD_CHAR, parent, self1, NULL);
   }
-  if (open_conv_to_internal(default_charset) == 0)
+  if (open_conv_to_internal(PARSER->default_charset) == 0)
     return 1;
   else
     return 0;
@@ -554,7 +554,7 @@ int compat_check_551_tag(const char* tag, struct safe_buffer* b)
   if (is_551_tag(tag)) {
     reset_buffer(b);
     SAFE_BUF_ADDCHAR(b, '_');
-    safe_buf_append(b, tag);
+    safe_buf_addstr(b, tag);
     gedcom_warning(_("Converting 5.5.1 tag '%s' to standard 5.5 user tag '%s'"),
 		   tag, get_buf_string(b));
     return 1;
@@ -587,8 +587,10 @@ void compat_generate_slgc_famc_link(Gedcom_ctxt parent)
 
 void compat_generate_slgc_famc_fam()
 {
-  /* If bigger than 1, then the FAM record has already been generated */
-  if (compat_state[C_NO_SLGC_FAMC].i == 1) {
+  /* If bigger than 1, then the FAM record has already been generated.  The
+     worker parsers of a parallel parse don't generate it: the main parser
+     does it at the end (see compat_parallel_close) */
+  if (compat_state[C_NO_SLGC_FAMC].i == 1 && !PARSER->worker) {
     struct xref_value *xr = gedcom_parse_xref(SLGC_FAMC_LINK, XREF_DEFINED,
 					      XREF_FAM);
     struct tag_struct ts;
@@ -615,7 +617,7 @@ int compat_check_subm_comm(const char* tag, const char* parent_tag,
   if (!strcmp(tag, "COMM") && !strcmp(parent_tag, "SUBM")) {
     reset_buffer(b);
     SAFE_BUF_ADDCHAR(b, '_');
-    safe_buf_append(b, tag);
+    safe_buf_addstr(b, tag);
     gedcom_warning(_("Converting non-standard tag '%s' to user tag '%s'"),
 		   tag, get_buf_string(b));
     compat_state[C_SUBM_COMM].i = 1;
@@ -684,9 +686,10 @@ int compat_double_date_check(char* year2)
 int compat_double_date_final(struct date_value* dv, const char** curr_line)
 {
   char* compat_line_value = get_buf_string(&compat_buffer);
+  if (!compat_line_value || !compat_line_value[0])
+    return 0;   /* no double date seen: no need to parse again */
   compat_state[C_DOUBLE_DATES_4].i = 1;
-  if (compat_line_value && compat_line_value[0]
-      && (dv->type == DV_NO_MODIFIER || dv->type == DV_ABOUT)
+  if ((dv->type == DV_NO_MODIFIER || dv->type == DV_ABOUT)
       && dv->date1.day == -1
       && dv->date1.month == -1) {
     gedcom_warning(_("Converting '%s' to standard '%s'"),
@@ -711,7 +714,6 @@ int compat_date_check(struct date_value* dv, const char** curr_line)
 /*  C_NOTE_TOO_LONG                                                 */
 /********************************************************************/
 
-char compat_prefix[MAXGEDCLINELEN];
 
 int compat_long_line(int level, int tag)
 {
@@ -812,7 +814,7 @@ int compat_check_sour_tag(const char* tag, struct safe_buffer* b)
   if (is_nonstd_sour_tag(tag)) {
     reset_buffer(b);
     SAFE_BUF_ADDCHAR(b, '_');
-    safe_buf_append(b, tag);
+    safe_buf_addstr(b, tag);
     gedcom_warning(_("Converting undefined tag '%s' to user tag '%s'"),
 		   tag, get_buf_string(b));
     return 1;
@@ -829,7 +831,7 @@ Gedcom_ctxt compat_generate_nonstd_sour_start(Gedcom_ctxt parent, int level,
   Gedcom_ctxt self = NULL;
   reset_buffer(b);
   SAFE_BUF_ADDCHAR(b, '_');
-  safe_buf_append(b, ts.string);
+  safe_buf_addstr(b, ts.string);
   gedcom_warning(_("Converting invalidly used tag '%s' to user tag '%s'"),
 		 ts.string, get_buf_string(b));
   ts.string = get_buf_string(b);
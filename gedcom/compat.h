@@ -52,13 +52,18 @@ typedef enum _COMPAT_RULES {
   C_NR_OF_RULES
 } Compat_rule;
 
-extern struct safe_buffer compat_buffer;
+/* State that some of the rules need during the parse */
+union _COMPAT_STATE {
+  int i;
+  void* vp;
+};
 
 void set_compatibility_program(const char* program);
 void set_compatibility_version(const char* version);
 void compute_compatibility();
 int  compat_mode(Compat_rule rule);
 void compat_close();
+void compat_parallel_close(int slgc_famc_links);
 
 /* C_NO_SUBMITTER */
 void compat_generate_submitter_link(Gedcom_ctxt parent);
@@ -26,23 +26,14 @@
 #include "buffer.h"
 #include "compat.h"
 #include <string.h>
+#include <ctype.h>
 #include "date.h"
-
-struct date_value dv_s;
-struct date date_s;
+#include "calendar.h"
+#include "parser.h"
 
 struct date_value def_date_val;
-struct date def_date;
-
-const char* curr_line_value;
 
-void cleanup_date_buffer();
-struct safe_buffer date_buffer = { NULL, 0, NULL, 0, cleanup_date_buffer };
-
-void cleanup_date_buffer()
-{
-  cleanup_buffer(&date_buffer);
-}
+#define date_buffer (PARSER->date_buffer)
 
 int max_month[] = { 12,  /* CAL_GREGORIAN */
 		    12,  /* CAL_JULIAN */
@@ -86,9 +77,16 @@ from_sdn_func_type from_sdn_func[] = {
 long int checkedCalToSdn(Calendar_type cal, int year, int month, int day)
 {
   int y, m, d;
-  long int sdn = (*to_sdn_func[cal])(year,month, day);
+  long int sdn;
+  int valid = calendar_date_valid(cal, year, month, day);
+
+  if (valid == 0)
+    return -1;
+  sdn = (*to_sdn_func[cal])(year,month, day);
   if (sdn <= 0)
     return -1;
+  else if (valid == 1)
+    return sdn;
   else {
     (*from_sdn_func[cal])(sdn, &y, &m, &d);
     if ((year == y) && (month == m) && (day == d))
@@ -108,6 +106,67 @@ int checkedSdnToCal(Calendar_type cal, long int sdn,
     return 0;
 }
 
+/** This function converts an array of calendar dates to serial day numbers
+    (SDN), in the same way as \ref gedcom_normalize_date() does for one
+    date, but without the overhead of a struct date_value per date.  The
+    dates are given as separate arrays of the calendar, year, month and day.
+
+    \param count The number of dates
+    \param cal   The calendars of the dates
+    \param year  The years of the dates
+    \param month The months of the dates (1 is the first month)
+    \param day   The days of the dates
+    \param sdn   Is filled in with the SDN of each date, or -1 if the date
+    is not valid (or the calendar is \c CAL_UNKNOWN)
+
+    \return The number of dates that are not valid
+*/
+int gedcom_cal_to_sdn_array(size_t count, const Calendar_type* cal,
+			    const int* year, const int* month, const int* day,
+			    long int* sdn)
+{
+  size_t i;
+  int invalid = 0;
+  for (i = 0; i < count; i++) {
+    if (cal[i] >= CAL_GREGORIAN && cal[i] < CAL_UNKNOWN)
+      sdn[i] = checkedCalToSdn(cal[i], year[i], month[i], day[i]);
+    else
+      sdn[i] = -1;
+    if (sdn[i] == -1)
+      invalid++;
+  }
+  return invalid;
+}
+
+/** This function converts an array of serial day numbers (SDN) to calendar
+    dates; it is the inverse of \ref gedcom_cal_to_sdn_array().
+
+    \param count The number of dates
+    \param cal   The calendars in which to give the dates
+    \param sdn   The serial day numbers
+    \param year  Is filled in with the years of the dates
+    \param month Is filled in with the months of the dates
+    \param day   Is filled in with the days of the dates
+
+    \return The number of SDNs that could not be converted (the year, month
+    and day are then 0)
+*/
+int gedcom_sdn_to_cal_array(size_t count, const Calendar_type* cal,
+			    const long int* sdn,
+			    int* year, int* month, int* day)
+{
+  size_t i;
+  int invalid = 0;
+  for (i = 0; i < count; i++) {
+    if (cal[i] < CAL_GREGORIAN || cal[i] >= CAL_UNKNOWN
+	|| !checkedSdnToCal(cal[i], sdn[i], &year[i], &month[i], &day[i])) {
+      year[i] = month[i] = day[i] = 0;
+      invalid++;
+    }
+  }
+  return invalid;
+}
+
 void copy_date(struct date *to, struct date *from)
 {
   memcpy(to, from, sizeof(struct date));
@@ -477,6 +536,254 @@ struct date_value* gedcom_new_date_value(const struct date_value* copy_from)
   return dv_ptr;
 }
 
+/* Fast recognition of the common Gregorian dates, without the date lexer
+   and parser: [[day] month] year (optionally preceded by the Gregorian
+   escape), the same with one of the modifiers below, FROM date TO date and
+   BET date AND date.  Everything else (other calendars, double years,
+   phrases, errors) is left to the parser, which gives the same result for
+   these dates.
+*/
+#define MAX_DATE_WORDS 9
+
+struct date_word {
+  const char* start;
+  size_t      len;
+};
+
+struct date_modifier {
+  const char*     keyword;
+  Date_value_type type;
+};
+
+static struct date_modifier date_modifiers[] =
+{ { "FROM", DV_FROM },
+  { "TO",   DV_TO },
+  { "BEF",  DV_BEFORE },
+  { "AFT",  DV_AFTER },
+  { "BET",  DV_BETWEEN },
+  { "ABT",  DV_ABOUT },
+  { "CAL",  DV_CALCULATED },
+  { "EST",  DV_ESTIMATED },
+  { NULL,   0 }
+};
+
+/* Returns the number of words, or -1 if there are too many */
+static int split_date_words(const char* str, struct date_word* words)
+{
+  int nr = 0;
+  for (;;) {
+    while (*str == ' ' || *str == '\t')
+      str++;
+    if (!*str)
+      return nr;
+    if (nr == MAX_DATE_WORDS)
+      return -1;
+    words[nr].start = str;
+    while (*str && *str != ' ' && *str != '\t')
+      str++;
+    words[nr].len = str - words[nr].start;
+    nr++;
+  }
+}
+
+/* Case-insensitive, like the date lexer */
+static int is_date_keyword(const struct date_word* w, const char* keyword)
+{
+  size_t i;
+  for (i = 0; i < w->len; i++)
+    if (toupper((unsigned char)w->start[i]) != keyword[i])
+      return 0;
+  return (keyword[i] == '\0');
+}
+
+static int gregorian_month(const struct date_word* w)
+{
+  int i;
+  if (w->len == 3)
+    for (i = 0; i < 12; i++)
+      if (is_date_keyword(w, month_name[CAL_GREGORIAN][i]))
+	return i + 1;
+  return 0;
+}
+
+static int date_number(const struct date_word* w, size_t max_len)
+{
+  int value = 0;
+  size_t i;
+  if (w->len > max_len)
+    return -1;
+  for (i = 0; i < w->len; i++) {
+    if (w->start[i] < '0' || w->start[i] > '9')
+      return -1;
+    value = value * 10 + (w->start[i] - '0');
+  }
+  return value;
+}
+
+static void copy_date_word(char* to, const struct date_word* w)
+{
+  memcpy(to, w->start, w->len);
+  to[w->len] = '\0';
+}
+
+/* Recognizes [[day] month] year, starting at word *pos */
+static int fast_parse_simple_date(struct date_word* words, int nr, int* pos,
+				  struct date* d)
+{
+  int i = *pos;
+  int num;
+
+  init_date(d);
+  if (i < nr && is_date_keyword(&words[i], "@#DGREGORIAN@"))
+    i++;
+  if (i + 1 < nr && !gregorian_month(&words[i])
+      && gregorian_month(&words[i + 1])) {
+    num = date_number(&words[i], MAX_DAY_LEN);
+    if (num == -1)
+      return 0;
+    copy_date_word(d->day_str, &words[i]);
+    d->day = num;
+    i++;
+  }
+  if (i < nr && (num = gregorian_month(&words[i])) != 0) {
+    copy_date_word(d->month_str, &words[i]);
+    d->month = num;
+    i++;
+  }
+  if (i >= nr || (num = date_number(&words[i], MAX_YEAR_LEN)) == -1)
+    return 0;
+  copy_date_word(d->year_str, &words[i]);
+  d->year      = num;
+  d->year_type = YEAR_SINGLE;
+  d->cal       = CAL_GREGORIAN;
+  *pos = i + 1;
+  return 1;
+}
+
+/* Returns 1 if the date was recognized (the result is then in dv_s, without
+   the serial day numbers), 0 otherwise */
+static int fast_parse_date(const char* str)
+{
+  struct date_word words[MAX_DATE_WORDS];
+  struct date d1, d2;
+  Date_value_type type = DV_NO_MODIFIER;
+  int nr  = split_date_words(str, words);
+  int pos = 0;
+  int i;
+
+  if (nr <= 0)
+    return 0;
+  for (i = 0; date_modifiers[i].keyword; i++) {
+    if (is_date_keyword(&words[0], date_modifiers[i].keyword)) {
+      type = date_modifiers[i].type;
+      pos  = 1;
+      break;
+    }
+  }
+  if (!fast_parse_simple_date(words, nr, &pos, &d1))
+    return 0;
+
+  if (type == DV_BETWEEN || (type == DV_FROM && pos < nr)) {
+    if (pos >= nr
+	|| !is_date_keyword(&words[pos], type == DV_BETWEEN ? "AND" : "TO"))
+      return 0;
+    pos++;
+    if (!fast_parse_simple_date(words, nr, &pos, &d2) || pos != nr)
+      return 0;
+    if (type == DV_FROM)
+      type = DV_FROM_TO;
+    make_date_value(type, &d1, &d2, "");
+  }
+  else if (pos != nr)
+    return 0;
+  else
+    make_date_value(type, &d1, &def_date, "");
+  return 1;
+}
+
+/* The date cache: a table of date_cache_size entries (a power of two),
+   indexed on a hash of the date string; a new date replaces the date that
+   is in its slot.  Only dates that are recognized by fast_parse_date and
+   that are valid are stored, so that a cache hit never skips a message. */
+#define DATE_CACHE_KEY_LEN 32
+
+struct date_cache_entry {
+  char              key[DATE_CACHE_KEY_LEN];
+  struct date_value value;
+};
+
+static struct date_cache_entry* date_cache_slot(const char* str)
+{
+  unsigned long hash = 2166136261UL;
+  const unsigned char* ch;
+
+  for (ch = (const unsigned char*)str; *ch; ch++) {
+    if (ch - (const unsigned char*)str >= DATE_CACHE_KEY_LEN - 1)
+      return NULL;
+    hash = ((hash ^ *ch) * 16777619UL) & 0xFFFFFFFFUL;
+  }
+  
+  if (!PARSER->date_cache) {
+    PARSER->date_cache
+      = (struct date_cache_entry*)calloc(PARSER->date_cache_size,
+					 sizeof(struct date_cache_entry));
+    if (!PARSER->date_cache) {
+      MEMORY_ERROR;
+      PARSER->date_cache_size = 0;
+      return NULL;
+    }
+  }
+  return &PARSER->date_cache[hash & (PARSER->date_cache_size - 1)];
+}
+
+void cleanup_date_cache()
+{
+  if (PARSER->date_cache) {
+    free(PARSER->date_cache);
+    PARSER->date_cache = NULL;
+  }
+}
+
+/** This function enables a cache for the parsing of dates (in
+    \ref gedcom_parse_date(), and thus also for the dates in a GEDCOM file).
+    The cache remembers the results for the most recent date strings, so
+    that dates that occur often in a file are only parsed once.  The cache
+    belongs to the current parser.
+
+    Calling this function also empties the cache and resets its statistics
+    (see \ref gedcom_get_date_cache_stats()).
+
+    \param size The number of dates that the cache can hold (it is rounded
+    up to a power of two); 0 disables the cache, which is the default.
+*/
+void gedcom_set_date_cache(int size)
+{
+  int rounded = 0;
+  if (size > 0)
+    for (rounded = 1; rounded < size; rounded *= 2)
+      ;
+  cleanup_date_cache();
+  PARSER->date_cache_size   = rounded;
+  PARSER->date_cache_hits   = 0;
+  PARSER->date_cache_misses = 0;
+}
+
+/** This function returns the statistics of the date cache of the current
+    parser (see \ref gedcom_set_date_cache()).
+
+    \param hits   Is filled in with the number of dates found in the cache
+    (can be \c NULL)
+    \param misses Is filled in with the number of dates that were not found
+    in the cache (can be \c NULL)
+*/
+void gedcom_get_date_cache_stats(unsigned long* hits, unsigned long* misses)
+{
+  if (hits)
+    *hits = PARSER->date_cache_hits;
+  if (misses)
+    *misses = PARSER->date_cache_misses;
+}
+
 /** This function allows to convert the given \c line_value into a struct
     date_value.
     
@@ -488,6 +795,18 @@ struct date_value* gedcom_new_date_value(const struct date_value* copy_from)
 struct date_value gedcom_parse_date(const char* line_value)
 {
   int result = 0;
+  int fast   = 0;
+  struct date_cache_entry* entry = NULL;
+
+  if (PARSER->date_cache_size) {
+    entry = date_cache_slot(line_value);
+    if (entry && !strcmp(entry->key, line_value)) {
+      PARSER->date_cache_hits++;
+      return entry->value;
+    }
+    PARSER->date_cache_misses++;
+  }
+  
   init_date(&dv_s.date1);
   init_date(&dv_s.date2);
   init_date(&date_s);
@@ -499,14 +818,18 @@ struct date_value gedcom_parse_date(const char* line_value)
     result = 1;
   }
   else {
-    compat_date_start();
-    init_gedcom_date_lex(line_value);
-    gedcom_date_parse();
-    close_gedcom_date_lex();
-    if (compat_date_check(&dv_s, &curr_line_value)) {
-      init_gedcom_date_lex(curr_line_value);
-      gedcom_date_parse();
-      close_gedcom_date_lex();
+    fast = fast_parse_date(line_value);
+    if (!fast) {
+      compat_date_start();
+      if (init_gedcom_date_lex(line_value)) {
+	gedcom_date_parse();
+	close_gedcom_date_lex();
+      }
+      if (compat_date_check(&dv_s, &curr_line_value)
+	  && init_gedcom_date_lex(curr_line_value)) {
+	gedcom_date_parse();
+	close_gedcom_date_lex();
+      }
     }
     if (dv_s.date1.cal != CAL_UNKNOWN)
       result |= numbers_to_sdn(&dv_s.date1);
@@ -518,6 +841,10 @@ struct date_value gedcom_parse_date(const char* line_value)
 		      curr_line_value);
     make_date_value(DV_PHRASE, &dv_s.date1, &dv_s.date2, curr_line_value);
   }
+  else if (fast && entry) {
+    strcpy(entry->key, line_value);
+    memcpy(&entry->value, &dv_s, sizeof(struct date_value));
+  }
   return dv_s;
 }
 
@@ -529,21 +856,25 @@ void write_date(const struct date* d)
     switch (d->cal) {
       case CAL_GREGORIAN: break;
       case CAL_JULIAN:
-	safe_buf_append(&date_buffer, "@#DJULIAN@ "); break;
+	safe_buf_addstr(&date_buffer, "@#DJULIAN@ "); break;
       case CAL_HEBREW:
-	safe_buf_append(&date_buffer, "@#DHEBREW@ "); break;
+	safe_buf_addstr(&date_buffer, "@#DHEBREW@ "); break;
       case CAL_FRENCH_REV:
-	safe_buf_append(&date_buffer, "@#DFRENCH R@ "); break;
+	safe_buf_addstr(&date_buffer, "@#DFRENCH R@ "); break;
       case CAL_UNKNOWN:
-	safe_buf_append(&date_buffer, "@#DUNKNOWN@ "); break;
+	safe_buf_addstr(&date_buffer, "@#DUNKNOWN@ "); break;
       default:
 	break;
     }
-    if (d->day_str[0])
-      safe_buf_append(&date_buffer, "%s ", d->day_str);
-    if (d->month_str[0])
-      safe_buf_append(&date_buffer, "%s ", d->month_str);
-    safe_buf_append(&date_buffer, "%s", d->year_str);
+    if (d->day_str[0]) {
+      safe_buf_addstr(&date_buffer, d->day_str);
+      SAFE_BUF_ADDCHAR(&date_buffer, ' ');
+    }
+    if (d->month_str[0]) {
+      safe_buf_addstr(&date_buffer, d->month_str);
+      SAFE_BUF_ADDCHAR(&date_buffer, ' ');
+    }
+    safe_buf_addstr(&date_buffer, d->year_str);
   }
 }
 
@@ -564,38 +895,38 @@ char* gedcom_date_to_string(const struct date_value* val)
     case DV_NO_MODIFIER:
       write_date(&val->date1); break;
     case DV_BEFORE:
-      safe_buf_append(&date_buffer, "BEF ");
+      safe_buf_addstr(&date_buffer, "BEF ");
       write_date(&val->date1); break;
     case DV_AFTER:
-      safe_buf_append(&date_buffer, "AFT ");
+      safe_buf_addstr(&date_buffer, "AFT ");
       write_date(&val->date1); break;
     case DV_BETWEEN:
-      safe_buf_append(&date_buffer, "BET ");
+      safe_buf_addstr(&date_buffer, "BET ");
       write_date(&val->date1);
-      safe_buf_append(&date_buffer, " AND ");
+      safe_buf_addstr(&date_buffer, " AND ");
       write_date(&val->date2); break;
     case DV_FROM:
-      safe_buf_append(&date_buffer, "FROM ");
+      safe_buf_addstr(&date_buffer, "FROM ");
       write_date(&val->date1); break;
     case DV_TO:
-      safe_buf_append(&date_buffer, "TO ");
+      safe_buf_addstr(&date_buffer, "TO ");
       write_date(&val->date1); break;
     case DV_FROM_TO:
-      safe_buf_append(&date_buffer, "FROM ");
+      safe_buf_addstr(&date_buffer, "FROM ");
       write_date(&val->date1);
-      safe_buf_append(&date_buffer, " TO ");
+      safe_buf_addstr(&date_buffer, " TO ");
       write_date(&val->date2); break;
     case DV_ABOUT:
-      safe_buf_append(&date_buffer, "ABT ");
+      safe_buf_addstr(&date_buffer, "ABT ");
       write_date(&val->date1); break;
     case DV_CALCULATED:
-      safe_buf_append(&date_buffer, "CAL ");
+      safe_buf_addstr(&date_buffer, "CAL ");
       write_date(&val->date1); break;
     case DV_ESTIMATED:
-      safe_buf_append(&date_buffer, "EST ");
+      safe_buf_addstr(&date_buffer, "EST ");
       write_date(&val->date1); break;
     case DV_INTERPRETED:
-      safe_buf_append(&date_buffer, "INT ");
+      safe_buf_addstr(&date_buffer, "INT ");
       write_date(&val->date1);
       safe_buf_append(&date_buffer, " (%s)", val->phrase); break;
     case DV_PHRASE:
@@ -31,13 +31,7 @@
 #define gedcom_date_error gedcom_warning
 #define MAX_DATE_TOKEN 10
 
-extern struct date_value dv_s;
-extern struct date date_s;
-extern struct date def_date;
-extern const char* curr_line_value;
-
 int               gedcom_date_parse();
-int               gedcom_date_lex();
 
 int get_date_token(const char* input);
 int get_year_tokens(const char* str, char** year1, char** year2);
@@ -47,12 +41,17 @@ int get_month_num(Calendar_type cal, const char* input);
 int get_year_num(const char* input, Year_type* ytype);
 
 /* These are defined in gedcom_date.lex */
-void              init_gedcom_date_lex(const char* string);
+int               gedcom_date_lex_current();
+int               init_gedcom_date_lex(const char* string);
 void              close_gedcom_date_lex();
+void              cleanup_gedcom_date_lex();
+
+void               cleanup_date_cache();
 
 struct date_value* make_date_value(Date_value_type t, struct date *d1,
 				   struct date *d2, const char* p);
 void               copy_date(struct date *to, struct date *from);
+void               init_date(struct date *d);
 
 #define GEDCOM_MAKE_DATE(VAR, DATE) \
    GEDCOM_MAKE(VAR, DATE, GV_DATE_VALUE, date_val)
@@ -31,6 +31,7 @@
 #include "encoding_state.h"
 #include "hash.h"
 #include "utf8tools.h"
+#include "parser.h"
 
 #define ENCODING_CONF_FILE "gedcom.enc"
 #define GCONV_SEARCH_PATH "GCONV_PATH"
@@ -248,30 +249,48 @@ void init_encodings()
   }
 }
 
-static convert_t to_int = NULL;
+#define to_int              (PARSER->to_int)
+#define to_int_identity     (PARSER->to_int_identity)
+#define to_int_pending      (PARSER->to_int_pending)
+#define to_int_pending_len  (PARSER->to_int_pending_len)
+
+/* Values of to_int_identity: input in ASCII and UTF-8 is only checked and
+   copied, iconv is not used for it */
+#define IDENTITY_NONE   0
+#define IDENTITY_ASCII  1
+#define IDENTITY_UTF8   2
+
 static char* error_value = "<error>";
 
 int open_conv_to_internal(const char* fromcode)
 {
   convert_t new_to_int = NULL;
+  int identity = IDENTITY_NONE;
   const char *encoding = get_encoding(fromcode, read_encoding.width);
   
   if (encoding != NULL) {
-    new_to_int = initialize_utf8_conversion(encoding, 1);
-    if (new_to_int == NULL) {
-      gedcom_error(_("Error opening conversion context for encoding %s: %s"),
-		   encoding, strerror(errno));
+    if (read_encoding.width == ONE_BYTE && !strcmp(encoding, "ASCII"))
+      identity = IDENTITY_ASCII;
+    else if (read_encoding.width == ONE_BYTE
+	     && !strcmp(encoding, INTERNAL_ENCODING))
+      identity = IDENTITY_UTF8;
+    else {
+      new_to_int = initialize_utf8_conversion(encoding, 1);
+      if (new_to_int == NULL) {
+	gedcom_error(_("Error opening conversion context for encoding %s: %s"),
+		     encoding, strerror(errno));
+      }
     }
   }
 
-  if (new_to_int != NULL) {
-    if (to_int != NULL)
-      cleanup_utf8_conversion(to_int);
-    to_int = new_to_int;
+  if (new_to_int != NULL || identity != IDENTITY_NONE) {
+    close_conv_to_internal();
+    to_int          = new_to_int;
+    to_int_identity = identity;
     set_read_encoding(fromcode, encoding);
   }
 
-  return (new_to_int != NULL);
+  return (new_to_int != NULL || identity != IDENTITY_NONE);
 }
 
 void close_conv_to_internal()
@@ -280,12 +299,59 @@ void close_conv_to_internal()
     cleanup_utf8_conversion(to_int);
     to_int = NULL;
   }
+  to_int_identity    = IDENTITY_NONE;
+  to_int_pending_len = 0;
 }
 
+/* Checks and copies the input, in the same way as an incremental iconv
+   conversion: an incomplete UTF-8 character at the end is kept for the
+   next call, and NULL is returned for invalid input */
+static char* identity_to_internal(const char* str, size_t len,
+				  struct conv_buffer* output_buf)
+{
+  char* combined = NULL;
+  char* result   = NULL;
+  size_t valid;
+  int incomplete = 0;
+
+  if (!str) {
+    to_int_pending_len = 0;
+    return NULL;
+  }
+
+  if (to_int_pending_len > 0) {
+    combined = (char*)malloc(to_int_pending_len + len);
+    if (!combined) {
+      MEMORY_ERROR;
+      return NULL;
+    }
+    memcpy(combined, to_int_pending, to_int_pending_len);
+    memcpy(combined + to_int_pending_len, str, len);
+    len += to_int_pending_len;
+    str  = combined;
+    to_int_pending_len = 0;
+  }
+
+  if (to_int_identity == IDENTITY_ASCII)
+    valid = ascii_length(str, len);
+  else
+    valid = utf8_valid_length(str, len, &incomplete);
+
+  if (valid == len || incomplete) {
+    to_int_pending_len = len - valid;
+    memcpy(to_int_pending, str + valid, to_int_pending_len);
+    result = fill_conv_buffer(output_buf, str, valid);
+  }
+
+  free(combined);
+  return result;
+}
 
 char* to_internal(const char* str, size_t len, struct conv_buffer* output_buf)
 {
-  if (conversion_set_output_buffer(to_int, output_buf))
+  if (to_int_identity != IDENTITY_NONE)
+    return identity_to_internal(str, len, output_buf);
+  else if (conversion_set_output_buffer(to_int, output_buf))
     return convert_to_utf8_incremental(to_int, str, len);
   else
     return error_value;
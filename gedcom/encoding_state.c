@@ -22,9 +22,9 @@
 #include "gedcom.h"
 #include "encoding.h"
 #include "encoding_state.h"
+#include "parser.h"
 #include <string.h>
 
-struct encoding_state read_encoding;
 /* SYS_NEWLINE is defined in config.h */
 struct encoding_state write_encoding =
 { "ASCII", "ASCII", ONE_BYTE, WITHOUT_BOM, SYS_NEWLINE };
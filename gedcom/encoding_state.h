@@ -37,7 +37,6 @@ struct encoding_state {
   char         terminator[MAX_TERMINATOR_LEN + 1];
 };
 
-struct encoding_state read_encoding;
 struct encoding_state write_encoding;
 
 void set_read_encoding(const char* charset, const char* encoding);
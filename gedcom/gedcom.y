@@ -150,24 +150,20 @@
 #include "xref.h"
 #include "compat.h"
 #include "buffer.h"
+#include "reader.h"
+#include "parser.h"
 
-int  count_level    = 0;
-int  fail           = 0;
 int  gedcom_high_level_debug = 0; 
-Gedcom_err_mech error_mechanism = IMMED_FAIL;
-Gedcom_val_struct val1;
-Gedcom_val_struct val2; 
 
-void cleanup_line_item_buffer();
-struct safe_buffer line_item_buffer = { NULL, 0, NULL, 0,
-					cleanup_line_item_buffer };
-
-void cleanup_concat_buffer(); 
-struct safe_buffer concat_buffer = { NULL, 0, NULL, 0, cleanup_concat_buffer };
-
-void cleanup_usertag_buffer();
-struct safe_buffer usertag_buffer = { NULL, 0, NULL, 0,
-				      cleanup_usertag_buffer};
+/* The state of the grammar is kept in the current parser (see parser.h) */
+#define count_level       (PARSER->count_level)
+#define fail              (PARSER->fail)
+#define count_arrays      (PARSER->count_arrays)
+#define tag_stack         (PARSER->tag_stack)
+#define ctxt_stack        (PARSER->ctxt_stack)
+#define line_item_buffer  (PARSER->line_item_buffer)
+#define concat_buffer     (PARSER->concat_buffer)
+#define usertag_buffer    (PARSER->usertag_buffer)
  
 /* These are defined at the bottom of the file */ 
 void push_countarray(int level);
@@ -179,6 +175,7 @@ void pop_countarray();
 int  count_tag(int tag);
 int  check_occurrence(int tag);
 void clean_up();
+void add_to_line_item(const char* str);
 
 #define HANDLE_ERROR                                                          \
      { if (error_mechanism == IMMED_FAIL) {                                   \
@@ -209,7 +206,7 @@ void clean_up();
 #define GRANDPARENT(OFF)                                                      \
      get_parentctxt(OFF)
 #define CHK(TAG)                                                              \
-     { if (!check_occurrence(TAG_##TAG)) {                                    \
+     { if (!check_occurrence(TAG_##TAG) && !skipping(SKIP_OCCURRENCES)) {     \
          char* parenttag = get_parenttag(0);                                  \
          gedcom_error(_("The tag '%s' is mandatory within '%s', but missing"),\
 		      #TAG, parenttag);                                       \
@@ -233,7 +230,7 @@ void clean_up();
 #define OCCUR1(CHILDTAG, MIN) { count_tag(TAG_##CHILDTAG); } 
 #define OCCUR2(CHILDTAG, MIN, MAX)                                            \
      { int num = count_tag(TAG_##CHILDTAG);                                   \
-       if (num > MAX) {                                                       \
+       if (num > MAX && !skipping(SKIP_OCCURRENCES)) {                        \
          char* parenttag = get_parenttag(0);                                  \
          gedcom_error(_("The tag '%s' can maximally occur %d time(s) within '%s'"),                                                                          \
 		      #CHILDTAG, MAX, parenttag);                             \
@@ -252,6 +249,27 @@ void clean_up();
        HANDLE_ERROR; \
      }
 
+/* The parsed values of dates, ages and cross-references; depending on the
+   skip options (see gedcom_set_skip_options), they are not computed if
+   nobody is going to see them, i.e. if the record or element (REC_OR_ELT)
+   has no start callback */
+#define PARSE_DATE(REC_OR_ELT, RAW)                                           \
+     (!value_needed(REC_OR_ELT, SKIP_VALUES) ?                                \
+      GEDCOM_MAKE_NULL(val1) :                                                \
+      skipping(SKIP_UNREAD_VALUES) ?                                          \
+      GEDCOM_MAKE_DEFERRED(val1, RAW, GV_DATE_VALUE) :                        \
+      GEDCOM_MAKE_DATE(val1, gedcom_parse_date(RAW)))
+#define PARSE_AGE(REC_OR_ELT, RAW)                                            \
+     (!value_needed(REC_OR_ELT, SKIP_VALUES) ?                                \
+      GEDCOM_MAKE_NULL(val1) :                                                \
+      skipping(SKIP_UNREAD_VALUES) ?                                          \
+      GEDCOM_MAKE_DEFERRED(val1, RAW, GV_AGE_VALUE) :                         \
+      GEDCOM_MAKE_AGE(val1, gedcom_parse_age(RAW)))
+#define PARSE_XREF(REC_OR_ELT, RAW, CTXT, TYPE)                               \
+     (value_needed(REC_OR_ELT, SKIP_XREFS) ?                                  \
+      gedcom_parse_xref(RAW, CTXT, TYPE) :                                    \
+      &def_xref_val)
+
 %}
 
 %union {
@@ -261,8 +279,9 @@ void clean_up();
   Gedcom_ctxt ctxt;
 }
 
+%pure_parser
 %token_table
-%expect 317
+%expect 325
 
 %token <string> BADTOKEN
 %token <number> OPEN
@@ -401,6 +420,13 @@ void clean_up();
 %token <tag> TAG_VERS
 %token <tag> TAG_WIFE
 %token <tag> TAG_WILL
+/* Declared after the tags, so that the tag numbers don't change */
+%token <string> ANYSTRING
+/* Only returned as the first token, to parse a part of the file (see
+   gedcom_lex in multilex.c and parallel.c) */
+%token PARSE_HEAD
+%token PARSE_RECORDS
+%token PARSE_LAST_RECORDS
 
 %type <tag> anystdtag
 %type <tag> anytoptag
@@ -421,6 +447,17 @@ void clean_up();
 
 %%
 
+parse       : file
+            | PARSE_HEAD head_sect
+               { if (fail == 1) YYABORT; }
+            | PARSE_HEAD error
+               { clean_up(); }
+            | PARSE_RECORDS records
+               { if (fail == 1) YYABORT; }
+            | PARSE_LAST_RECORDS records trlr_sect
+               { if (fail == 1) YYABORT; }
+            ;
+
 file        : head_sect records trlr_sect
                { compat_close();
 		 if (fail == 1) YYABORT;
@@ -469,6 +506,10 @@ head_sect    : OPEN DELIM TAG_HEAD
 		 else CHK(CHAR);
 
 		 CHECK1(SOUR);
+
+		 /* The character set is known now, so the rest of the input
+		    can be converted in blocks */
+		 reader_start_conversion();
 	       }
                CLOSE
                { end_record(REC_HEAD, $<ctxt>4, GEDCOM_MAKE_NULL(val1));
@@ -599,11 +640,11 @@ head_sour_data_sub : head_sour_data_date_sect  { OCCUR2(DATE, 0, 1) }
                    ;
 
 head_sour_data_date_sect : OPEN DELIM TAG_DATE mand_line_item
-                           { struct date_value dv = gedcom_parse_date($4);
+                           { Gedcom_val val
+			         = PARSE_DATE(ELT_HEAD_SOUR_DATA_DATE, $4);
 			     $<ctxt>$
 			       = start_element(ELT_HEAD_SOUR_DATA_DATE,
-					       PARENT, $1, $3, $4,
-					       GEDCOM_MAKE_DATE(val1, dv));
+					       PARENT, $1, $3, $4, val);
 			     START(DATE, $1, $<ctxt>$)
 			   }
                            no_std_subs
@@ -647,10 +688,9 @@ head_dest_sect : OPEN DELIM TAG_DEST mand_line_item
 
 /* HEAD.DATE */
 head_date_sect : OPEN DELIM TAG_DATE mand_line_item 
-                 { struct date_value dv = gedcom_parse_date($4);
+                 { Gedcom_val val = PARSE_DATE(ELT_HEAD_DATE, $4);
 		   $<ctxt>$ = start_element(ELT_HEAD_DATE,
-					    PARENT, $1, $3, $4,
-					    GEDCOM_MAKE_DATE(val1, dv));
+					    PARENT, $1, $3, $4, val);
 		   if (compat_mode(C_HEAD_TIME))
 		     compat_save_head_date_context($<ctxt>$);
 		   START(DATE, $1, $<ctxt>$)
@@ -700,8 +740,8 @@ head_time_sect : OPEN DELIM TAG_TIME opt_line_item
 
 /* HEAD.SUBM */
 head_subm_sect : OPEN DELIM TAG_SUBM mand_pointer
-                 { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							     XREF_SUBM);
+                 { struct xref_value *xr
+		       = PARSE_XREF(ELT_HEAD_SUBM, $4, XREF_USED, XREF_SUBM);
 	           if (xr == NULL) HANDLE_ERROR;
 		   $<ctxt>$ = start_element(ELT_HEAD_SUBM,
 					    PARENT, $1, $3, $4,
@@ -717,8 +757,8 @@ head_subm_sect : OPEN DELIM TAG_SUBM mand_pointer
                ;
 /* HEAD.SUBN */
 head_subn_sect : OPEN DELIM TAG_SUBN mand_pointer 
-                 { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							     XREF_SUBN);
+                 { struct xref_value *xr
+		       = PARSE_XREF(ELT_HEAD_SUBN, $4, XREF_USED, XREF_SUBN);
 	           if (xr == NULL) HANDLE_ERROR;
 		   $<ctxt>$ = start_element(ELT_HEAD_SUBN,
 					    PARENT, $1, $3, $4,
@@ -911,7 +951,7 @@ head_note_sect : OPEN DELIM TAG_NOTE mand_line_item
 					    PARENT, $1, $3, $4, 
 					    GEDCOM_MAKE_STRING(val1, $4));
 		   reset_buffer(&concat_buffer);
-		   safe_buf_append(&concat_buffer, $4);
+		   safe_buf_addstr(&concat_buffer, $4);
 		   START(NOTE, $1, $<ctxt>$)
 		 }
                  head_note_subs
@@ -942,8 +982,8 @@ trlr_sect   : OPEN DELIM TAG_TRLR CLOSE { }
 /**** Family record                                               ****/
 /*********************************************************************/
 fam_rec      : OPEN DELIM POINTER DELIM TAG_FAM
-               { struct xref_value *xr = gedcom_parse_xref($3, XREF_DEFINED,
-							   XREF_FAM);
+               { struct xref_value *xr
+		     = PARSE_XREF(REC_FAM, $3, XREF_DEFINED, XREF_FAM);
 	         if (xr == NULL) HANDLE_ERROR;
 		 $<ctxt>$ = start_record(REC_FAM,
 					 $1, GEDCOM_MAKE_XREF_PTR(val1, xr),
@@ -977,8 +1017,8 @@ fam_sub      : fam_event_struc_sub  /* 0:M */
 
 /* FAM.HUSB */
 fam_husb_sect : OPEN DELIM TAG_HUSB mand_pointer    
-                { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							    XREF_INDI);
+                { struct xref_value *xr
+		      = PARSE_XREF(ELT_FAM_HUSB, $4, XREF_USED, XREF_INDI);
 		  if (xr == NULL) HANDLE_ERROR;
 		  $<ctxt>$ = start_element(ELT_FAM_HUSB,
 					   PARENT, $1, $3, $4, 
@@ -995,8 +1035,8 @@ fam_husb_sect : OPEN DELIM TAG_HUSB mand_pointer
 
 /* FAM.WIFE */
 fam_wife_sect : OPEN DELIM TAG_WIFE mand_pointer 
-                { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							    XREF_INDI);
+                { struct xref_value *xr
+		      = PARSE_XREF(ELT_FAM_WIFE, $4, XREF_USED, XREF_INDI);
 		  if (xr == NULL) HANDLE_ERROR;
 		  $<ctxt>$ = start_element(ELT_FAM_WIFE,
 					   PARENT, $1, $3, $4, 
@@ -1013,8 +1053,8 @@ fam_wife_sect : OPEN DELIM TAG_WIFE mand_pointer
 
 /* FAM.CHIL */
 fam_chil_sect : OPEN DELIM TAG_CHIL mand_pointer
-                { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							    XREF_INDI);
+                { struct xref_value *xr
+		      = PARSE_XREF(ELT_FAM_CHIL, $4, XREF_USED, XREF_INDI);
 		  if (xr == NULL) HANDLE_ERROR;
 		  $<ctxt>$ = start_element(ELT_FAM_CHIL,
 					   PARENT, $1, $3, $4, 
@@ -1046,8 +1086,8 @@ fam_nchi_sect : OPEN DELIM TAG_NCHI mand_line_item
 
 /* FAM.SUBM */
 fam_subm_sect : OPEN DELIM TAG_SUBM mand_pointer
-                { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							    XREF_SUBM);
+                { struct xref_value *xr
+		      = PARSE_XREF(ELT_FAM_SUBM, $4, XREF_USED, XREF_SUBM);
 		  if (xr == NULL) HANDLE_ERROR;
 		  $<ctxt>$ = start_element(ELT_FAM_SUBM,
 					   PARENT, $1, $3, $4, 
@@ -1066,8 +1106,8 @@ fam_subm_sect : OPEN DELIM TAG_SUBM mand_pointer
 /**** Individual record                                           ****/
 /*********************************************************************/
 indiv_rec   : OPEN DELIM POINTER DELIM TAG_INDI
-              { struct xref_value *xr = gedcom_parse_xref($3, XREF_DEFINED,
-							  XREF_INDI);
+              { struct xref_value *xr
+		    = PARSE_XREF(REC_INDI, $3, XREF_DEFINED, XREF_INDI);
 	        if (xr == NULL) HANDLE_ERROR;
 		$<ctxt>$ = start_record(REC_INDI,
 					$1, GEDCOM_MAKE_XREF_PTR(val1, xr), $5,
@@ -1144,8 +1184,8 @@ indi_sex_sect  : OPEN DELIM TAG_SEX mand_line_item
 
 /* INDI.SUBM */
 indi_subm_sect : OPEN DELIM TAG_SUBM mand_pointer 
-                 { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							     XREF_SUBM);
+                 { struct xref_value *xr
+		       = PARSE_XREF(ELT_INDI_SUBM, $4, XREF_USED, XREF_SUBM);
 		   if (xr == NULL) HANDLE_ERROR;
 		   $<ctxt>$ = start_element(ELT_INDI_SUBM,
 					    PARENT, $1, $3, $4, 
@@ -1162,8 +1202,8 @@ indi_subm_sect : OPEN DELIM TAG_SUBM mand_pointer
 
 /* INDI.ALIA */
 indi_alia_sect : OPEN DELIM TAG_ALIA mand_pointer
-                 { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							     XREF_INDI);
+                 { struct xref_value *xr
+		       = PARSE_XREF(ELT_INDI_ALIA, $4, XREF_USED, XREF_INDI);
 		   if (xr == NULL) HANDLE_ERROR;
 		   $<ctxt>$ = start_element(ELT_INDI_ALIA,
 					    PARENT, $1, $3, $4, 
@@ -1180,8 +1220,8 @@ indi_alia_sect : OPEN DELIM TAG_ALIA mand_pointer
 
 /* INDI.ANCI */
 indi_anci_sect : OPEN DELIM TAG_ANCI mand_pointer
-                 { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							     XREF_SUBM);
+                 { struct xref_value *xr
+		       = PARSE_XREF(ELT_INDI_ANCI, $4, XREF_USED, XREF_SUBM);
 		   if (xr == NULL) HANDLE_ERROR;
 		   $<ctxt>$ = start_element(ELT_INDI_ANCI,
 					    PARENT, $1, $3, $4, 
@@ -1198,8 +1238,8 @@ indi_anci_sect : OPEN DELIM TAG_ANCI mand_pointer
 
 /* INDI.DESI */
 indi_desi_sect : OPEN DELIM TAG_DESI mand_pointer
-                 { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							     XREF_SUBM);
+                 { struct xref_value *xr
+		       = PARSE_XREF(ELT_INDI_DESI, $4, XREF_USED, XREF_SUBM);
 		   if (xr == NULL) HANDLE_ERROR;
 		   $<ctxt>$ = start_element(ELT_INDI_DESI,
 					    PARENT, $1, $3, $4, 
@@ -1254,7 +1294,7 @@ indi_addr_sect : OPEN DELIM TAG_ADDR opt_line_item
 					par, $1 + 1, $3, $4,
 					GEDCOM_MAKE_NULL_OR_STRING(val2, $4));
 		      reset_buffer(&concat_buffer);
-		      safe_buf_append(&concat_buffer, $4);
+		      safe_buf_addstr(&concat_buffer, $4);
 		      START(ADDR, $1 + 1, $<ctxt>$);
 		    }
 		  else { START(ADDR, $1, NULL) }
@@ -1301,8 +1341,8 @@ ftree_addr_phon_sect : OPEN DELIM TAG_PHON mand_line_item
 /**** Multimedia record                                           ****/
 /*********************************************************************/
 multim_rec  : OPEN DELIM POINTER DELIM TAG_OBJE
-              { struct xref_value *xr = gedcom_parse_xref($3, XREF_DEFINED,
-							  XREF_OBJE);
+              { struct xref_value *xr
+		    = PARSE_XREF(REC_OBJE, $3, XREF_DEFINED, XREF_OBJE);
 	        if (xr == NULL) HANDLE_ERROR;
 		$<ctxt>$ = start_record(REC_OBJE,
 					$1, GEDCOM_MAKE_XREF_PTR(val1, xr), $5,
@@ -1387,7 +1427,7 @@ obje_blob_cont_sect : OPEN DELIM TAG_CONT mand_line_item
                       { $<ctxt>$ = start_element(ELT_OBJE_BLOB_CONT,
 					         PARENT, $1, $3, $4, 
 						 GEDCOM_MAKE_STRING(val1, $4));
-		        safe_buf_append(&concat_buffer, $4);
+		        safe_buf_addstr(&concat_buffer, $4);
 		        START(CONT, $1, $<ctxt>$)               
 		      }                
 		      no_std_subs                
@@ -1400,8 +1440,8 @@ obje_blob_cont_sect : OPEN DELIM TAG_CONT mand_line_item
 
 /* OBJE.OBJE */
 obje_obje_sect : OPEN DELIM TAG_OBJE mand_pointer 
-                 { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							     XREF_OBJE);
+                 { struct xref_value *xr
+		       = PARSE_XREF(ELT_OBJE_OBJE, $4, XREF_USED, XREF_OBJE);
 		   if (xr == NULL) HANDLE_ERROR;
 		   $<ctxt>$ = start_element(ELT_OBJE_OBJE,
 					    PARENT, $1, $3, $4, 
@@ -1420,14 +1460,14 @@ obje_obje_sect : OPEN DELIM TAG_OBJE mand_pointer
 /**** Note record                                                 ****/
 /*********************************************************************/
 note_rec    : OPEN DELIM POINTER DELIM TAG_NOTE note_line_item
-              { struct xref_value *xr = gedcom_parse_xref($3, XREF_DEFINED,
-							  XREF_NOTE);
+              { struct xref_value *xr
+		    = PARSE_XREF(REC_NOTE, $3, XREF_DEFINED, XREF_NOTE);
 	        if (xr == NULL) HANDLE_ERROR;
 		$<ctxt>$ = start_record(REC_NOTE,
 					$1, GEDCOM_MAKE_XREF_PTR(val1, xr), $5,
 					$6, GEDCOM_MAKE_STRING(val2, $6));
 		reset_buffer(&concat_buffer);
-		safe_buf_append(&concat_buffer, $6);
+		safe_buf_addstr(&concat_buffer, $6);
 		START(NOTE, $1, $<ctxt>$) }
               note_subs
 	      { CHECK0 }
@@ -1473,7 +1513,7 @@ note_note_sect : OPEN DELIM TAG_NOTE opt_line_item
 				       GEDCOM_MAKE_NULL_OR_STRING(val1, $4));
 	      SAFE_BUF_ADDCHAR(&concat_buffer, '\n');
 	      if (GEDCOM_IS_STRING(&val1))
-	        safe_buf_append(&concat_buffer, $4);
+	        safe_buf_addstr(&concat_buffer, $4);
 	      START(CONT, $1, $<ctxt>$)  
             }  
             no_std_subs  
@@ -1488,8 +1528,8 @@ note_note_sect : OPEN DELIM TAG_NOTE opt_line_item
 /**** Repository record                                           ****/
 /*********************************************************************/
 repos_rec   : OPEN DELIM POINTER DELIM TAG_REPO
-              { struct xref_value *xr = gedcom_parse_xref($3, XREF_DEFINED,
-							  XREF_REPO);
+              { struct xref_value *xr
+		    = PARSE_XREF(REC_REPO, $3, XREF_DEFINED, XREF_REPO);
 	        if (xr == NULL) HANDLE_ERROR;
 		$<ctxt>$ = start_record(REC_REPO,
 					$1, GEDCOM_MAKE_XREF_PTR(val1, xr), $5,
@@ -1532,8 +1572,8 @@ repo_name_sect : OPEN DELIM TAG_NAME mand_line_item
 /**** Source record                                               ****/
 /*********************************************************************/
 source_rec  : OPEN DELIM POINTER DELIM TAG_SOUR
-              { struct xref_value *xr = gedcom_parse_xref($3, XREF_DEFINED,
-							  XREF_SOUR);
+              { struct xref_value *xr
+		    = PARSE_XREF(REC_SOUR, $3, XREF_DEFINED, XREF_SOUR);
 	        if (xr == NULL) HANDLE_ERROR;
 		$<ctxt>$ = start_record(REC_SOUR,
 					$1, GEDCOM_MAKE_XREF_PTR(val1, xr), $5,
@@ -1630,11 +1670,11 @@ sour_data_even_sub  : sour_data_even_date_sect { OCCUR2(DATE, 0, 1) }
                     ;
 
 sour_data_even_date_sect : OPEN DELIM TAG_DATE mand_line_item          
-                           { struct date_value dv = gedcom_parse_date($4);
+                           { Gedcom_val val
+			         = PARSE_DATE(ELT_SOUR_DATA_EVEN_DATE, $4);
 			     $<ctxt>$
 			       = start_element(ELT_SOUR_DATA_EVEN_DATE,
-					       PARENT, $1, $3, $4, 
-					       GEDCOM_MAKE_DATE(val1, dv));
+					       PARENT, $1, $3, $4, val);
 		             START(DATE, $1, $<ctxt>$)           
                            }           
                            no_std_subs           
@@ -1680,7 +1720,7 @@ sour_auth_sect : OPEN DELIM TAG_AUTH mand_line_item
 					    PARENT, $1, $3, $4, 
 					    GEDCOM_MAKE_STRING(val1, $4));
 		   reset_buffer(&concat_buffer);
-		   safe_buf_append(&concat_buffer, $4);
+		   safe_buf_addstr(&concat_buffer, $4);
 		   START(AUTH, $1, $<ctxt>$) 
                  }
                  sour_auth_subs
@@ -1706,7 +1746,7 @@ sour_titl_sect : OPEN DELIM TAG_TITL mand_line_item
 					    PARENT, $1, $3, $4, 
 					    GEDCOM_MAKE_STRING(val1, $4));
 		   reset_buffer(&concat_buffer);
-		   safe_buf_append(&concat_buffer, $4);
+		   safe_buf_addstr(&concat_buffer, $4);
 		   START(TITL, $1, $<ctxt>$)   
                  }
                  sour_titl_subs 
@@ -1747,7 +1787,7 @@ sour_publ_sect : OPEN DELIM TAG_PUBL mand_line_item
 					    PARENT, $1, $3, $4, 
 					    GEDCOM_MAKE_STRING(val1, $4));
 		   reset_buffer(&concat_buffer);
-		   safe_buf_append(&concat_buffer, $4);
+		   safe_buf_addstr(&concat_buffer, $4);
 		   START(PUBL, $1, $<ctxt>$)            
                  }
                  sour_publ_subs  
@@ -1773,7 +1813,7 @@ sour_text_sect : OPEN DELIM TAG_TEXT mand_line_item
 					    PARENT, $1, $3, $4, 
 					    GEDCOM_MAKE_STRING(val1, $4));
 		   reset_buffer(&concat_buffer);
-		   safe_buf_append(&concat_buffer, $4);
+		   safe_buf_addstr(&concat_buffer, $4);
 		   START(TEXT, $1, $<ctxt>$)    
                  }
                  sour_text_subs  
@@ -1881,8 +1921,8 @@ sour_page_sect : OPEN DELIM TAG_PAGE opt_line_item
 /**** Submission record                                           ****/
 /*********************************************************************/
 submis_rec  : OPEN DELIM POINTER DELIM TAG_SUBN    
-              { struct xref_value *xr = gedcom_parse_xref($3, XREF_DEFINED,
-							  XREF_SUBN);
+              { struct xref_value *xr
+		    = PARSE_XREF(REC_SUBN, $3, XREF_DEFINED, XREF_SUBN);
 	        if (xr == NULL) HANDLE_ERROR;
 		$<ctxt>$ = start_record(REC_SUBN,
 					$1, GEDCOM_MAKE_XREF_PTR(val1, xr), $5,
@@ -1910,8 +1950,8 @@ subn_sub    : subn_subm_sect  { OCCUR2(SUBM, 0, 1) }
 
 /* SUBN.SUBM */
 subn_subm_sect : OPEN DELIM TAG_SUBM mand_pointer
-                 { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							     XREF_SUBM);
+                 { struct xref_value *xr
+		       = PARSE_XREF(ELT_SUBN_SUBM, $4, XREF_USED, XREF_SUBM);
 		   if (xr == NULL) HANDLE_ERROR;
 		   $<ctxt>$ = start_element(ELT_SUBN_SUBM,
 					    PARENT, $1, $3, $4, 
@@ -2020,8 +2060,8 @@ subn_rin_sect  : OPEN DELIM TAG_RIN mand_line_item
 /**** Submitter record                                            ****/
 /*********************************************************************/
 submit_rec : OPEN DELIM POINTER DELIM TAG_SUBM    
-             { struct xref_value *xr = gedcom_parse_xref($3, XREF_DEFINED,
-							 XREF_SUBM);
+             { struct xref_value *xr
+	           = PARSE_XREF(REC_SUBM, $3, XREF_DEFINED, XREF_SUBM);
 	       if (xr == NULL) HANDLE_ERROR;
 	       $<ctxt>$ = start_record(REC_SUBM,
 				       $1, GEDCOM_MAKE_XREF_PTR(val1, xr), $5,
@@ -2140,7 +2180,7 @@ addr_sect   : OPEN DELIM TAG_ADDR mand_line_item
 					 PARENT, $1, $3, $4, 
 					 GEDCOM_MAKE_STRING(val1, $4));
 	        reset_buffer(&concat_buffer);
-		safe_buf_append(&concat_buffer, $4);
+		safe_buf_addstr(&concat_buffer, $4);
 	        START(ADDR, $1, $<ctxt>$);
 		if (compat_mode(C_SUBM_CTRY))
 		  compat_save_ctry_parent_context($<ctxt>$);
@@ -2173,7 +2213,7 @@ addr_cont_sect : OPEN DELIM TAG_CONT mand_line_item
 					    PARENT, $1, $3, $4, 
 					    GEDCOM_MAKE_STRING(val1, $4));
 		   SAFE_BUF_ADDCHAR(&concat_buffer, '\n');
-		   safe_buf_append(&concat_buffer, $4);
+		   safe_buf_addstr(&concat_buffer, $4);
 		   START(CONT, $1, $<ctxt>$)               
                  }               
                  no_std_subs               
@@ -2281,8 +2321,8 @@ assoc_struc_sub : asso_sect /* 0:M */
                 ;
 
 asso_sect : OPEN DELIM TAG_ASSO mand_pointer
-            { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							XREF_ANY);
+            { struct xref_value *xr
+	          = PARSE_XREF(ELT_SUB_ASSO, $4, XREF_USED, XREF_ANY);
 	      if (xr == NULL) HANDLE_ERROR;
 	      $<ctxt>$ = start_element(ELT_SUB_ASSO,
 				       PARENT, $1, $3, $4, 
@@ -2361,10 +2401,9 @@ change_date_chan_sub  : change_date_date_sect  { OCCUR2(DATE, 1, 1) }
                       ;
 
 change_date_date_sect : OPEN DELIM TAG_DATE mand_line_item 
-                        { struct date_value dv = gedcom_parse_date($4);
+                        { Gedcom_val val = PARSE_DATE(ELT_SUB_CHAN_DATE, $4);
 			  $<ctxt>$ = start_element(ELT_SUB_CHAN_DATE,
-						   PARENT, $1, $3, $4, 
-						   GEDCOM_MAKE_DATE(val1, dv));
+						   PARENT, $1, $3, $4, val);
 			  START(DATE, $1, $<ctxt>$) }
                         change_date_date_subs
 			{ CHECK0 }
@@ -2402,8 +2441,8 @@ chi_fam_link_sub : famc_sect  /* 0:M */
                  ;
 
 famc_sect : OPEN DELIM TAG_FAMC mand_pointer
-            { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-							  XREF_FAM);
+            { struct xref_value *xr
+	          = PARSE_XREF(ELT_SUB_FAMC, $4, XREF_USED, XREF_FAM);
 	      if (xr == NULL) HANDLE_ERROR;
 	      $<ctxt>$ = start_element(ELT_SUB_FAMC,
 				       PARENT, $1, $3, $4, 
@@ -2452,7 +2491,7 @@ cont_sect : OPEN DELIM TAG_CONT opt_line_item
 				       GEDCOM_MAKE_NULL_OR_STRING(val1, $4));
 	      SAFE_BUF_ADDCHAR(&concat_buffer, '\n');
 	      if (GEDCOM_IS_STRING(&val1))
-	        safe_buf_append(&concat_buffer, $4);
+	        safe_buf_addstr(&concat_buffer, $4);
 	      START(CONT, $1, $<ctxt>$)  
             }  
             cont_conc_subs  
@@ -2468,9 +2507,9 @@ conc_sect : OPEN DELIM TAG_CONC mand_line_item
 				       PARENT, $1, $3, $4, 
 				       GEDCOM_MAKE_STRING(val1, $4));
 	      if (compat_mode(C_CONC_NEEDS_SPACE)) {
-		safe_buf_append(&concat_buffer, " ");
+		SAFE_BUF_ADDCHAR(&concat_buffer, ' ');
 	      }
-	      safe_buf_append(&concat_buffer, $4);
+	      safe_buf_addstr(&concat_buffer, $4);
 	      START(CONC, $1, $<ctxt>$)  
             }  
             cont_conc_subs  
@@ -2536,11 +2575,10 @@ event_detail_type_sect : OPEN DELIM TAG_TYPE mand_line_item
 			 }
                        ;
 event_detail_date_sect : OPEN DELIM TAG_DATE mand_line_item 
-                         { struct date_value dv = gedcom_parse_date($4);
+                         { Gedcom_val val = PARSE_DATE(ELT_SUB_EVT_DATE, $4);
 			   $<ctxt>$
 			     = start_element(ELT_SUB_EVT_DATE,
-					     PARENT, $1, $3, $4, 
-					     GEDCOM_MAKE_DATE(val1, dv));
+					     PARENT, $1, $3, $4, val);
 			   START(DATE, $1, $<ctxt>$)  
                          }  
                          no_std_subs  
@@ -2551,11 +2589,10 @@ event_detail_date_sect : OPEN DELIM TAG_DATE mand_line_item
 			 }
                        ;
 event_detail_age_sect  : OPEN DELIM TAG_AGE mand_line_item 
-                         { struct age_value age = gedcom_parse_age($4);
+                         { Gedcom_val val = PARSE_AGE(ELT_SUB_EVT_AGE, $4);
 			   $<ctxt>$
 			     = start_element(ELT_SUB_EVT_AGE,
-					     PARENT, $1, $3, $4, 
-					     GEDCOM_MAKE_AGE(val1, age));
+					     PARENT, $1, $3, $4, val);
 			   START(AGE, $1, $<ctxt>$)  
                          }  
                          no_std_subs  
@@ -2659,10 +2696,9 @@ fam_even_husb_sub : fam_even_age_sect  { OCCUR2(AGE, 1, 1) }
                   ;
 
 fam_even_age_sect : OPEN DELIM TAG_AGE mand_line_item  
-                    { struct age_value age = gedcom_parse_age($4);
+                    { Gedcom_val val = PARSE_AGE(ELT_SUB_FAM_EVT_AGE, $4);
 		      $<ctxt>$ = start_element(ELT_SUB_FAM_EVT_AGE,
-					       PARENT, $1, $3, $4,
-					       GEDCOM_MAKE_AGE(val1, age));
+					       PARENT, $1, $3, $4, val);
 		      START(AGE, $1, $<ctxt>$)   
                     }   
                     no_std_subs   
@@ -2858,9 +2894,9 @@ indiv_birt_sub  : event_detail_sub
                 ;
 
 indiv_birt_famc_sect : OPEN DELIM TAG_FAMC mand_pointer
-                       { struct xref_value *xr = gedcom_parse_xref($4,
-								   XREF_USED,
-								   XREF_FAM);
+                       { struct xref_value *xr
+			     = PARSE_XREF(ELT_SUB_INDIV_BIRT_FAMC, $4, XREF_USED,
+					  XREF_FAM);
 		         if (xr == NULL) HANDLE_ERROR;
 			 $<ctxt>$
 			   = start_element(ELT_SUB_INDIV_BIRT_FAMC,
@@ -2944,9 +2980,9 @@ indiv_adop_sub  : event_detail_sub
                 ;
 
 indiv_adop_famc_sect : OPEN DELIM TAG_FAMC mand_pointer
-                       { struct xref_value *xr = gedcom_parse_xref($4,
-								   XREF_USED,
-								   XREF_FAM);
+                       { struct xref_value *xr
+			     = PARSE_XREF(ELT_SUB_INDIV_ADOP_FAMC, $4, XREF_USED,
+					  XREF_FAM);
 		         if (xr == NULL) HANDLE_ERROR;
 			 $<ctxt>$
 			   = start_element(ELT_SUB_INDIV_ADOP_FAMC,
@@ -3048,10 +3084,9 @@ lio_bapl_stat_sect : OPEN DELIM TAG_STAT mand_line_item
 		     }
                    ;
 lio_bapl_date_sect : OPEN DELIM TAG_DATE mand_line_item   
-                     { struct date_value dv = gedcom_parse_date($4);
+                     { Gedcom_val val = PARSE_DATE(ELT_SUB_LIO_BAPL_DATE, $4);
 		       $<ctxt>$ = start_element(ELT_SUB_LIO_BAPL_DATE,
-						PARENT, $1, $3, $4,
-						GEDCOM_MAKE_DATE(val1, dv));
+						PARENT, $1, $3, $4, val);
 		       START(DATE, $1, $<ctxt>$)    
                      }    
                      no_std_subs    
@@ -3115,8 +3150,9 @@ lio_slgc_sub  : lio_bapl_sub
               ;
 
 lio_slgc_famc_sect : OPEN DELIM TAG_FAMC mand_pointer
-                     { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-								 XREF_FAM);
+                     { struct xref_value *xr
+		           = PARSE_XREF(ELT_SUB_LIO_SLGC_FAMC, $4, XREF_USED,
+					XREF_FAM);
 		       if (xr == NULL) HANDLE_ERROR;
 		       $<ctxt>$
 			 = start_element(ELT_SUB_LIO_SLGC_FAMC,
@@ -3176,10 +3212,9 @@ lss_slgs_stat_sect : OPEN DELIM TAG_STAT mand_line_item
 		     }
                    ;
 lss_slgs_date_sect : OPEN DELIM TAG_DATE mand_line_item   
-                     { struct date_value dv = gedcom_parse_date($4);
+                     { Gedcom_val val = PARSE_DATE(ELT_SUB_LSS_SLGS_DATE, $4);
 		       $<ctxt>$ = start_element(ELT_SUB_LSS_SLGS_DATE,
-						PARENT, $1, $3, $4,
-						GEDCOM_MAKE_DATE(val1, dv));
+						PARENT, $1, $3, $4, val);
 		       START(DATE, $1, $<ctxt>$)    
                      }    
                      no_std_subs    
@@ -3222,9 +3257,9 @@ multim_link_sub : multim_obje_link_sect
                 ;
 
 multim_obje_link_sect : OPEN DELIM TAG_OBJE DELIM POINTER    
-                        { struct xref_value *xr = gedcom_parse_xref($5,
-								    XREF_USED,
-								    XREF_OBJE);
+                        { struct xref_value *xr
+			      = PARSE_XREF(ELT_SUB_MULTIM_OBJE, $5, XREF_USED,
+					   XREF_OBJE);
 			  if (xr == NULL) HANDLE_ERROR;
 			  $<ctxt>$
 			    = start_element(ELT_SUB_MULTIM_OBJE,
@@ -3317,9 +3352,9 @@ note_struc_sub : note_struc_link_sect  /* 0:M */
                ;
 
 note_struc_link_sect : OPEN DELIM TAG_NOTE DELIM POINTER
-                       { struct xref_value *xr = gedcom_parse_xref($5,
-								   XREF_USED,
-								   XREF_NOTE);
+                       { struct xref_value *xr
+			     = PARSE_XREF(ELT_SUB_NOTE, $5, XREF_USED,
+					  XREF_NOTE);
 		         if (xr == NULL) HANDLE_ERROR;
 		         $<ctxt>$
 			   = start_element(ELT_SUB_NOTE,
@@ -3353,7 +3388,7 @@ note_struc_emb_sect : OPEN DELIM TAG_NOTE opt_line_item
 					GEDCOM_MAKE_NULL_OR_STRING(val1, str));
 		        reset_buffer(&concat_buffer);
 			if ($4)
-			  safe_buf_append(&concat_buffer, $4);
+			  safe_buf_addstr(&concat_buffer, $4);
 		        START(NOTE, $1, $<ctxt>$);
 			if (compat_mode(C_NOTE_TOO_LONG))
 			  compat_long_line_finish($<ctxt>$, $1);
@@ -3538,9 +3573,9 @@ source_cit_sub : source_cit_link_sect /* 0:M */
                ;
 
 source_cit_link_sect : OPEN DELIM TAG_SOUR DELIM POINTER
-                       { struct xref_value *xr = gedcom_parse_xref($5,
-								   XREF_USED,
-								   XREF_SOUR);
+                       { struct xref_value *xr
+			     = PARSE_XREF(ELT_SUB_SOUR, $5, XREF_USED,
+					  XREF_SOUR);
 		         if (xr == NULL) HANDLE_ERROR;
 			 $<ctxt>$
 			   = start_element(ELT_SUB_SOUR,
@@ -3647,11 +3682,11 @@ source_cit_data_sub : source_cit_data_date_sect  { OCCUR2(DATE, 0, 1) }
                     ;
 
 source_cit_data_date_sect : OPEN DELIM TAG_DATE mand_line_item    
-                            { struct date_value dv = gedcom_parse_date($4);
+                            { Gedcom_val val
+			          = PARSE_DATE(ELT_SUB_SOUR_DATA_DATE, $4);
 			      $<ctxt>$
 				= start_element(ELT_SUB_SOUR_DATA_DATE,
-						PARENT, $1, $3, $4,
-						GEDCOM_MAKE_DATE(val1, dv));
+						PARENT, $1, $3, $4, val);
 			      START(DATE, $1, $<ctxt>$)     
                             }     
                             no_std_subs     
@@ -3669,7 +3704,7 @@ source_cit_text_sect : OPEN DELIM TAG_TEXT mand_line_item
 					   PARENT, $1, $3, $4,
 					   GEDCOM_MAKE_STRING(val1, $4));
 		        reset_buffer(&concat_buffer);
-		        safe_buf_append(&concat_buffer, $4);
+		        safe_buf_addstr(&concat_buffer, $4);
 		        START(TEXT, $1, $<ctxt>$)  
                        }
                        source_cit_text_subs
@@ -3709,7 +3744,7 @@ source_cit_emb_sect : OPEN DELIM TAG_SOUR mand_line_item
 						 PARENT, $1, $3, $4,
 						 GEDCOM_MAKE_STRING(val1, $4));
 		        reset_buffer(&concat_buffer);
-		        safe_buf_append(&concat_buffer, $4);
+		        safe_buf_addstr(&concat_buffer, $4);
 		        START(SOUR, $1, $<ctxt>$) 
                       }
                       source_cit_emb_subs
@@ -3756,7 +3791,8 @@ source_repos_repo_txt_sect : OPEN DELIM TAG_REPO opt_line_item
 
 source_repos_repo_sect : OPEN DELIM TAG_REPO DELIM POINTER
                          { struct xref_value *xr
-			     = gedcom_parse_xref($5, XREF_USED, XREF_REPO);
+			       = PARSE_XREF(ELT_SUB_REPO, $5, XREF_USED,
+					    XREF_REPO);
 			   if (xr == NULL) HANDLE_ERROR;
 			   $<ctxt>$
 			     = start_element(ELT_SUB_REPO,
@@ -3822,8 +3858,8 @@ spou_fam_link_sub : spou_fam_fams_sect  /* 0:M */
                   ;
 
 spou_fam_fams_sect : OPEN DELIM TAG_FAMS mand_pointer
-                     { struct xref_value *xr = gedcom_parse_xref($4, XREF_USED,
-								 XREF_FAM);
+                     { struct xref_value *xr
+		           = PARSE_XREF(ELT_SUB_FAMS, $4, XREF_USED, XREF_FAM);
 		       if (xr == NULL) HANDLE_ERROR;
 		       $<ctxt>$
 			 = start_element(ELT_SUB_FAMS,
@@ -3886,7 +3922,7 @@ user_rec    : OPEN DELIM opt_xref USERTAG
               opt_value
               { struct xref_value *xr = NULL;
 	        if ($3 != NULL) {
-		  xr = gedcom_parse_xref($3, XREF_DEFINED, XREF_USER);
+		  xr = PARSE_XREF(REC_USER, $3, XREF_DEFINED, XREF_USER);
 		  if (xr == NULL) HANDLE_ERROR;
 		}
 		$<ctxt>$ = start_record(REC_USER,
@@ -3984,36 +4020,20 @@ opt_line_item : /* empty */     { $$ = NULL; }
 	                          $$ = $2; }
               ;
 
-line_item   : anychar  { size_t i;
-                         reset_buffer(&line_item_buffer); 
-		         /* The following also takes care of '@@' */
-			 if (!strncmp($1, "@@", 3))
-			   SAFE_BUF_ADDCHAR(&line_item_buffer, '@')
-			 else
-			   for (i=0; i < strlen($1); i++)
-			     SAFE_BUF_ADDCHAR(&line_item_buffer, $1[i])
+line_item   : anychar  { reset_buffer(&line_item_buffer); 
+		         add_to_line_item($1);
 			 $$ = get_buf_string(&line_item_buffer);
                        }
-            | ESCAPE   { size_t i;
-                         reset_buffer(&line_item_buffer); 
-		         for (i=0; i < strlen($1); i++)
-			   SAFE_BUF_ADDCHAR(&line_item_buffer, $1[i])
+            | ESCAPE   { reset_buffer(&line_item_buffer); 
+		         safe_buf_addstr(&line_item_buffer, $1);
 			 $$ = get_buf_string(&line_item_buffer);
 	               }
             | line_item anychar
-                  { size_t i;
-		    /* The following also takes care of '@@' */
-		    if (!strncmp($2, "@@", 3))
-		      SAFE_BUF_ADDCHAR(&line_item_buffer, '@')
-		    else
-		      for (i=0; i < strlen($2); i++)
-			SAFE_BUF_ADDCHAR(&line_item_buffer, $2[i])
+                  { add_to_line_item($2);
 		    $$ = get_buf_string(&line_item_buffer);
 		  }
             | line_item ESCAPE
-                  { size_t i;
-		    for (i=0; i < strlen($2); i++)
-		      SAFE_BUF_ADDCHAR(&line_item_buffer, $2[i])
+                  { safe_buf_addstr(&line_item_buffer, $2);
 		    $$ = get_buf_string(&line_item_buffer);
 		  }
             | line_item error anychar { HANDLE_ERROR; }
@@ -4021,6 +4041,7 @@ line_item   : anychar  { size_t i;
             ;
 
 anychar     : ANYCHAR        { }
+            | ANYSTRING      { }
             | DELIM        { }
             ;
 
@@ -4218,13 +4239,20 @@ anystdtag   : TAG_ABBR
 
 /* Functions that handle the counting of subtags */
 
-int* count_arrays[MAXGEDCLEVEL+1];
-char tag_stack[MAXGEDCLEVEL+1][MAXSTDTAGLEN+1];
-Gedcom_ctxt ctxt_stack[MAXGEDCLEVEL+1];
+/* The counts of the subtags of an open element.  There is one such array
+   per level, which is allocated the first time the level is used and then
+   reused for all elements on that level.  A count is only valid if its
+   stamp is equal to the generation of the array; starting a new element
+   just increments the generation, so nothing needs to be cleared */
+struct count_array {
+  unsigned int generation;
+  unsigned int stamp[YYNTOKENS];
+  int          count[YYNTOKENS];
+};
 
 void push_countarray(int level)
 {
-  int *count = NULL;
+  struct count_array *count = NULL;
   gedcom_debug_print("Push Count level: %d, level: %d", count_level, level);
   if (count_level != level + 1) {
     gedcom_error(_("Internal error: count level mismatch"));
@@ -4235,15 +4263,21 @@ void push_countarray(int level)
     exit(1);
   }
   else {
-    gedcom_debug_print("calloc countarray %d", count_level);
-    count = (int *)calloc(YYNTOKENS, sizeof(int));
+    count = count_arrays[count_level];
     if (count == NULL) {
-      gedcom_error(_("Internal error: count array calloc error"));
-      exit(1);
-    }
-    else {
+      gedcom_debug_print("calloc countarray %d", count_level);
+      count = (struct count_array *)calloc(1, sizeof(struct count_array));
+      if (count == NULL) {
+	gedcom_error(_("Internal error: count array calloc error"));
+	exit(1);
+      }
       count_arrays[count_level] = count;
     }
+    if (++count->generation == 0) {
+      /* Wrapped around: the old stamps could become valid again */
+      memset(count->stamp, 0, sizeof(count->stamp));
+      count->generation = 1;
+    }
   }
 }
 
@@ -4269,30 +4303,29 @@ Gedcom_ctxt get_parentctxt(int offset)
 
 int count_tag(int tag)
 {
-  int *count = count_arrays[count_level];
-  return ++count[tag - GEDCOMTAGOFFSET];
+  struct count_array *count = count_arrays[count_level];
+  int i = tag - GEDCOMTAGOFFSET;
+  if (count->stamp[i] != count->generation) {
+    count->stamp[i] = count->generation;
+    count->count[i] = 0;
+  }
+  return ++count->count[i];
 }
 
 int check_occurrence(int tag)
 {
-  int *count = count_arrays[count_level];
-  return (count[tag - GEDCOMTAGOFFSET] > 0);
+  struct count_array *count = count_arrays[count_level];
+  int i = tag - GEDCOMTAGOFFSET;
+  return (count->stamp[i] == count->generation && count->count[i] > 0);
 }
 
 void pop_countarray()
 {
-  int *count;
   gedcom_debug_print("Pop Count level: %d", count_level);
   if (count_level < 0) {
     gedcom_error(_("Internal error: count array underflow"));
     exit(1);
   }
-  else {
-    count = count_arrays[count_level];
-    gedcom_debug_print("free countarray %d", count_level);
-    free(count);
-    count_arrays[count_level] = NULL;
-  }
 }
 
 void clean_up()
@@ -4304,19 +4337,37 @@ void clean_up()
   }
 }
 
-void cleanup_concat_buffer()
-{
-  cleanup_buffer(&concat_buffer);
-}
-
-void cleanup_line_item_buffer()
+/* Frees the count arrays of the current parser (when the parser is freed) */
+void cleanup_countarrays()
 {
-  cleanup_buffer(&line_item_buffer);
+  int i;
+  for (i = 0; i <= MAXGEDCLEVEL; i++) {
+    free(count_arrays[i]);
+    count_arrays[i] = NULL;
+  }
 }
 
-void cleanup_usertag_buffer()
+/* Adds a piece of a line value (a character, a run of characters or a
+   delimiter) to the line item buffer.  This also takes care of '@@', and
+   of the tabs that are allowed in compatibility mode */
+void add_to_line_item(const char* str)
 {
-  cleanup_buffer(&usertag_buffer);
+  const char* s = str;
+  while (*s) {
+    size_t run = strcspn(s, "\t@");
+    if (run > 0) {
+      safe_buf_addmem(&line_item_buffer, s, run);
+      s += run;
+    }
+    else if (*s == '\t') {
+      safe_buf_addmem(&line_item_buffer, "        ", 8);
+      s++;
+    }
+    else {
+      SAFE_BUF_ADDCHAR(&line_item_buffer, '@')
+      s += (s[1] == '@' ? 2 : 1);
+    }
+  }
 }
 
 FILE* trace_output;
@@ -25,6 +25,10 @@
 #include <stdlib.h>
 #include "date.h"
 #include "compat.h"
+#include "parser.h"
+
+/* The lexer is reentrant, and works on the scanner of the current parser */
+#define gedcom_date_lex gedcom_date_lex_current
 
 int _get_day_num(const char* input);
 int _get_year_num(Year_type ytype, const char* input1, const char* input2);
@@ -33,6 +37,8 @@ void error_missing_month();
   
 %}
 
+%pure_parser
+
 %union {
   char *string;
   struct date_value date_val;
@@ -134,15 +140,20 @@ date_value   : date           { make_date_value(DV_NO_MODIFIER,
              ;
 
 date         : ESC_DATE_GREG date_greg { copy_date(&$$, &date_s);
-                                         $$.cal = CAL_GREGORIAN; }
+                                         $$.cal = CAL_GREGORIAN;
+                                         init_date(&date_s); }
              | ESC_DATE_JULN date_juln { copy_date(&$$, &date_s);
-                                         $$.cal = CAL_JULIAN;  }
+                                         $$.cal = CAL_JULIAN;
+                                         init_date(&date_s); }
              | ESC_DATE_HEBR date_hebr { copy_date(&$$, &date_s);
-                                         $$.cal = CAL_HEBREW;  }
+                                         $$.cal = CAL_HEBREW;
+                                         init_date(&date_s); }
              | ESC_DATE_FREN date_fren { copy_date(&$$, &date_s);
-                                         $$.cal = CAL_FRENCH_REV;  }
+                                         $$.cal = CAL_FRENCH_REV;
+                                         init_date(&date_s); }
              | date_greg               { copy_date(&$$, &date_s);
-                                         $$.cal = CAL_GREGORIAN;  }
+                                         $$.cal = CAL_GREGORIAN;
+                                         init_date(&date_s); }
              ;
 
 date_period  : MOD_FROM date   { make_date_value(DV_FROM,
@@ -57,23 +57,17 @@ struct tag_struct {
   int value;
 };
 
-typedef enum _PARSE_STATE {
-  STATE_NORMAL,
-  STATE_INITIAL,
-  STATE_EXPECT_TAG
-} ParseState;
-
 int  gedcom_parse();
 int  gedcom_lex();
-int  gedcom_check_token(const char* str, ParseState state, int check_token);
 void gedcom_enable_internal_debug();
 
 void gedcom_mem_error(const char *filename, int line);
+void reset_message_counts();
+void cleanup_messages();
 
 #define MEMORY_ERROR gedcom_mem_error(__FILE__, __LINE__)
 #define VALUE_IF_MISSING "-" 
 
-extern int line_no;
 extern int init_called;
 extern int gedcom_high_level_debug; 
 extern FILE* trace_output;
@@ -30,36 +30,46 @@
 #include "gedcom.h"
 #include "gedcom.tabgen.h"
 #include "compat.h"
-
-static size_t encoding_width;
-static int current_level = -1;
-static int level_diff = MAXGEDCLEVEL;
-static size_t line_len = 0;
-static int tab_space = 0;
-static int current_tag = -1;
-
-static struct conv_buffer* ptr_buffer = NULL;
-static struct conv_buffer* tag_buffer = NULL;
-static struct conv_buffer* str_buffer = NULL;
+#include "reader.h"
+#include "parser.h"
+
+/* The state of the lexer is kept in the current parser (see parser.h) */
+#define current_level (PARSER->current_level)
+#define level_diff    (PARSER->level_diff)
+#define line_len      (PARSER->line_len)
+#define tab_space     (PARSER->tab_space)
+#define current_tag   (PARSER->current_tag)
+#define input_line    (PARSER->input_line)
+#define dummy_conv    (PARSER->dummy_conv)
+#define ptr_buffer    (PARSER->ptr_buffer)
+#define tag_buffer    (PARSER->tag_buffer)
+#define str_buffer    (PARSER->str_buffer)
 
 #define INITIAL_PTR_BUFFER_LEN MAXGEDCPTRLEN * UTF_FACTOR + 1
 #define INITIAL_TAG_BUFFER_LEN MAXGEDCTAGLEN * UTF_FACTOR + 1
 #define INITIAL_STR_BUFFER_LEN MAXGEDCLINELEN * UTF_FACTOR + 1
 
 #ifdef LEXER_TEST 
-YYSTYPE gedcom_lval;
-int line_no = 1;
+static struct Gedcom_parser_struct test_parser;
+THREAD_LOCAL struct Gedcom_parser_struct* gedcom_current_parser = &test_parser;
 
-int gedcom_lex();
+int gedcom_lex(YYSTYPE* lvalp);
 
 void message_handler(Gedcom_msg_type type, char *msg)
 {
   fprintf(stderr, "(%d) %s\n", type, msg);
 }
 
+/* message.c refers to this (see parallel.c) */
+void record_message(Gedcom_msg_type type UNUSED, const char* format UNUSED,
+		    const char* msg UNUSED)
+{
+}
+
 int test_loop(ENCODING enc, const char* code)
 {
   int tok, res;
+  YYSTYPE lval;
   init_encodings();
   set_encoding_width(enc);
   gedcom_set_message_handler(message_handler);
@@ -69,22 +79,26 @@ int test_loop(ENCODING enc, const char* code)
 		 strerror(errno));
     return 1;
   }
-  tok = gedcom_lex();
+  yymyinit(stdin);
+  reader_open(stdin);
+  tok = gedcom_lex(&lval);
   while (tok) {
     switch(tok) {
       case BADTOKEN: printf("BADTOKEN "); break;
-      case OPEN: printf("OPEN(%d) ", gedcom_lval.number); break;
+      case OPEN: printf("OPEN(%d) ", lval.number); break;
       case CLOSE: printf("CLOSE "); break;
-      case ESCAPE: printf("ESCAPE(%s) ", gedcom_lval.string); break;
+      case ESCAPE: printf("ESCAPE(%s) ", lval.string); break;
       case DELIM: printf("DELIM "); break;
-      case ANYCHAR: printf("%s ", gedcom_lval.string); break;
-      case POINTER: printf("POINTER(%s) ", gedcom_lval.string); break;
-      case USERTAG: printf("USERTAG(%s) ", gedcom_lval.tag.string); break;
-      default: printf("TAG(%s) ", gedcom_lval.tag.string); break;
+      case ANYCHAR: printf("%s ", lval.string); break;
+      case ANYSTRING: printf("STRING(%s) ", lval.string); break;
+      case POINTER: printf("POINTER(%s) ", lval.string); break;
+      case USERTAG: printf("USERTAG(%s) ", lval.tag.string); break;
+      default: printf("TAG(%s) ", lval.tag.string); break;
     }
-    tok = gedcom_lex();
+    tok = gedcom_lex(&lval);
   }
   printf("\n");
+  reader_close();
   close_conv_to_internal();
   return 0;  
 }
@@ -110,10 +124,10 @@ static void error_level_out_of_range()
   gedcom_error (_("Level number out of range [0..%d]"), MAXGEDCLEVEL); 
 }
 
-static void error_level_too_high(int level_diff)
+static void error_level_too_high(int diff)
 {
   gedcom_error (_("GEDCOM level number is %d higher than previous"),
-		level_diff); 
+		diff); 
 }
 
 static void error_tag_too_long(const char *tag)
@@ -148,22 +162,61 @@ static void error_unexpected_character(const char* str, char ch)
   gedcom_error(_("Unexpected character: '%s' (0x%02x)"), str, ch);
 }
 
-/* This is to bypass the iconv conversion (if the input is UTF-8 coming
-   from the program) */
-static int dummy_conv = 0;
+/* Tabs inside a value run are counted here, because they are handled
+   differently from the other characters */
+static size_t count_tabs(const char* str)
+{
+  size_t count = 0;
+  while ((str = strchr(str, '\t')) != NULL) {
+    count++;
+    str++;
+  }
+  return count;
+}
+
+/* Number of characters in a piece of converted (i.e. UTF-8) input */
+static size_t utf8_char_count(const char* str, size_t len)
+{
+  size_t i, count = 0;
+  for (i = 0; i < len; i++)
+    if ((str[i] & 0xC0) != 0x80)
+      count++;
+  return count;
+}
+
+/* The input is read via the reader, which converts it to UTF-8 once the
+   encoding is known (see reader.c) */
+#define YY_INPUT(buf,result,max_size) \
+  { result = reader_read(buf, max_size); }
 
 #elif LEX_SECTION == 2
 
-#define TO_INTERNAL(STR,OUTBUF) \
-  (dummy_conv ? STR : to_internal(STR, yyleng, OUTBUF))
+#define CONVERTED_INPUT \
+  reader_line_converted(input_line)
+
+/* If the input is already converted by the reader, the token still needs
+   to be copied, because yytext doesn't stay valid until the parser uses
+   the value */
+#define TO_INTERNAL(STR,OUTBUF)                                               \
+  (dummy_conv ? STR                                                           \
+   : CONVERTED_INPUT ? fill_conv_buffer(OUTBUF, STR, yyleng)                  \
+   : to_internal(STR, yyleng, OUTBUF))
+
+/* Length of the token in characters */
+#define TOKEN_LEN                                                             \
+  (!dummy_conv && CONVERTED_INPUT ?                                           \
+   utf8_char_count(yytext, yyleng) : (size_t)yyleng)
 
 #define INIT_LINE_LEN \
   line_len = 0;
 
-#define CHECK_LINE_LEN                                                        \
+#define RESET_CONVERSION \
+  to_internal(NULL, 0, str_buffer);
+
+#define ADD_LINE_LEN(LEN)                                                     \
   { if (line_len != (size_t)-1) {                                             \
-      line_len += strlen(yytext);                                             \
-      if (line_len > MAXGEDCLINELEN * encoding_width                          \
+      line_len += (LEN);                                                      \
+      if (line_len > MAXGEDCLINELEN                                           \
 	  && ! compat_long_line(current_level, current_tag)) {                \
         error_line_too_long();                                                \
         line_len = (size_t)-1;                                                \
@@ -172,17 +225,29 @@ static int dummy_conv = 0;
     }                                                                         \
   }
 
+#define CHECK_LINE_LEN \
+  ADD_LINE_LEN(TOKEN_LEN)
+
+/* After an error in a value, the rest of the line is handled character
+   per character, so that the error recovery of the parser skips the same
+   characters as it would without runs (see ACTION_RUN) */
+#define RETURN_VALUE_ERROR                                                    \
+  { if (YY_START == NORMAL)                                                   \
+      BEGIN(CHARWISE);                                                        \
+    return BADTOKEN;                                                          \
+  }
+
 #define GENERATE_TAB_SPACE                                                    \
-  { gedcom_lval.string = " ";                                                 \
+  { yylval->string = " ";                                                     \
     tab_space--;                                                              \
     return DELIM;                                                             \
   }
 
 #define MKTAGACTION(THETAG)                                                  \
   { CHECK_LINE_LEN;                                                          \
-    gedcom_lval.tag.string = TO_INTERNAL(yytext, tag_buffer);                \
-    current_tag            = TAG_##THETAG;                                   \
-    gedcom_lval.tag.value  = current_tag;                                    \
+    yylval->tag.string = TO_INTERNAL(yytext, tag_buffer);                    \
+    current_tag        = TAG_##THETAG;                                       \
+    yylval->tag.value  = current_tag;                                        \
     BEGIN(NORMAL);                                                           \
     line_no++;                                                               \
     return current_tag;                                                      \
@@ -236,7 +301,7 @@ static int dummy_conv = 0;
      }                                                                        \
      else if (level_diff == 1) {                                              \
        level_diff++;                                                          \
-       gedcom_lval.number = current_level;                                    \
+       yylval->number = current_level;                                        \
        return OPEN;                                                           \
      }                                                                        \
      else {                                                                   \
@@ -274,7 +339,7 @@ static int dummy_conv = 0;
      }                                                                        \
      else if (level_diff == 1) {                                              \
        level_diff++;                                                          \
-       gedcom_lval.number = current_level;                                    \
+       yylval->number = current_level;                                        \
        return OPEN;                                                           \
      }                                                                        \
      else {                                                                   \
@@ -287,14 +352,14 @@ static int dummy_conv = 0;
 
 
 #define ACTION_ALPHANUM                                                       \
-   { if (strlen(yytext) > MAXGEDCTAGLEN * encoding_width) {                   \
+   { if (yyleng > MAXGEDCTAGLEN) {                                            \
        error_tag_too_long(yytext);                                            \
        line_no++;                                                             \
        return BADTOKEN;                                                       \
      }                                                                        \
      CHECK_LINE_LEN;                                                          \
-     gedcom_lval.tag.string = TO_INTERNAL(yytext, tag_buffer);                \
-     gedcom_lval.tag.value  = USERTAG;                                        \
+     yylval->tag.string = TO_INTERNAL(yytext, tag_buffer);                    \
+     yylval->tag.value  = USERTAG;                                            \
      BEGIN(NORMAL);                                                           \
      line_no++;                                                               \
      return USERTAG;                                                          \
@@ -303,7 +368,7 @@ static int dummy_conv = 0;
 
 #define ACTION_DELIM                                                          \
   { CHECK_LINE_LEN;                                                           \
-    gedcom_lval.string = TO_INTERNAL(yytext, str_buffer);                     \
+    yylval->string = TO_INTERNAL(yytext, str_buffer);                         \
     return DELIM;                                                             \
   }
 
@@ -315,36 +380,70 @@ static int dummy_conv = 0;
     if (!tmp) {                                                               \
       /* Something went wrong during conversion... */                         \
           error_invalid_character(yytext, yytext[0]);                         \
-          return BADTOKEN;                                                    \
+          RETURN_VALUE_ERROR;                                                 \
     }                                                                         \
     else {                                                                    \
-      gedcom_lval.string = tmp;                                               \
+      yylval->string = tmp;                                                   \
       /* Due to character conversions, it is possible that the current        \
          character will be combined with the next, and so now we don't have a \
          character yet...                                                     \
          In principle, this is only applicable to the 1byte case (e.g. ANSEL),\
          but it doesn't harm the unicode case.                                \
       */                                                                      \
-      if (strlen(gedcom_lval.string) > 0)                                     \
+      if (strlen(yylval->string) > 0)                                         \
         return ANYCHAR;                                                       \
     }                                                                         \
   }
 
 
+/* A run is a complete stretch of a line value, up to (but not including)
+   the next pointer, escape, single '@' or the whitespace before the
+   terminator.  It is returned as one ANYSTRING token instead of one ANYCHAR
+   token per character, which saves a lot of work for long values (e.g. in
+   NOTE records).  Tabs are allowed inside the run only in compatibility
+   mode; they count as 8 spaces in the value, but not in the line length.
+
+   If the conversion of the run fails, or there is a tab that is not
+   allowed, the run is pushed back and the rest of the line is handled
+   character per character (in the CHARWISE state), so that the error
+   message is exactly the same as without runs.
+*/
+
+#define ACTION_RUN                                                            \
+  { char* tmp;                                                                \
+    size_t tabs = 0;                                                          \
+    tmp = TO_INTERNAL(yytext, str_buffer);                                    \
+    if (tmp)                                                                  \
+      tabs = count_tabs(tmp);                                                 \
+    if (!tmp || (tabs > 0 && !compat_mode(C_TAB_CHARACTER))) {                \
+      RESET_CONVERSION;                                                       \
+      yyless(0);                                                              \
+      BEGIN(CHARWISE);                                                        \
+    }                                                                         \
+    else {                                                                    \
+      ADD_LINE_LEN(TOKEN_LEN - tabs);                                         \
+      yylval->string = tmp;                                                   \
+      /* See ACTION_ANY for when the string can be empty */                   \
+      if (tmp[0] != '\0')                                                     \
+        return ANYSTRING;                                                     \
+    }                                                                         \
+  }
+
+
 #define ACTION_ESCAPE                                                         \
   { CHECK_LINE_LEN;                                                           \
-    gedcom_lval.string = TO_INTERNAL(yytext, str_buffer);                     \
+    yylval->string = TO_INTERNAL(yytext, str_buffer);                         \
     return ESCAPE;                                                            \
   }
 
 
 #define ACTION_POINTER                                                        \
   { CHECK_LINE_LEN;                                                           \
-    if (strlen(yytext) > MAXGEDCPTRLEN * encoding_width) {                    \
+    if (TOKEN_LEN > MAXGEDCPTRLEN) {                                          \
       error_pointer_too_long(yytext);                                         \
-      return BADTOKEN;                                                        \
+      RETURN_VALUE_ERROR;                                                     \
     }                                                                         \
-    gedcom_lval.string = TO_INTERNAL(yytext, ptr_buffer);                     \
+    yylval->string = TO_INTERNAL(yytext, ptr_buffer);                         \
     return POINTER;                                                           \
   }
 
@@ -360,27 +459,28 @@ static int dummy_conv = 0;
     INIT_LINE_LEN;                                                            \
     if (line_no == 1)                                                         \
       set_read_encoding_terminator(TO_INTERNAL(yytext, str_buffer));          \
+    if (!dummy_conv)                                                          \
+      input_line++;                                                           \
     BEGIN(INITIAL);                                                           \
   }
 
 
-/* Eventually we have to return 1 closing bracket (for the trailer).
-   We can detect whether we have sent the closing bracket using the
-   level_diff (at eof, first it is 2, then we increment it ourselves)
+/* Eventually we have to return the closing brackets of the open lines:
+   1 for the trailer of a complete file, but more when only a part of the
+   file is parsed (see parallel.c), e.g. the header, which ends on a line
+   of level 1 or more.  The level_diff is 2 if the last line was opened,
+   and the current_level tells how many brackets are left (at eof, we
+   decrement it ourselves)
 */
 
 #define ACTION_EOF                                                            \
-  { if (level_diff == 2) {                                                    \
-      level_diff++;                                                           \
+  { if (level_diff == 2 && current_level >= 0) {                              \
+      current_level--;                                                        \
       return CLOSE;                                                           \
     }                                                                         \
     else {                                                                    \
-      char* ptr; int size;                                                    \
       /* ... terminate lex */                                                 \
       yyterminate();                                                          \
-      /* Get rid of f*cking compiler warning from lex generated code */       \
-      /* yyterminate does return(), so program will never come here  */       \
-      yy_flex_realloc(ptr, size);                                             \
     }                                                                         \
   } 
 
@@ -400,7 +500,7 @@ static int dummy_conv = 0;
     }                                                                         \
     else {                                                                    \
       error_at_character();                                                   \
-      return BADTOKEN;                                                        \
+      RETURN_VALUE_ERROR;                                                     \
     }                                                                         \
   }
 
@@ -411,20 +511,39 @@ static int dummy_conv = 0;
     }                                                                         \
     else {                                                                    \
       error_tab_character();                                                  \
-      return BADTOKEN;                                                        \
+      RETURN_VALUE_ERROR;                                                     \
     }                                                                         \
   }
 
 #define ACTION_UNEXPECTED                                                     \
   { error_unexpected_character(yytext, yytext[0]);                            \
-    return BADTOKEN;                                                          \
+    RETURN_VALUE_ERROR;                                                       \
+  }
+
+/* The reader replaces invalid characters in the converted input (see
+   reader.c), and keeps the original character for the error message */
+#define ACTION_INVALID                                                        \
+  { if (!dummy_conv && CONVERTED_INPUT) {                                     \
+      char invalid[2];                                                        \
+      CHECK_LINE_LEN;                                                         \
+      invalid[0] = reader_invalid_char();                                     \
+      invalid[1] = '\0';                                                      \
+      error_invalid_character(invalid, invalid[0]);                           \
+      RETURN_VALUE_ERROR;                                                     \
+    }                                                                         \
+    else                                                                      \
+      ACTION_UNEXPECTED                                                       \
   }
 
 #elif LEX_SECTION == 3
 
-int yywrap()
+static void init_conv_buffers()
 {
-  return 1;
+  if (!ptr_buffer) {
+    ptr_buffer = create_conv_buffer(INITIAL_PTR_BUFFER_LEN);
+    tag_buffer = create_conv_buffer(INITIAL_TAG_BUFFER_LEN);
+    str_buffer = create_conv_buffer(INITIAL_STR_BUFFER_LEN);
+  }
 }
 
 static void free_conv_buffers()
@@ -432,38 +551,38 @@ static void free_conv_buffers()
   free_conv_buffer(ptr_buffer);
   free_conv_buffer(tag_buffer);
   free_conv_buffer(str_buffer);
+  ptr_buffer = tag_buffer = str_buffer = NULL;
 }
 
-static void yylex_cleanup()
+/* Frees the scanner and buffers of the current parser */
+void yymycleanup()
 {
-  /* fix memory leak in lex */
-  yy_delete_buffer(yy_current_buffer);
-  yy_current_buffer = NULL;
-  free_conv_buffers();
-}
-
-static void init_conv_buffers()
-{
-  if (!ptr_buffer) {
-    ptr_buffer = create_conv_buffer(INITIAL_PTR_BUFFER_LEN);
-    tag_buffer = create_conv_buffer(INITIAL_TAG_BUFFER_LEN);
-    str_buffer = create_conv_buffer(INITIAL_STR_BUFFER_LEN);
+  if (PARSER->scanner) {
+    yylex_destroy(PARSER->scanner);
+    PARSER->scanner = NULL;
   }
+  free_conv_buffers();
 }
 
-static int exitfuncregistered = 0;
-
-void yymyinit(FILE *f)
+/* Prepares the scanner of the current parser for reading a new file; the
+   input itself comes from the reader (see YY_INPUT) */
+int yymyinit(FILE *f)
 {
-  if (! exitfuncregistered && atexit(yylex_cleanup) == 0)
-    exitfuncregistered = 1;
+  struct yyguts_t* yyg;
+  
   init_conv_buffers();
-  yyin = f;
-  yyrestart(f);
+  if (!PARSER->scanner && yylex_init(&PARSER->scanner) != 0) {
+    MEMORY_ERROR;
+    return 0;
+  }
+  yyg = (struct yyguts_t*)PARSER->scanner;
+  yyrestart(f, PARSER->scanner);
   /* Reset our state */
   current_level = -1;
   level_diff = MAXGEDCLEVEL;
+  input_line = 0;
   BEGIN(INITIAL);
+  return 1;
 }
 
 #endif
@@ -23,12 +23,14 @@
 
 #include "gedcom_internal.h"
 #include "interface.h"
+#include "parallel.h"
+#include "batch.h"
 
-static Gedcom_rec_start_cb record_start_callback [NR_OF_RECS] = { NULL };
-static Gedcom_rec_end_cb   record_end_callback   [NR_OF_RECS] = { NULL };
-static Gedcom_elt_start_cb element_start_callback[NR_OF_ELTS] = { NULL };
-static Gedcom_elt_end_cb   element_end_callback  [NR_OF_ELTS] = { NULL };
-static Gedcom_def_cb       default_cb                         = NULL;
+#define record_start_callback  (PARSER->record_start_callback)
+#define record_end_callback    (PARSER->record_end_callback)
+#define element_start_callback (PARSER->element_start_callback)
+#define element_end_callback   (PARSER->element_end_callback)
+#define default_cb             (PARSER->default_cb)
 
 /** This function allows to set the default callback.  You can only register
     one default callback.
@@ -86,23 +88,64 @@ void gedcom_subscribe_to_element(Gedcom_elt elt,
   }
 }
 
+/** This function allows to skip work that is only useful for callbacks that
+    are not subscribed.  By default nothing is skipped.
+    \param options A bitwise 'or' of the values of \ref Gedcom_skip, or 0
+    to skip nothing
+ */
+void gedcom_set_skip_options(Gedcom_skip options)
+{
+  PARSER->skip_options = options;
+}
+
+/* Returns whether the parsed value of the given record or element is
+   needed, i.e. whether the given skip option is off or there is a start
+   callback that receives the value (a batch callback receives all the
+   values of its record) */
+int value_needed(int rec_or_elt, Gedcom_skip option)
+{
+  if (!skipping(option) || PARSER->batch_active)
+    return 1;
+  else if (rec_or_elt < NR_OF_RECS)
+    return record_start_callback[rec_or_elt] != NULL
+           || PARSER->record_batch_callback[rec_or_elt] != NULL;
+  else
+    return element_start_callback[rec_or_elt] != NULL;
+}
+
+/* In a parallel parse with the callbacks in file order, the worker parsers
+   record the callbacks instead of calling them (see parallel.c) */
+
 Gedcom_ctxt start_record(Gedcom_rec rec,
 			 int level, Gedcom_val xref, struct tag_struct tag,
 			 char *raw_value, Gedcom_val parsed_value)
 {
   Gedcom_rec_start_cb cb = record_start_callback[rec];
-  if (cb != NULL)
-    return (*cb)(rec, level, xref, tag.string, raw_value, tag.value,
-		 parsed_value);
+  if (PARSER->record_batch_callback[rec])
+    batch_start_record(rec, level, xref, tag, raw_value, parsed_value);
   else
+    PARSER->batch_active = 0;
+  if (cb == NULL)
     return NULL;
+  else if (PARSER->recorder)
+    return record_start_record(rec, level, xref, tag, raw_value,
+			       parsed_value);
+  else
+    return (*cb)(rec, level, xref, tag.string, raw_value, tag.value,
+		 parsed_value);
 }
 
 void end_record(Gedcom_rec rec, Gedcom_ctxt self, Gedcom_val parsed_value)
 {
   Gedcom_rec_end_cb cb = record_end_callback[rec];
-  if (cb != NULL)
-    (*cb)(rec, self, parsed_value);
+  if (cb != NULL) {
+    if (PARSER->recorder)
+      record_end_record(rec, self, parsed_value);
+    else
+      (*cb)(rec, self, parsed_value);
+  }
+  if (PARSER->batch_active)
+    batch_end_record(rec);
 }
 
 Gedcom_ctxt start_element(Gedcom_elt elt, Gedcom_ctxt parent, 
@@ -111,11 +154,22 @@ Gedcom_ctxt start_element(Gedcom_elt elt, Gedcom_ctxt parent,
 {
   Gedcom_elt_start_cb cb = element_start_callback[elt];
   Gedcom_ctxt ctxt = parent;
-  if (cb != NULL)
-    ctxt = (*cb)(elt, parent, level, tag.string, raw_value,
-		 tag.value, parsed_value);
-  else if (default_cb != NULL && parent != NULL)
-    (*default_cb)(elt, parent, level, tag.string, raw_value, tag.value);
+  if (PARSER->batch_active)
+    batch_add_element(elt, level, tag, raw_value, parsed_value);
+  if (cb != NULL) {
+    if (PARSER->recorder)
+      ctxt = record_start_element(elt, parent, level, tag, raw_value,
+				  parsed_value);
+    else
+      ctxt = (*cb)(elt, parent, level, tag.string, raw_value,
+		   tag.value, parsed_value);
+  }
+  else if (default_cb != NULL && parent != NULL) {
+    if (PARSER->recorder)
+      record_default(elt, parent, level, tag, raw_value);
+    else
+      (*default_cb)(elt, parent, level, tag.string, raw_value, tag.value);
+  }
   return ctxt;
 }
 
@@ -123,10 +177,56 @@ void end_element(Gedcom_elt elt, Gedcom_ctxt parent, Gedcom_ctxt self,
 		 Gedcom_val parsed_value)
 {
   Gedcom_elt_end_cb cb = element_end_callback[elt];
-  if (cb != NULL)
+  if (cb == NULL)
+    return;
+  else if (PARSER->recorder)
+    record_end_element(elt, parent, self, parsed_value);
+  else
     (*cb)(elt, parent, self, parsed_value);
 }
 
+/* Parses a deferred value (see GEDCOM_MAKE_DEFERRED); this is called via
+   the GEDCOM_DATE and GEDCOM_AGE macros */
+Gedcom_val_struct* gedcom_resolve_value(Gedcom_val_struct* val)
+{
+  const char* raw = val->deferred;
+  val->deferred = NULL;
+  if (val->type == GV_DATE_VALUE)
+    val->value.date_val = gedcom_parse_date(raw);
+  else if (val->type == GV_AGE_VALUE)
+    val->value.age_val = gedcom_parse_age(raw);
+  return val;
+}
+
+/** This function returns the string in the given parsed value as a string
+    that the caller owns (and must free).  For the concatenated values that
+    are passed to the end callbacks (e.g. the full text of a note), the
+    buffer of the parser is handed over, so that long values are not copied;
+    other strings are duplicated.
+
+    \param val The parsed value, which must be a string
+    (see \ref GEDCOM_STRING)
+
+    \return The string, or \c NULL in case of memory errors.  After this
+    call, the string in \c val is no longer valid.
+*/
+char* gedcom_take_string(Gedcom_val val)
+{
+  char* str = GEDCOM_STRING(val);
+  char* result;
+  if (!str)
+    return NULL;
+  else if (str == get_buf_string(&PARSER->concat_buffer))
+    result = detach_buffer(&PARSER->concat_buffer);
+  else
+    result = strdup(str);
+  if (!result)
+    MEMORY_ERROR;
+  else if (GEDCOM_IS_STRING(val))
+    val->value.string_val = NULL;
+  return result;
+}
+
 const char* val_type_str[] = { N_("null value"),
 			       N_("character string"),
 			       N_("date"),
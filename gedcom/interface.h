@@ -26,6 +26,7 @@
 
 #include "gedcom_internal.h"
 #include "gedcom.h"
+#include "parser.h"
 
 Gedcom_ctxt start_record(Gedcom_rec rec,
 			 int level, Gedcom_val xref, struct tag_struct tag,
@@ -39,12 +40,17 @@ Gedcom_ctxt start_element(Gedcom_elt elt, Gedcom_ctxt parent,
 void        end_element(Gedcom_elt elt, Gedcom_ctxt parent, Gedcom_ctxt self,
 			Gedcom_val parsed_value);
 
-extern Gedcom_val_struct val1;
-extern Gedcom_val_struct val2;
-extern Gedcom_err_mech error_mechanism;
+int         value_needed(int rec_or_elt, Gedcom_skip option);
+
+#define skipping(OPTION)  (PARSER->skip_options & (OPTION))
 
 #define GEDCOM_MAKE(VAR, VALUE, TYPE, MEMBER) \
-   (VAR.type = TYPE, VAR.value.MEMBER = VALUE, &VAR)
+   (VAR.type = TYPE, VAR.deferred = NULL, VAR.value.MEMBER = VALUE, &VAR)
+
+/* A value of the given type that is parsed from RAW on first access (see
+   gedcom_resolve_value); RAW must stay valid during the callback */
+#define GEDCOM_MAKE_DEFERRED(VAR, RAW, TYPE) \
+   (VAR.type = TYPE, VAR.deferred = RAW, &VAR)
 
 #define GEDCOM_MAKE_NULL(VAR) \
    GEDCOM_MAKE(VAR, NULL, GV_NULL, string_val)
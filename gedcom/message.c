@@ -24,11 +24,207 @@
 #include "gedcom_internal.h"
 #include "gedcom.h"
 #include "buffer.h"
+#include "parser.h"
+#include "parallel.h"
 
-void cleanup_mess_buffer();
+#define mess_buffer       (PARSER->mess_buffer)
+#define msg_handler       (PARSER->msg_handler)
+#define msg_info_handler  (PARSER->msg_info_handler)
+#define msg_limit         (PARSER->msg_limit)
 
-struct safe_buffer mess_buffer = { NULL, 0, NULL, 0, cleanup_mess_buffer };
-Gedcom_msg_handler msg_handler = NULL;
+/* A message is only formatted when it is needed: for the plain message
+   handler, for recording it (see parallel.c), or when the structured
+   message handler asks for its text.  Before that, the arguments are only
+   available via the va_list of gedcom_error and friends, so a message can
+   only be used during the call of the handler.
+
+   The format string identifies the kind of message: the number of times
+   each format was seen in the current parse is kept in an open-addressing
+   table keyed on the pointer.
+*/
+
+#define MSG_COUNTS_INITIAL  64
+
+struct Gedcom_msg_struct {
+  Gedcom_msg_type  type;
+  int              line;
+  const char*      format;
+  va_list*         args;       /* the arguments, until formatted */
+  char*            text;       /* NULL until formatted */
+  int              length;     /* length of the formatted format string */
+  unsigned long    count;
+};
+
+struct msg_count {
+  const char*    format;
+  unsigned long  count;
+};
+
+static size_t hash_format(const char* format, size_t mask)
+{
+  return (((size_t)format >> 3) * 2654435761UL) & mask;
+}
+
+static int grow_msg_counts()
+{
+  size_t old_size = PARSER->msg_counts_size, i;
+  size_t new_size = (old_size ? old_size * 2 : MSG_COUNTS_INITIAL);
+  struct msg_count* old_counts = PARSER->msg_counts;
+  struct msg_count* new_counts
+    = (struct msg_count*)calloc(new_size, sizeof(struct msg_count));
+  if (!new_counts)
+    return 0;
+  for (i = 0; i < old_size; i++) {
+    if (old_counts[i].format) {
+      size_t pos = hash_format(old_counts[i].format, new_size - 1);
+      while (new_counts[pos].format)
+	pos = (pos + 1) & (new_size - 1);
+      new_counts[pos] = old_counts[i];
+    }
+  }
+  free(old_counts);
+  PARSER->msg_counts      = new_counts;
+  PARSER->msg_counts_size = new_size;
+  return 1;
+}
+
+/* Returns the number of times the given format was seen in this parse,
+   including this time (0 if there is no memory to count it; this doesn't
+   use MEMORY_ERROR, since that would give a message again) */
+static unsigned long count_message(const char* format)
+{
+  size_t mask, pos;
+
+  if (PARSER->msg_counts_used * 2 >= PARSER->msg_counts_size
+      && !grow_msg_counts())
+    return 0;
+  mask = PARSER->msg_counts_size - 1;
+  pos  = hash_format(format, mask);
+  while (PARSER->msg_counts[pos].format
+	 && PARSER->msg_counts[pos].format != format)
+    pos = (pos + 1) & mask;
+  if (!PARSER->msg_counts[pos].format) {
+    PARSER->msg_counts[pos].format = format;
+    PARSER->msg_counts_used++;
+  }
+  return ++PARSER->msg_counts[pos].count;
+}
+
+/* Called at the start of a parse */
+void reset_message_counts()
+{
+  if (PARSER->msg_counts)
+    memset(PARSER->msg_counts, 0,
+	   PARSER->msg_counts_size * sizeof(struct msg_count));
+  PARSER->msg_counts_used = 0;
+  PARSER->msg_reported    = 0;
+  PARSER->msg_suppressed  = 0;
+}
+
+void cleanup_messages()
+{
+  free(PARSER->msg_counts);
+  PARSER->msg_counts      = NULL;
+  PARSER->msg_counts_size = 0;
+  PARSER->msg_counts_used = 0;
+}
+
+static void format_message(struct Gedcom_msg_struct* msg)
+{
+  reset_buffer(&mess_buffer);
+  if (msg->type == ERROR) {
+    if (msg->line != 0)
+      safe_buf_append(&mess_buffer, _("Error on line %d: "), msg->line);
+    else
+      safe_buf_append(&mess_buffer, _("Error: "));
+  }
+  else if (msg->type == WARNING) {
+    if (msg->line != 0)
+      safe_buf_append(&mess_buffer, _("Warning on line %d: "), msg->line);
+    else
+      safe_buf_append(&mess_buffer, _("Warning: "));
+  }
+  msg->length = safe_buf_vappend(&mess_buffer, msg->format, *msg->args);
+  msg->args = NULL;
+  msg->text = get_buf_string(&mess_buffer);
+}
+
+static void call_handlers(struct Gedcom_msg_struct* msg)
+{
+  PARSER->msg_reported++;
+  if (msg_handler)
+    (*msg_handler)(msg->type, gedcom_msg_text(msg));
+  if (msg_info_handler)
+    (*msg_info_handler)(msg->type, msg);
+}
+
+/* Returns whether the message is over the limit; counting is only needed
+   for the limit and for the structured message handler */
+static int suppressed(struct Gedcom_msg_struct* msg)
+{
+  if (msg_limit || msg_info_handler)
+    msg->count = count_message(msg->format);
+  return (msg_limit && msg->count > msg_limit);
+}
+
+/* In a parallel parse with the callbacks in file order, the worker parsers
+   record the messages instead of passing them (see parallel.c).  They
+   record suppressed messages without text: the main parser has seen at
+   least as many of them, so it suppresses them as well.
+
+   Returns the length of the formatted message (see gedcom_message), or 0
+   if it wasn't formatted */
+static int handle_message(Gedcom_msg_type type, const char* format,
+			  va_list* args)
+{
+  struct Gedcom_msg_struct msg;
+
+  if (!msg_handler && !msg_info_handler)
+    return 0;
+
+  msg.type   = type;
+  msg.line   = line_no;
+  msg.format = format;
+  msg.args   = args;
+  msg.text   = NULL;
+  msg.length = 0;
+  msg.count  = 0;
+
+  if (suppressed(&msg)) {
+    if (PARSER->recorder)
+      record_message(type, format, NULL);
+    else
+      PARSER->msg_suppressed++;
+  }
+  else if (PARSER->recorder)
+    record_message(type, format, gedcom_msg_text(&msg));
+  else
+    call_handlers(&msg);
+  return msg.length;
+}
+
+/* Called when replaying the messages of a worker parser; the line number
+   is already set */
+void replay_message(Gedcom_msg_type type, const char* format, char* text)
+{
+  struct Gedcom_msg_struct msg;
+
+  if (!msg_handler && !msg_info_handler)
+    return;
+
+  msg.type   = type;
+  msg.line   = line_no;
+  msg.format = format;
+  msg.args   = NULL;
+  msg.text   = text;
+  msg.length = 0;
+  msg.count  = 0;
+
+  if (suppressed(&msg) || !text)
+    PARSER->msg_suppressed++;
+  else
+    call_handlers(&msg);
+}
 
 /** This function registers a callback that is called if there are errors,
     warnings or just messages coming from the parser.
@@ -41,22 +237,102 @@ void gedcom_set_message_handler(Gedcom_msg_handler func)
   msg_handler = func;
 }
 
-void cleanup_mess_buffer()
+/** This function registers a callback that gets the errors, warnings and
+    messages coming from the parser in structured form (see
+    \ref Gedcom_msg_info_handler).  Unlike with
+    \ref gedcom_set_message_handler(), the message text is only formatted
+    when the callback asks for it via \ref gedcom_msg_text().  If both
+    callbacks are registered, both are called.
+
+    \param func The callback, or \c NULL to remove it
+*/
+void gedcom_set_message_info_handler(Gedcom_msg_info_handler func)
+{
+  msg_info_handler = func;
+}
+
+/** This function limits the number of times that the same message is
+    passed to the message handlers in a parse: once a message (i.e. a
+    message with the same format, see \ref gedcom_msg_format()) was
+    reported \c limit times, the next ones are only counted (see
+    \ref gedcom_get_message_stats()).  This keeps files with many errors
+    of the same kind from being slow to parse.
+
+    In a parallel parse with \c CB_UNORDERED, the limit applies per worker
+    thread.
+
+    \param limit The maximum number of times that each message is reported,
+    or 0 for no limit (the default)
+*/
+void gedcom_set_message_limit(unsigned long limit)
+{
+  msg_limit = limit;
+}
+
+/** This function returns the number of messages of the last parse with
+    the current parser (see \ref gedcom_set_message_limit()).
+
+    \param reported Is filled in with the number of messages that were
+    passed to the message handlers (can be \c NULL)
+    \param suppressed Is filled in with the number of messages that were
+    suppressed because of the limit (can be \c NULL)
+*/
+void gedcom_get_message_stats(unsigned long* reported,
+			      unsigned long* suppressed)
+{
+  if (reported)
+    *reported = PARSER->msg_reported;
+  if (suppressed)
+    *suppressed = PARSER->msg_suppressed;
+}
+
+/** This function returns the line number of a message (0 if the message
+    is not about a specific line). */
+int gedcom_msg_line(Gedcom_msg msg)
+{
+  return msg->line;
+}
+
+/** This function returns the format of a message, i.e. the translated
+    format string, without the arguments filled in.  It is the same pointer
+    for all the messages of the same kind, so it can be used as a message
+    code. */
+const char* gedcom_msg_format(Gedcom_msg msg)
+{
+  return msg->format;
+}
+
+/** This function returns the number of times that the message (i.e. its
+    format) was seen in the current parse, including this time. */
+unsigned long gedcom_msg_count(Gedcom_msg msg)
+{
+  return msg->count;
+}
+
+/** This function returns the text of a message, in the same form as for
+    the callback of \ref gedcom_set_message_handler().  The text is
+    formatted on the first call; it is only valid during the callback. */
+char* gedcom_msg_text(Gedcom_msg msg)
 {
-  cleanup_buffer(&mess_buffer);
+  if (!msg->text)
+    format_message(msg);
+  return msg->text;
 }
 
+/* The following functions pass a message to the message handlers.  They
+   return the number of characters that the format string and its arguments
+   expand to (without the "Error on line ..." prefix), or 0 if the message
+   was not formatted: when there is no message handler, when the message is
+   suppressed (see gedcom_set_message_limit), or when only a structured
+   message handler is registered that didn't ask for the text */
 int gedcom_message(const char* s, ...)
 {
   int res;
   va_list ap;
 
   va_start(ap, s);
-  reset_buffer(&mess_buffer);
-  res = safe_buf_vappend(&mess_buffer, s, ap);
+  res = handle_message(MESSAGE, s, &ap);
   va_end(ap);
-  if (msg_handler)
-    (*msg_handler)(MESSAGE, get_buf_string(&mess_buffer));
   return res;
 }
 
@@ -65,17 +341,9 @@ int gedcom_warning(const char* s, ...)
   int res;
   va_list ap;
 
-  reset_buffer(&mess_buffer);
-  if (line_no != 0) 
-    safe_buf_append(&mess_buffer, _("Warning on line %d: "), line_no);
-  else
-    safe_buf_append(&mess_buffer, _("Warning: "));
   va_start(ap, s);
-  res = safe_buf_vappend(&mess_buffer, s, ap);
+  res = handle_message(WARNING, s, &ap);
   va_end(ap);
-  if (msg_handler)
-    (*msg_handler)(WARNING, get_buf_string(&mess_buffer));
-  
   return res;
 }
 
@@ -84,17 +352,9 @@ int gedcom_error(const char* s, ...)
   int res;
   va_list ap;
 
-  reset_buffer(&mess_buffer);
-  if (line_no != 0)
-    safe_buf_append(&mess_buffer, _("Error on line %d: "), line_no);
-  else
-    safe_buf_append(&mess_buffer, _("Error: "));
   va_start(ap, s);
-  res = safe_buf_vappend(&mess_buffer, s, ap);
+  res = handle_message(ERROR, s, &ap);
   va_end(ap);
-  if (msg_handler)
-    (*msg_handler)(ERROR, get_buf_string(&mess_buffer));
-  
   return res;
 }
 
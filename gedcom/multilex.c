@@ -25,116 +25,150 @@
 #include "multilex.h"
 #include "encoding.h"
 #include "encoding_state.h"
+#include "reader.h"
 #include "xref.h"
-
-int line_no = 0;
-
-typedef int (*lex_func)(void);
-lex_func lf;
+#include "parser.h"
+#include "parallel.h"
+#include "gedcom.tabgen.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #define NEW_MODEL_FILE "new.ged"
 
-int lexer_init(Encoding enc, FILE* f)
+/* Sets up the conversion for the given encoding, once the reader is open */
+static int lexer_init_encoding(Encoding enc)
 {
-  if (enc == ONE_BYTE) {
-    lf  = &gedcom_1byte_lex;
-    gedcom_1byte_myinit(f);
-    set_read_encoding_width(enc);
+  if (enc == ONE_BYTE)
     return open_conv_to_internal("ASCII");
-  }
-  else if (enc == TWO_BYTE_HILO) {
-    lf  = &gedcom_hilo_lex;
-    gedcom_hilo_myinit(f);
-    set_read_encoding_width(enc);
-    return open_conv_to_internal("UNICODE");
-  }
-  else if (enc == TWO_BYTE_LOHI) {
-    lf  = &gedcom_lohi_lex;
-    gedcom_lohi_myinit(f);
-    set_read_encoding_width(enc);
-    return open_conv_to_internal("UNICODE");
-  }
-  else {
+  else if (enc == TWO_BYTE_HILO || enc == TWO_BYTE_LOHI)
+    /* The character set is known already, so the reader converts to UTF-8
+       from the start, and the lexer only sees UTF-8 */
+    return (open_conv_to_internal("UNICODE") && reader_start_conversion());
+  else
     return 0;
-  }
 }
 
-void lexer_close()
+int lexer_init(Encoding enc, FILE* f)
 {
-  close_conv_to_internal();
+  set_read_encoding_width(enc);
+  if (!gedcom_1byte_myinit(f) || !reader_open(f))
+    return 0;
+  else
+    return lexer_init_encoding(enc);
 }
 
-int gedcom_lex()
+int lexer_init_memory(Encoding enc, const char* buf, size_t len)
 {
-  return (*lf)();
+  set_read_encoding_width(enc);
+  if (!gedcom_1byte_myinit(NULL) || !reader_open_memory(buf, len))
+    return 0;
+  else
+    return lexer_init_encoding(enc);
 }
 
-void rewind_file(FILE* f)
+void lexer_close()
 {
-  if (fseek(f, 0, 0) != 0)
-    gedcom_warning(_("Error positioning input file: %s"), strerror(errno));
+  reader_close();
+  close_conv_to_internal();
 }
 
-int determine_encoding(FILE* f)
+/* The start token (if any) selects which part of the file is parsed (see
+   parallel.c); it comes before the tokens of the lexer */
+int gedcom_lex(YYSTYPE* lvalp)
 {
-  char first[2];
-  int read;
+  if (PARSER->start_token) {
+    int token = PARSER->start_token;
+    PARSER->start_token = 0;
+    return token;
+  }
+  return gedcom_1byte_lex(lvalp, PARSER->scanner);
+}
 
+/* Determines the encoding from the first bytes of the input (len is at
+   least 2), and returns the length of the byte order mark, if any, in
+   bom_len */
+static Encoding encoding_of(const char* first, size_t len, size_t* bom_len)
+{
+  *bom_len = 0;
   set_read_encoding_bom(WITHOUT_BOM);
-  read = fread(first, 1, 2, f);
-  if (read != 2) {
-    gedcom_warning(_("Error reading from input file: %s"), strerror(errno));
-    rewind_file(f);
-    return ONE_BYTE;
-  }
-  else if ((first[0] == '0') && (first[1] == ' ')) {
+  if ((first[0] == '0') && (first[1] == ' ')) {
     gedcom_debug_print("One-byte encoding");
-    rewind_file(f);
     return ONE_BYTE;
   }
   else if ((first[0] == '\0') && (first[1] == '0')) {
     gedcom_debug_print("Two-byte encoding, high-low");
-    rewind_file(f);
     return TWO_BYTE_HILO;
   }
   else if ((first[0] == '\xFE') && (first[1] == '\xFF')) {
     gedcom_debug_print("Two-byte encoding, high-low, with BOM");
     set_read_encoding_bom(WITH_BOM);
+    *bom_len = 2;
     return TWO_BYTE_HILO;
   }
   else if ((first[0] == '0') && (first[1] == '\0')) {
     gedcom_debug_print("Two-byte encoding, low-high");
-    rewind_file(f);
     return TWO_BYTE_LOHI;
   }
   else if ((first[0] == '\xFF') && (first[1] == '\xFE')) {
     gedcom_debug_print("Two-byte encoding, low-high, with BOM");
     set_read_encoding_bom(WITH_BOM);
+    *bom_len = 2;
     return TWO_BYTE_LOHI;
   }
-  else if ((first[0] == '\xEF') && (first[1] == '\xBB')) {
-    read = fread(first, 1, 1, f);
-    if (read != 1) {
-      gedcom_warning(_("Error reading from input file: %s"), strerror(errno));
-      rewind_file(f);
-    }
-    else if (first[0] == '\xBF') {
-      set_read_encoding_bom(WITH_BOM);
-      gedcom_debug_print("UTF-8 encoding, with BOM");
-    }
-    else {
-      gedcom_warning(_("Unknown encoding, falling back to one-byte"));
-      rewind_file(f);
-    }
+  else if ((first[0] == '\xEF') && (first[1] == '\xBB')
+	   && (len > 2) && (first[2] == '\xBF')) {
+    gedcom_debug_print("UTF-8 encoding, with BOM");
+    set_read_encoding_bom(WITH_BOM);
+    *bom_len = 3;
     return ONE_BYTE;
   }
   else {
     gedcom_warning(_("Unknown encoding, falling back to one-byte"));
-    rewind_file(f);
     return ONE_BYTE;
   }
 }
 
+/* Determines the encoding of the file, and positions the file after the
+   byte order mark, if any */
+static Encoding determine_encoding(FILE* f)
+{
+  char first[3];
+  size_t len, bom_len = 0;
+  Encoding enc = ONE_BYTE;
+
+  len = fread(first, 1, sizeof(first), f);
+  if (len < 2) {
+    gedcom_warning(_("Error reading from input file: %s"), strerror(errno));
+    set_read_encoding_bom(WITHOUT_BOM);
+  }
+  else
+    enc = encoding_of(first, len, &bom_len);
+  if (fseek(f, bom_len, SEEK_SET) != 0)
+    gedcom_warning(_("Error positioning input file: %s"), strerror(errno));
+  return enc;
+}
+
+/* Determines the encoding of the buffer, and skips the byte order mark, if
+   any */
+static Encoding determine_buffer_encoding(const char** buf, size_t* len)
+{
+  size_t bom_len = 0;
+  Encoding enc = ONE_BYTE;
+
+  if (*len < 2) {
+    gedcom_warning(_("Unknown encoding, falling back to one-byte"));
+    set_read_encoding_bom(WITHOUT_BOM);
+  }
+  else
+    enc = encoding_of(*buf, *len, &bom_len);
+  *buf += bom_len;
+  *len -= bom_len;
+  return enc;
+}
+
 int init_called = 0;
 
 /** This function initializes the Gedcom parser library and must be called
@@ -152,12 +186,16 @@ int init_called = 0;
     \attention Practically,
     it should e.g. come before any calls to any GTK functions, because GTK
     uses \c iconv_open in its initialization.
+    \attention In a program that parses in several threads, this function
+    must be called before the threads are started.
 
     \retval 0 in case of success
     \retval nonzero in case of failure (e.g. failure to set locale)
  */
 int gedcom_init()
 {
+  if (!init_called && register_parser_cleanup() != 0)
+    gedcom_warning(_("Could not register parser cleanup function"));
   init_called = 1;
   update_gconv_search_path();
   init_encodings();
@@ -169,9 +207,67 @@ int gedcom_init()
     return 0;
 }
 
+/* Parses the input, from the file if buf is NULL, otherwise from the given
+   block of memory, and checks the cross-references */
+static int parse_input(Encoding enc, FILE* file, const char* buf, size_t len)
+{
+  int result = 1;
+  int ok = (buf ? lexer_init_memory(enc, buf, len) : lexer_init(enc, file));
+  if (ok) {
+    struct stat st;
+    if (!buf && fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode))
+      len = st.st_size;
+    line_no = 0;
+    make_xref_table(len);
+    result = gedcom_parse();
+  }
+  lexer_close();
+  line_no = 0;
+  if (result == 0)
+    result = check_xref_table();
+  return result;
+}
+
+/* Parses the file via a memory mapping, if possible.  Returns -1 if the
+   file can't be mapped (in which case the file position is unchanged) */
+#ifdef HAVE_MMAP
+static int parse_mapped_file(Encoding enc, FILE* file)
+{
+  int result = -1;
+  struct stat st;
+  off_t start = ftello(file);
+
+  if (start >= 0 && fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode)
+      && st.st_size > start && (off_t)(size_t)st.st_size == st.st_size) {
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+		     fileno(file), 0);
+    if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+      madvise(map, st.st_size, MADV_SEQUENTIAL);
+#endif
+      result = parse_input(enc, NULL, (const char*)map + start,
+			   st.st_size - start);
+      munmap(map, st.st_size);
+    }
+  }
+  return result;
+}
+#else
+static int parse_mapped_file(Encoding enc UNUSED, FILE* file UNUSED)
+{
+  return -1;
+}
+#endif
+
 /** This function parses the given file.  By itself, it doesn't provide any
     other information than the parse result.
 
+    The parse is done by the current parser of the calling thread, which is
+    the default parser unless another one was selected via
+    \ref gedcom_parser_select().  The records of the file can be parsed
+    in several threads, see \ref gedcom_set_parallel_parse().  If
+    possible, the file is mapped into memory instead of read.
+
     The function also empties the cross-reference table before parsing, and
     checks the validity of the
     cross-references if the parse was successful.
@@ -190,7 +286,6 @@ int gedcom_init()
 	    - The parse of the given file failed
 	    - There were errors found in the cross-reference table
  */
-
 int gedcom_parse_file(const char* file_name)
 {
   Encoding enc;
@@ -208,17 +303,20 @@ int gedcom_parse_file(const char* file_name)
     }
     else {
       line_no = 1;
+      reset_message_counts();
       enc = determine_encoding(file);
-      
-      if (lexer_init(enc, file)) {
-	line_no = 0;
-	make_xref_table();
-	result = gedcom_parse();
+
+      result = parallel_parse_file(enc, file, file_name);
+      if (result == -1) {
+	result = parse_mapped_file(enc, file);
+	if (result == -1)
+	  result = parse_input(enc, file, NULL, 0);
+      }
+      else {
 	line_no = 0;
 	if (result == 0)
 	  result = check_xref_table();
       }
-      lexer_close();
       fclose(file);
     }
   }
@@ -226,6 +324,39 @@ int gedcom_parse_file(const char* file_name)
   return result;
 }
 
+/** This function parses GEDCOM data from a block of memory, in the same
+    way as \ref gedcom_parse_file() parses a file.  The data is not copied
+    and not modified, and is not used anymore after the function returns.
+
+    \param buffer The GEDCOM data (including the byte order mark, if any);
+    it doesn't need to be null-terminated
+    \param size The size of the data in bytes
+
+    \retval 0 if the parse was successful and no errors were found in the
+    cross-reference table
+    \retval nonzero on errors (the same as for \ref gedcom_parse_file())
+ */
+int gedcom_parse_buffer(const char* buffer, size_t size)
+{
+  Encoding enc;
+  int result = 1;
+
+  if (!init_called) {
+    gedcom_error(_("Internal error: GEDCOM parser not initialized"));
+  }
+  else if (!buffer) {
+    gedcom_error(_("Internal error: no input buffer given"));
+  }
+  else {
+    line_no = 1;
+    reset_message_counts();
+    enc = determine_buffer_encoding(&buffer, &size);
+    result = parse_input(enc, NULL, buffer, size);
+  }
+
+  return result;
+}
+
 /** This function starts a new model.  It does this by parsing the \c new.ged
     file in the data directory of the library (\c $PREFIX/share/gedcom-parse).
     This can be used to start from an empty model, and to build up the model
@@ -24,13 +24,12 @@
 #ifndef __MULTILEX_H
 #define __MULTILEX_H
 #include <stdio.h>
+#include "gedcom.h"
 
+int        lexer_init(Encoding enc, FILE* f);
+int        lexer_init_memory(Encoding enc, const char* buf, size_t len);
+void       lexer_close();
 int        gedcom_1byte_lex();
-void       gedcom_1byte_myinit(FILE* f);
-
-int        gedcom_hilo_lex();
-void       gedcom_hilo_myinit(FILE* f);
-
-int        gedcom_lohi_lex();
-void       gedcom_lohi_myinit(FILE* f);
+int        gedcom_1byte_myinit(FILE* f);
+void       gedcom_1byte_mycleanup();
 #endif /* __MULTILEX_H */
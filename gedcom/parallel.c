@@ -0,0 +1,961 @@
+/* Parallel parsing of the records of a file.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+/* The records of a GEDCOM file are independent of each other, except via
+   the cross-references.  So, once the header is parsed (and the character
+   set is known), the rest of the file can be divided into chunks at the
+   level 0 lines, and these chunks can be parsed at the same time.
+
+   This is done as follows:
+
+     - The file is scanned for the level 0 lines; the header and the chunks
+       of records are determined from these (see split_file).
+
+     - The header is parsed by the current parser, in the calling thread
+       (with PARSE_HEAD as start token, see gedcom.y).
+
+     - The chunks are parsed by worker threads, each with its own parser
+       (with PARSE_RECORDS or PARSE_LAST_RECORDS as start token).  The
+       workers take the chunks in the order of the file.  The table of
+       cross-references is shared: all accesses to it are serialized via
+       lock_xrefs and unlock_xrefs (see xref.c).
+
+     - In the CB_FILE_ORDER mode, the workers don't call the callbacks and
+       the message handler: they record them (together with copies of the
+       values) in an event log per chunk.  The calling thread waits for the
+       chunks in the order of the file, and replays their events.  The
+       contexts returned by the callbacks are replaced by the events in the
+       workers, and by the real contexts when replaying.  To limit the
+       memory use, the workers don't run ahead more than WINDOW_PER_WORKER
+       chunks per worker.
+
+     - In the CB_UNORDERED mode, the workers simply call the callbacks.
+
+   Files in a two-byte encoding are always parsed by the calling thread
+   alone, as are files that are too small to be divided.
+*/
+
+#include "gedcom_internal.h"
+#include "gedcom.h"
+#include "parser.h"
+#include "parallel.h"
+#include "multilex.h"
+#include "encoding.h"
+#include "reader.h"
+#include "xref.h"
+#include "compat.h"
+#include "gedcom.tabgen.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
+/* This module works with several parsers at the same time, so it doesn't
+   use the shorthands of parser.h */
+#undef line_no
+#undef read_encoding
+#undef error_mechanism
+
+#define CHUNKS_PER_WORKER  8
+#define MIN_CHUNK_SIZE     65536
+#define MAX_CHUNK_SIZE     1048576
+#define WINDOW_PER_WORKER  2
+#define LOG_BLOCK_SIZE     65536
+
+/** This function allows to parse the records of a file in several threads,
+    which is faster for large files on a machine with several processors.
+    It affects all subsequent calls to \ref gedcom_parse_file() (and
+    \ref gom_parse_file()) with the current parser.
+
+    The header of the file is still parsed by the calling thread.  After
+    that, the rest of the file is divided into chunks of records, which
+    are parsed by the worker threads.  The table of cross-references is
+    shared, and checked at the end as usual.
+
+    \param nr_of_workers The number of worker threads; 0 or 1 means that
+    the file is parsed by the calling thread alone (this is the default).
+    \param order Determines how the callbacks are called:
+      - \c CB_FILE_ORDER: the callbacks and the message handler are called
+        from the calling thread, in the order of the file, so that the
+        application doesn't need to be thread-safe (e.g. the Gedcom object
+        model can be used).  The only difference with a normal parse is
+        that a record generated in compatibility mode for a missing family
+        link comes at the end.
+      - \c CB_UNORDERED: the callbacks and the message handler are called
+        from the worker threads, as soon as the records are parsed.
+
+    The setting has no effect if the library was built without thread
+    support, or for files in a two-byte encoding (i.e. UTF-16).
+*/
+void gedcom_set_parallel_parse(int nr_of_workers, Gedcom_cb_order order)
+{
+  PARSER->nr_of_workers = nr_of_workers;
+  PARSER->cb_order      = order;
+}
+
+/*****************************************************************/
+/*  Event logs                                                   */
+/*****************************************************************/
+
+typedef enum _EVENT_TYPE {
+  EV_REC_START,
+  EV_REC_END,
+  EV_ELT_START,
+  EV_ELT_DEFAULT,
+  EV_ELT_END,
+  EV_MESSAGE,
+  EV_BATCH
+} Event_type;
+
+/* A copy of a Gedcom_val; the data is in the event log (or is the
+   xref_value itself, which is shared by all parsers) */
+struct stored_val {
+  int              present;
+  Gedcom_val_type  type;
+  void*            data;
+};
+
+struct event {
+  struct event*      next;
+  Event_type         type;
+  int                id;         /* record, element or message type */
+  int                line;       /* line number at the time of the event */
+  int                level;
+  int                tag_value;
+  char*              tag;        /* the message for EV_MESSAGE */
+  const char*        format;     /* its format */
+  char*              raw_value;
+  struct event*      parent;     /* the start event of the parent */
+  struct event*      self;       /* the start event, for end events */
+  struct stored_val  xref;
+  struct stored_val  value;
+  Gedcom_ctxt        ctxt;       /* the real context (when replaying) */
+  struct batch_line* lines;      /* the record, for EV_BATCH */
+  int                nr_of_lines;
+};
+
+union log_align {
+  double  d;
+  void*   p;
+  long    l;
+};
+
+struct log_block {
+  struct log_block*  next;
+  size_t             used;
+  size_t             size;
+  union log_align    data[1];
+};
+
+struct event_log {
+  struct log_block*  blocks;
+  struct event*      first;
+  struct event*      last;
+  int                failed;
+};
+
+static void* log_alloc(struct event_log* log, size_t size)
+{
+  struct log_block* b = log->blocks;
+  void* result;
+
+  size = (size + sizeof(union log_align) - 1) / sizeof(union log_align)
+         * sizeof(union log_align);
+  if (!b || b->used + size > b->size) {
+    size_t block_size = (size > LOG_BLOCK_SIZE ? size : LOG_BLOCK_SIZE);
+    b = (struct log_block*)malloc(sizeof(struct log_block) + block_size);
+    if (!b) {
+      MEMORY_ERROR;
+      log->failed = 1;
+      return NULL;
+    }
+    b->used = 0;
+    b->size = block_size;
+    b->next = log->blocks;
+    log->blocks = b;
+  }
+  result = (char*)b->data + b->used;
+  b->used += size;
+  return result;
+}
+
+static char* log_strdup(struct event_log* log, const char* str)
+{
+  char* copy = NULL;
+  if (str) {
+    size_t len = strlen(str) + 1;
+    copy = (char*)log_alloc(log, len);
+    if (copy)
+      memcpy(copy, str, len);
+  }
+  return copy;
+}
+
+static void free_log(struct event_log* log)
+{
+  struct log_block* b = log->blocks;
+  while (b) {
+    struct log_block* next = b->next;
+    free(b);
+    b = next;
+  }
+  log->blocks = NULL;
+  log->first  = log->last = NULL;
+}
+
+static void store_val(struct event_log* log, struct stored_val* sv,
+		      Gedcom_val val)
+{
+  sv->present = (val != NULL);
+  sv->data    = NULL;
+  if (val) {
+    /* Parse deferred values here, so that the messages are recorded with
+       the right line */
+    if (val->deferred)
+      gedcom_resolve_value(val);
+    sv->type = val->type;
+    switch (val->type) {
+      case GV_CHAR_PTR:
+	sv->data = log_strdup(log, val->value.string_val);
+	break;
+      case GV_DATE_VALUE:
+	sv->data = log_alloc(log, sizeof(struct date_value));
+	if (sv->data)
+	  memcpy(sv->data, &val->value.date_val, sizeof(struct date_value));
+	break;
+      case GV_AGE_VALUE:
+	sv->data = log_alloc(log, sizeof(struct age_value));
+	if (sv->data)
+	  memcpy(sv->data, &val->value.age_val, sizeof(struct age_value));
+	break;
+      case GV_XREF_PTR:
+	sv->data = val->value.xref_val;
+	break;
+      default:
+	break;
+    }
+  }
+}
+
+static Gedcom_val load_val(struct stored_val* sv, Gedcom_val_struct* val)
+{
+  if (!sv->present)
+    return NULL;
+  val->type = sv->type;
+  val->deferred = NULL;
+  val->value.string_val = NULL;
+  switch (sv->type) {
+    case GV_CHAR_PTR:
+      val->value.string_val = (char*)sv->data;
+      break;
+    case GV_DATE_VALUE:
+      if (sv->data)
+	val->value.date_val = *(struct date_value*)sv->data;
+      else
+	val->value.date_val = def_date_val;
+      break;
+    case GV_AGE_VALUE:
+      if (sv->data)
+	val->value.age_val = *(struct age_value*)sv->data;
+      else
+	val->value.age_val = def_age_val;
+      break;
+    case GV_XREF_PTR:
+      val->value.xref_val = (struct xref_value*)sv->data;
+      break;
+    default:
+      break;
+  }
+  return val;
+}
+
+static struct event* new_event(Event_type type, int id)
+{
+  struct event_log* log = PARSER->recorder;
+  struct event* ev = (struct event*)log_alloc(log, sizeof(struct event));
+  if (ev) {
+    memset(ev, 0, sizeof(struct event));
+    ev->type = type;
+    ev->id   = id;
+    ev->line = PARSER->line_no;
+    if (log->last)
+      log->last->next = ev;
+    else
+      log->first = ev;
+    log->last = ev;
+  }
+  return ev;
+}
+
+Gedcom_ctxt record_start_record(Gedcom_rec rec, int level, Gedcom_val xref,
+				struct tag_struct tag, char *raw_value,
+				Gedcom_val parsed_value)
+{
+  struct event_log* log = PARSER->recorder;
+  struct event* ev = new_event(EV_REC_START, rec);
+  if (ev) {
+    ev->level     = level;
+    ev->tag       = log_strdup(log, tag.string);
+    ev->tag_value = tag.value;
+    ev->raw_value = log_strdup(log, raw_value);
+    store_val(log, &ev->xref, xref);
+    store_val(log, &ev->value, parsed_value);
+  }
+  return (Gedcom_ctxt)ev;
+}
+
+void record_end_record(Gedcom_rec rec, Gedcom_ctxt self,
+		       Gedcom_val parsed_value)
+{
+  struct event* ev = new_event(EV_REC_END, rec);
+  if (ev) {
+    ev->self = (struct event*)self;
+    store_val(PARSER->recorder, &ev->value, parsed_value);
+  }
+}
+
+Gedcom_ctxt record_start_element(Gedcom_elt elt, Gedcom_ctxt parent,
+				 int level, struct tag_struct tag,
+				 char *raw_value, Gedcom_val parsed_value)
+{
+  struct event_log* log = PARSER->recorder;
+  struct event* ev = new_event(EV_ELT_START, elt);
+  if (ev) {
+    ev->parent    = (struct event*)parent;
+    ev->level     = level;
+    ev->tag       = log_strdup(log, tag.string);
+    ev->tag_value = tag.value;
+    ev->raw_value = log_strdup(log, raw_value);
+    store_val(log, &ev->value, parsed_value);
+  }
+  return (Gedcom_ctxt)ev;
+}
+
+void record_default(Gedcom_elt elt, Gedcom_ctxt parent, int level,
+		    struct tag_struct tag, char *raw_value)
+{
+  struct event_log* log = PARSER->recorder;
+  struct event* ev = new_event(EV_ELT_DEFAULT, elt);
+  if (ev) {
+    ev->parent    = (struct event*)parent;
+    ev->level     = level;
+    ev->tag       = log_strdup(log, tag.string);
+    ev->tag_value = tag.value;
+    ev->raw_value = log_strdup(log, raw_value);
+  }
+}
+
+void record_end_element(Gedcom_elt elt, Gedcom_ctxt parent,
+			Gedcom_ctxt self, Gedcom_val parsed_value)
+{
+  struct event* ev = new_event(EV_ELT_END, elt);
+  if (ev) {
+    ev->parent = (struct event*)parent;
+    ev->self   = (struct event*)self;
+    store_val(PARSER->recorder, &ev->value, parsed_value);
+  }
+}
+
+void record_message(Gedcom_msg_type type, const char* format,
+		    const char* msg)
+{
+  struct event* ev = new_event(EV_MESSAGE, type);
+  if (ev) {
+    ev->format = format;
+    ev->tag    = log_strdup(PARSER->recorder, msg);
+  }
+}
+
+void record_batch(Gedcom_rec rec, const struct batch_line* lines,
+		  int nr_of_lines)
+{
+  struct event_log* log = PARSER->recorder;
+  struct event* ev = new_event(EV_BATCH, rec);
+  struct batch_line* copy;
+  int i;
+
+  if (!ev)
+    return;
+  copy = (struct batch_line*)log_alloc(log,
+				       nr_of_lines * sizeof(struct batch_line));
+  if (!copy)
+    return;
+  for (i = 0; i < nr_of_lines; i++) {
+    Gedcom_val_struct* value
+      = (Gedcom_val_struct*)log_alloc(log, sizeof(Gedcom_val_struct));
+    if (!value)
+      return;
+    copy[i]           = lines[i];
+    copy[i].tag       = log_strdup(log, lines[i].tag);
+    copy[i].raw_value = log_strdup(log, lines[i].raw_value);
+    *value = *lines[i].parsed_value;
+    if (value->type == GV_CHAR_PTR)
+      value->value.string_val = log_strdup(log, value->value.string_val);
+    copy[i].parsed_value = value;
+  }
+  ev->lines       = copy;
+  ev->nr_of_lines = nr_of_lines;
+}
+
+static Gedcom_ctxt real_ctxt(struct event* ev)
+{
+  return (ev ? ev->ctxt : NULL);
+}
+
+/* Calls the callbacks of the current parser for the events in the log */
+static void replay_log(struct event_log* log)
+{
+  struct event* ev;
+  Gedcom_val_struct xref, value;
+
+  for (ev = log->first; ev; ev = ev->next) {
+    PARSER->line_no = ev->line;
+    switch (ev->type) {
+      case EV_REC_START: {
+	Gedcom_rec_start_cb cb = PARSER->record_start_callback[ev->id];
+	if (cb)
+	  ev->ctxt = (*cb)(ev->id, ev->level, load_val(&ev->xref, &xref),
+			   ev->tag, ev->raw_value, ev->tag_value,
+			   load_val(&ev->value, &value));
+	break;
+      }
+      case EV_REC_END: {
+	Gedcom_rec_end_cb cb = PARSER->record_end_callback[ev->id];
+	if (cb)
+	  (*cb)(ev->id, real_ctxt(ev->self), load_val(&ev->value, &value));
+	break;
+      }
+      case EV_ELT_START: {
+	Gedcom_elt_start_cb cb = PARSER->element_start_callback[ev->id];
+	if (cb)
+	  ev->ctxt = (*cb)(ev->id, real_ctxt(ev->parent), ev->level, ev->tag,
+			   ev->raw_value, ev->tag_value,
+			   load_val(&ev->value, &value));
+	break;
+      }
+      case EV_ELT_DEFAULT: {
+	Gedcom_ctxt parent = real_ctxt(ev->parent);
+	if (PARSER->default_cb && parent)
+	  (*PARSER->default_cb)(ev->id, parent, ev->level, ev->tag,
+				ev->raw_value, ev->tag_value);
+	break;
+      }
+      case EV_ELT_END: {
+	Gedcom_elt_end_cb cb = PARSER->element_end_callback[ev->id];
+	if (cb)
+	  (*cb)(ev->id, real_ctxt(ev->parent), real_ctxt(ev->self),
+		load_val(&ev->value, &value));
+	break;
+      }
+      case EV_MESSAGE:
+	replay_message(ev->id, ev->format, ev->tag);
+	break;
+      case EV_BATCH: {
+	Gedcom_rec_batch_cb cb = PARSER->record_batch_callback[ev->id];
+	if (cb && ev->lines)
+	  (*cb)(ev->id, ev->lines, ev->nr_of_lines);
+	break;
+      }
+    }
+  }
+}
+
+#ifdef HAVE_LIBPTHREAD
+
+/*****************************************************************/
+/*  Dividing the file                                            */
+/*****************************************************************/
+
+struct chunk {
+  off_t              start;
+  off_t              end;
+  int                lines;      /* number of lines before the chunk */
+  int                last;
+  int                done;
+  int                result;
+  struct event_log   log;
+};
+
+struct parallel_parse {
+  Gedcom_parser_hndl main;
+  off_t              header_end;
+  struct chunk*      chunks;
+  int                nr_of_chunks;
+  int                nr_allocated;
+  int                next_chunk;     /* the next chunk to parse */
+  int                next_replay;    /* the next chunk to replay */
+  int                window;         /* max chunks parsed ahead of replay */
+  int                stop;
+  pthread_mutex_t    lock;
+  pthread_cond_t     cond;
+  pthread_mutex_t    xref_lock;
+};
+
+static int add_chunk(struct parallel_parse* pp, off_t start, off_t end,
+		     int lines)
+{
+  struct chunk* c;
+  if (pp->nr_of_chunks == pp->nr_allocated) {
+    int new_size = (pp->nr_allocated ? pp->nr_allocated * 2 : 64);
+    struct chunk* new_chunks
+      = (struct chunk*)realloc(pp->chunks, new_size * sizeof(struct chunk));
+    if (!new_chunks) {
+      MEMORY_ERROR;
+      return 0;
+    }
+    pp->chunks       = new_chunks;
+    pp->nr_allocated = new_size;
+  }
+  c = &pp->chunks[pp->nr_of_chunks++];
+  memset(c, 0, sizeof(struct chunk));
+  c->start = start;
+  c->end   = end;
+  c->lines = lines;
+  return 1;
+}
+
+/* Scans the file from its current position (start) for the level 0 lines,
+   i.e. a '0' followed by a space at the start of a line.  The first one
+   ends the header, and the rest of the file is divided into chunks of at
+   least chunk_size bytes.  The lines are counted in the same way as in the
+   lexer: a terminator is CR, LF, CR LF or LF CR.
+
+   Returns the number of chunks of records, or -1 on errors.
+*/
+static int split_file(struct parallel_parse* pp, FILE* file, off_t start,
+		      off_t chunk_size)
+{
+  char* buffer;
+  size_t len, i;
+  off_t pos = start, zero = -1, chunk_start = -1;
+  int lines = 0, zero_lines = 0, chunk_lines = 0;
+  int line_start = 1;
+  char pending = '\0';
+
+  buffer = (char*)malloc(READER_BLOCK_SIZE);
+  if (!buffer) {
+    MEMORY_ERROR;
+    return -1;
+  }
+
+  pp->header_end = -1;
+  while ((len = fread(buffer, 1, READER_BLOCK_SIZE, file)) > 0) {
+    for (i = 0; i < len; i++, pos++) {
+      char c = buffer[i];
+      if (zero >= 0) {
+	if (c == ' ') {
+	  /* A level 0 line starts at 'zero' */
+	  if (pp->header_end < 0) {
+	    pp->header_end = zero;
+	    chunk_start    = zero;
+	    chunk_lines    = zero_lines;
+	  }
+	  else if (zero - chunk_start >= chunk_size) {
+	    if (!add_chunk(pp, chunk_start, zero, chunk_lines)) {
+	      free(buffer);
+	      return -1;
+	    }
+	    chunk_start = zero;
+	    chunk_lines = zero_lines;
+	  }
+	}
+	zero = -1;
+      }
+      if (c == '\x0D' || c == '\x0A') {
+	if (pending && c != pending)
+	  pending = '\0';
+	else {
+	  lines++;
+	  pending = c;
+	}
+	line_start = 1;
+      }
+      else {
+	if (line_start && c == '0' && pos > start) {
+	  zero       = pos;
+	  zero_lines = lines;
+	}
+	pending    = '\0';
+	line_start = 0;
+      }
+    }
+  }
+  free(buffer);
+
+  if (ferror(file)) {
+    gedcom_error(_("Error reading from input file: %s"), strerror(errno));
+    return -1;
+  }
+  if (chunk_start >= 0 && pos > chunk_start) {
+    if (!add_chunk(pp, chunk_start, pos, chunk_lines))
+      return -1;
+    pp->chunks[pp->nr_of_chunks - 1].last = 1;
+  }
+  return pp->nr_of_chunks;
+}
+
+/*****************************************************************/
+/*  Parsing the chunks                                           */
+/*****************************************************************/
+
+struct worker {
+  struct parallel_parse* pp;
+  Gedcom_parser_hndl     parser;
+  FILE*                  file;
+  pthread_t              thread;
+  int                    started;
+};
+
+/* Parses the header with the current parser; the cross-reference table is
+   presized for the given size of the whole file */
+static int parse_header(Encoding enc, FILE* file, off_t length,
+			off_t file_size)
+{
+  int result = 1;
+  if (lexer_init(enc, file)) {
+    reader_set_limit(length);
+    PARSER->line_no = 0;
+    make_xref_table(file_size);
+    PARSER->start_token = PARSE_HEAD;
+    result = gedcom_parse();
+    PARSER->start_token = 0;
+  }
+  lexer_close();
+  return result;
+}
+
+/* Parses a chunk of records with the current parser; if log is not NULL,
+   the callbacks are recorded in it */
+static int parse_chunk(struct chunk* c, FILE* file, struct event_log* log)
+{
+  int result = 1;
+  /* open_conv_to_internal sets the charset of the read encoding again, so
+     it gets a copy */
+  char charset[MAX_CHARSET_LEN + 1];
+
+  strcpy(charset, PARSER->read_encoding.charset);
+
+  PARSER->recorder = log;
+  if (fseeko(file, c->start, SEEK_SET) != 0)
+    gedcom_error(_("Error positioning input file: %s"), strerror(errno));
+  else if (gedcom_1byte_myinit(file) && reader_open(file)) {
+    reader_set_limit(c->end - c->start);
+    if (open_conv_to_internal(charset)) {
+      reader_start_conversion();
+      PARSER->line_no     = c->lines;
+      PARSER->count_level = 0;
+      PARSER->fail        = 0;
+      PARSER->start_token = (c->last ? PARSE_LAST_RECORDS : PARSE_RECORDS);
+      result = gedcom_parse();
+      PARSER->start_token = 0;
+    }
+  }
+  lexer_close();
+  PARSER->recorder = NULL;
+  if (log && log->failed)
+    result = 1;
+  return result;
+}
+
+static void copy_settings(struct worker* w)
+{
+  Gedcom_parser_hndl to = w->parser, from = w->pp->main;
+
+  to->error_mechanism       = from->error_mechanism;
+  to->compat_disabled       = from->compat_disabled;
+  to->compat_options        = from->compat_options;
+  to->msg_handler           = from->msg_handler;
+  to->msg_info_handler      = from->msg_info_handler;
+  to->msg_limit             = from->msg_limit;
+  to->default_cb            = from->default_cb;
+  to->date_cache_size       = from->date_cache_size;
+  to->skip_options          = from->skip_options;
+  memcpy(to->record_batch_callback, from->record_batch_callback,
+	 sizeof(from->record_batch_callback));
+  memcpy(to->record_start_callback, from->record_start_callback,
+	 sizeof(from->record_start_callback));
+  memcpy(to->record_end_callback, from->record_end_callback,
+	 sizeof(from->record_end_callback));
+  memcpy(to->element_start_callback, from->element_start_callback,
+	 sizeof(from->element_start_callback));
+  memcpy(to->element_end_callback, from->element_end_callback,
+	 sizeof(from->element_end_callback));
+
+  /* What the header determined */
+  to->read_encoding         = from->read_encoding;
+  to->compatibility         = from->compatibility;
+  to->compatibility_program = from->compatibility_program;
+  to->compatibility_version = from->compatibility_version;
+  to->default_charset       = from->default_charset;
+
+  to->xrefs     = from->xrefs;
+  to->xref_lock = &w->pp->xref_lock;
+  to->worker    = 1;
+}
+
+static struct chunk* take_chunk(struct parallel_parse* pp)
+{
+  struct chunk* c = NULL;
+  pthread_mutex_lock(&pp->lock);
+  while (!pp->stop && pp->next_chunk < pp->nr_of_chunks
+	 && pp->next_chunk >= pp->next_replay + pp->window)
+    pthread_cond_wait(&pp->cond, &pp->lock);
+  if (!pp->stop && pp->next_chunk < pp->nr_of_chunks)
+    c = &pp->chunks[pp->next_chunk++];
+  pthread_mutex_unlock(&pp->lock);
+  return c;
+}
+
+static void finish_chunk(struct parallel_parse* pp, struct chunk* c,
+			 int result)
+{
+  pthread_mutex_lock(&pp->lock);
+  c->result = result;
+  c->done   = 1;
+  if (result != 0 && pp->main->error_mechanism == IMMED_FAIL)
+    pp->stop = 1;
+  pthread_cond_broadcast(&pp->cond);
+  pthread_mutex_unlock(&pp->lock);
+}
+
+static void* run_worker(void* arg)
+{
+  struct worker* w = (struct worker*)arg;
+  struct parallel_parse* pp = w->pp;
+  int record = (pp->main->cb_order == CB_FILE_ORDER);
+  struct chunk* c;
+
+  gedcom_parser_select(w->parser);
+  while ((c = take_chunk(pp)) != NULL)
+    finish_chunk(pp, c, parse_chunk(c, w->file, record ? &c->log : NULL));
+  return NULL;
+}
+
+/* Waits for the chunks in the order of the file, and calls the callbacks
+   that they recorded */
+static int replay_chunks(struct parallel_parse* pp)
+{
+  int i, done, result = 0;
+
+  for (i = 0; i < pp->nr_of_chunks; i++) {
+    struct chunk* c = &pp->chunks[i];
+
+    pthread_mutex_lock(&pp->lock);
+    while (!c->done && !(pp->stop && i >= pp->next_chunk))
+      pthread_cond_wait(&pp->cond, &pp->lock);
+    done = c->done;
+    pthread_mutex_unlock(&pp->lock);
+    if (!done)
+      break;
+
+    replay_log(&c->log);
+    free_log(&c->log);
+    result |= c->result;
+
+    pthread_mutex_lock(&pp->lock);
+    pp->next_replay = i + 1;
+    pthread_cond_broadcast(&pp->cond);
+    pthread_mutex_unlock(&pp->lock);
+
+    if (c->result != 0 && PARSER->error_mechanism == IMMED_FAIL)
+      break;
+  }
+  return result;
+}
+
+static int parse_chunks(struct parallel_parse* pp, struct worker* workers,
+			int nr_of_workers)
+{
+  int i, started = 0, result = 0;
+
+  for (i = 0; i < nr_of_workers; i++) {
+    copy_settings(&workers[i]);
+    if (pthread_create(&workers[i].thread, NULL, run_worker,
+		       &workers[i]) == 0) {
+      workers[i].started = 1;
+      started++;
+    }
+  }
+
+  if (started == 0) {
+    /* Parse the chunks in this thread, as in a normal parse */
+    gedcom_warning(_("Could not start worker threads, parsing without"));
+    for (i = 0; i < pp->nr_of_chunks && result == 0; i++)
+      result = parse_chunk(&pp->chunks[i], workers[0].file, NULL);
+    return result;
+  }
+
+  if (PARSER->cb_order == CB_FILE_ORDER) {
+    result = replay_chunks(pp);
+
+    /* The replay can stop early, so make sure that the workers stop */
+    pthread_mutex_lock(&pp->lock);
+    pp->stop = 1;
+    pthread_cond_broadcast(&pp->cond);
+    pthread_mutex_unlock(&pp->lock);
+  }
+
+  for (i = 0; i < nr_of_workers; i++)
+    if (workers[i].started)
+      pthread_join(workers[i].thread, NULL);
+
+  if (PARSER->cb_order != CB_FILE_ORDER)
+    for (i = 0; i < pp->nr_of_chunks; i++)
+      result |= pp->chunks[i].result;
+
+  return result;
+}
+
+static int create_workers(struct parallel_parse* pp, struct worker* workers,
+			  int nr_of_workers, const char* file_name)
+{
+  int i;
+  for (i = 0; i < nr_of_workers; i++) {
+    workers[i].pp     = pp;
+    workers[i].parser = gedcom_parser_new();
+    workers[i].file   = fopen(file_name, "r");
+    if (!workers[i].parser || !workers[i].file)
+      return 0;
+  }
+  return 1;
+}
+
+/* Returns the number of family links that the workers generated for
+   C_NO_SLGC_FAMC */
+static int destroy_workers(struct worker* workers, int nr_of_workers)
+{
+  int i, slgc_famc_links = 0;
+  for (i = 0; i < nr_of_workers; i++) {
+    if (workers[i].parser) {
+      slgc_famc_links += workers[i].parser->compat_state[C_NO_SLGC_FAMC].i;
+      PARSER->date_cache_hits   += workers[i].parser->date_cache_hits;
+      PARSER->date_cache_misses += workers[i].parser->date_cache_misses;
+      /* The table of cross-references belongs to the main parser */
+      workers[i].parser->xrefs     = NULL;
+      workers[i].parser->xref_lock = NULL;
+      gedcom_parser_free(workers[i].parser);
+    }
+    if (workers[i].file)
+      fclose(workers[i].file);
+  }
+  free(workers);
+  return slgc_famc_links;
+}
+
+#endif /* HAVE_LIBPTHREAD */
+
+/** Parses the given file (positioned after the byte order mark, if any)
+    with the current parser and the worker threads, if the current parser
+    is set up for it.  Returns -1 if the file should be parsed in the normal
+    way (in which case the file position is unchanged), otherwise the
+    result of the parse (the cross-references are not checked yet).
+*/
+#ifdef HAVE_LIBPTHREAD
+int parallel_parse_file(Encoding enc, FILE* file, const char* file_name)
+{
+  struct parallel_parse pp;
+  struct worker* workers;
+  struct stat st;
+  off_t start, chunk_size;
+  int i, nr_of_workers, result;
+
+  if (PARSER->nr_of_workers < 2 || enc != ONE_BYTE)
+    return -1;
+  start = ftello(file);
+  if (start < 0 || fstat(fileno(file), &st) != 0)
+    return -1;
+
+  memset(&pp, 0, sizeof(pp));
+  pp.main = PARSER;
+  chunk_size = (st.st_size - start)
+               / (PARSER->nr_of_workers * CHUNKS_PER_WORKER);
+  if (chunk_size < MIN_CHUNK_SIZE)
+    chunk_size = MIN_CHUNK_SIZE;
+  else if (chunk_size > MAX_CHUNK_SIZE)
+    chunk_size = MAX_CHUNK_SIZE;
+
+  nr_of_workers = split_file(&pp, file, start, chunk_size);
+  if (fseeko(file, start, SEEK_SET) != 0 || nr_of_workers < 2) {
+    free(pp.chunks);
+    return -1;
+  }
+  if (nr_of_workers > PARSER->nr_of_workers)
+    nr_of_workers = PARSER->nr_of_workers;
+
+  workers = (struct worker*)calloc(nr_of_workers, sizeof(struct worker));
+  if (!workers || !create_workers(&pp, workers, nr_of_workers, file_name)) {
+    if (workers)
+      destroy_workers(workers, nr_of_workers);
+    else
+      MEMORY_ERROR;
+    free(pp.chunks);
+    return -1;
+  }
+
+  pp.window = (PARSER->cb_order == CB_FILE_ORDER ?
+	       nr_of_workers * WINDOW_PER_WORKER : pp.nr_of_chunks);
+  pthread_mutex_init(&pp.lock, NULL);
+  pthread_cond_init(&pp.cond, NULL);
+  pthread_mutex_init(&pp.xref_lock, NULL);
+
+  result = parse_header(enc, file, pp.header_end - start,
+			st.st_size - start);
+  if (result == 0) {
+    PARSER->xref_lock = &pp.xref_lock;
+    result = parse_chunks(&pp, workers, nr_of_workers);
+    PARSER->xref_lock = NULL;
+  }
+  PARSER->line_no = 0;
+  compat_parallel_close(destroy_workers(workers, nr_of_workers));
+
+  for (i = 0; i < pp.nr_of_chunks; i++)
+    free_log(&pp.chunks[i].log);
+  free(pp.chunks);
+  pthread_mutex_destroy(&pp.lock);
+  pthread_cond_destroy(&pp.cond);
+  pthread_mutex_destroy(&pp.xref_lock);
+  return result;
+}
+#else
+int parallel_parse_file(Encoding enc UNUSED, FILE* file UNUSED,
+			const char* file_name UNUSED)
+{
+  return -1;
+}
+#endif
+
+void lock_xrefs()
+{
+#ifdef HAVE_LIBPTHREAD
+  if (PARSER->xref_lock)
+    pthread_mutex_lock((pthread_mutex_t*)PARSER->xref_lock);
+#endif
+}
+
+void unlock_xrefs()
+{
+#ifdef HAVE_LIBPTHREAD
+  if (PARSER->xref_lock)
+    pthread_mutex_unlock((pthread_mutex_t*)PARSER->xref_lock);
+#endif
+}
@@ -0,0 +1,57 @@
+/* Header for parallel.c
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#ifndef __PARALLEL_H
+#define __PARALLEL_H
+
+#include <stdio.h>
+#include "gedcom_internal.h"
+#include "gedcom.h"
+
+int  parallel_parse_file(Encoding enc, FILE* file, const char* file_name);
+
+void lock_xrefs();
+void unlock_xrefs();
+
+/* Recording of the callbacks in the worker parsers */
+Gedcom_ctxt record_start_record(Gedcom_rec rec, int level, Gedcom_val xref,
+				struct tag_struct tag, char *raw_value,
+				Gedcom_val parsed_value);
+void        record_end_record(Gedcom_rec rec, Gedcom_ctxt self,
+			      Gedcom_val parsed_value);
+Gedcom_ctxt record_start_element(Gedcom_elt elt, Gedcom_ctxt parent,
+				 int level, struct tag_struct tag,
+				 char *raw_value, Gedcom_val parsed_value);
+void        record_default(Gedcom_elt elt, Gedcom_ctxt parent, int level,
+			   struct tag_struct tag, char *raw_value);
+void        record_end_element(Gedcom_elt elt, Gedcom_ctxt parent,
+			       Gedcom_ctxt self, Gedcom_val parsed_value);
+void        record_message(Gedcom_msg_type type, const char* format,
+			   const char* msg);
+void        record_batch(Gedcom_rec rec, const struct batch_line* lines,
+			 int nr_of_lines);
+
+/* Replaying the messages (in message.c) */
+void        replay_message(Gedcom_msg_type type, const char* format,
+			   char* text);
+
+#endif /* __PARALLEL_H */
@@ -0,0 +1,154 @@
+/* Parser handles.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#include "gedcom_internal.h"
+#include "gedcom.h"
+#include "parser.h"
+#include "multilex.h"
+#include "encoding.h"
+#include "reader.h"
+#include "xref.h"
+#include "date.h"
+#include "batch.h"
+
+void clean_up();
+void cleanup_countarrays();
+
+/* The parser that is used when no other parser is selected (i.e. by the
+   functions of the library as they existed before parser handles) */
+static struct Gedcom_parser_struct default_parser;
+
+THREAD_LOCAL struct Gedcom_parser_struct* gedcom_current_parser
+  = &default_parser;
+
+/* Frees everything that the current parser allocated during parsing; the
+   settings are kept */
+static void cleanup_parser()
+{
+  clean_up();
+  cleanup_countarrays();
+  gedcom_1byte_mycleanup();
+  cleanup_gedcom_date_lex();
+  cleanup_date_cache();
+  reader_close();
+  close_conv_to_internal();
+  cleanup_xrefs();
+  cleanup_batch();
+  cleanup_buffer(&PARSER->line_item_buffer);
+  cleanup_buffer(&PARSER->concat_buffer);
+  cleanup_buffer(&PARSER->usertag_buffer);
+  cleanup_buffer(&compat_buffer);
+  cleanup_buffer(&PARSER->date_buffer);
+  cleanup_buffer(&PARSER->age_buffer);
+  cleanup_buffer(&PARSER->mess_buffer);
+  cleanup_messages();
+}
+
+static void cleanup_default_parser()
+{
+  PARSER = &default_parser;
+  cleanup_parser();
+}
+
+int register_parser_cleanup()
+{
+  return atexit(cleanup_default_parser);
+}
+
+/** This function creates a new parser.  A parser has its own settings
+    (message handler, error handling, compatibility handling and callbacks)
+    and its own parse state (including the cross-reference table), so that
+    different parsers can parse at the same time in different threads.
+
+    The new parser starts with the default settings; use
+    \ref gedcom_parser_select() to change them via the normal functions.
+
+    \return A handle for the new parser, or \c NULL in case of memory errors.
+ */
+Gedcom_parser_hndl gedcom_parser_new()
+{
+  Gedcom_parser_hndl parser
+    = (Gedcom_parser_hndl)calloc(1, sizeof(struct Gedcom_parser_struct));
+  if (!parser)
+    MEMORY_ERROR;
+  return parser;
+}
+
+/** This function makes the given parser the current parser of the calling
+    thread.  All functions of the library that have no parser handle
+    argument (e.g. \ref gedcom_set_message_handler(),
+    \ref gedcom_subscribe_to_record(), \ref gedcom_parse_file() and
+    \ref gedcom_get_by_xref()) work on the current parser.  Initially, this
+    is the default parser, in every thread.
+
+    \param parser The parser to select, or \c NULL to select the default
+    parser.
+
+    \return The parser that was current before (which can be passed to this
+    function again to restore it).
+ */
+Gedcom_parser_hndl gedcom_parser_select(Gedcom_parser_hndl parser)
+{
+  Gedcom_parser_hndl previous = PARSER;
+  PARSER = (parser ? parser : &default_parser);
+  return previous;
+}
+
+/** This function parses the given file with the given parser, in the same
+    way as \ref gedcom_parse_file().  The parser is the current parser of
+    the calling thread during the parse (so also in the callbacks), and the
+    previously current parser is restored afterwards.
+
+    A parser can only be used in one thread at the same time, but different
+    parsers can parse at the same time.  Note that the callbacks are called
+    from the parsing thread, and that the Gedcom object model (see gom.h)
+    can only be used from one parser.
+
+    \param parser The parser to use (\c NULL means the default parser)
+    \param file_name The name of the Gedcom file to parse
+
+    \return The same return values as \ref gedcom_parse_file().
+ */
+int gedcom_parser_parse(Gedcom_parser_hndl parser, const char* file_name)
+{
+  Gedcom_parser_hndl previous = gedcom_parser_select(parser);
+  int result = gedcom_parse_file(file_name);
+  gedcom_parser_select(previous);
+  return result;
+}
+
+/** This function frees the given parser, including its cross-reference
+    table.  If the parser is the current parser of the calling thread, the
+    default parser becomes the current parser.
+
+    \param parser The parser to free; the default parser cannot be freed
+    (passing \c NULL does nothing).
+ */
+void gedcom_parser_free(Gedcom_parser_hndl parser)
+{
+  if (parser && parser != &default_parser) {
+    Gedcom_parser_hndl previous = gedcom_parser_select(parser);
+    cleanup_parser();
+    gedcom_parser_select(previous == parser ? NULL : previous);
+    free(parser);
+  }
+}
@@ -0,0 +1,174 @@
+/* Header for parser.c
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#ifndef __PARSER_H
+#define __PARSER_H
+
+#include "gedcom_internal.h"
+#include "gedcom.h"
+#include "buffer.h"
+#include "utf8tools.h"
+#include "encoding_state.h"
+#include "reader.h"
+#include "compat.h"
+#include "date.h"
+
+struct event_log;
+struct count_array;
+struct date_cache_entry;
+struct xref_table;
+struct batch;
+struct msg_count;
+
+/* THREAD_LOCAL is defined by configure (empty if the compiler doesn't
+   support thread-local storage) */
+#ifndef THREAD_LOCAL
+#define THREAD_LOCAL
+#endif
+
+/* All the state of a parse.  Everything that is not a constant table
+   lives here, so that different parsers can be used at the same time in
+   different threads.
+
+   The modules access the state of the current parser via PARSER; most of
+   them define shorthands for their own members, the shorthands for members
+   that are used in more than one module are given below.
+*/
+struct Gedcom_parser_struct {
+  /* Settings (these keep their value from one parse to the next); they
+     are all zero by default */
+  Gedcom_err_mech      error_mechanism;
+  int                  compat_disabled;
+  Gedcom_compat        compat_options;
+  Gedcom_msg_handler   msg_handler;
+  Gedcom_msg_info_handler msg_info_handler;
+  unsigned long        msg_limit;
+  Gedcom_def_cb        default_cb;
+  Gedcom_rec_start_cb  record_start_callback [NR_OF_RECS];
+  Gedcom_rec_end_cb    record_end_callback   [NR_OF_RECS];
+  Gedcom_elt_start_cb  element_start_callback[NR_OF_ELTS];
+  Gedcom_elt_end_cb    element_end_callback  [NR_OF_ELTS];
+  int                  nr_of_workers;
+  Gedcom_cb_order      cb_order;
+  int                  date_cache_size;
+  Gedcom_skip          skip_options;
+  Gedcom_rec_batch_cb  record_batch_callback [NR_OF_RECS];
+
+  /* Input (multilex.c, reader.c, encoding.c, encoding_state.c) */
+  int                  line_no;
+  struct encoding_state read_encoding;
+  convert_t            to_int;
+  int                  to_int_identity;
+  char                 to_int_pending[4];
+  size_t               to_int_pending_len;
+  struct reader        reader;
+
+  /* Lexer (gedcom_lex_common.c) */
+  void*                scanner;
+  int                  start_token;
+  int                  current_level;
+  int                  level_diff;
+  size_t               line_len;
+  int                  tab_space;
+  int                  current_tag;
+  int                  input_line;
+  int                  dummy_conv;
+  struct conv_buffer*  ptr_buffer;
+  struct conv_buffer*  tag_buffer;
+  struct conv_buffer*  str_buffer;
+
+  /* Grammar (gedcom.y) */
+  int                  count_level;
+  int                  fail;
+  Gedcom_val_struct    val1;
+  Gedcom_val_struct    val2;
+  struct count_array*  count_arrays[MAXGEDCLEVEL+1];
+  char                 tag_stack[MAXGEDCLEVEL+1][MAXSTDTAGLEN+1];
+  Gedcom_ctxt          ctxt_stack[MAXGEDCLEVEL+1];
+  struct safe_buffer   line_item_buffer;
+  struct safe_buffer   concat_buffer;
+  struct safe_buffer   usertag_buffer;
+
+  /* Cross-references (xref.c) */
+  struct xref_table*   xrefs;
+
+  /* Compatibility (compat.c) */
+  int                  compatibility;
+  int                  compatibility_program;
+  int                  compatibility_version;
+  const char*          default_charset;
+  union _COMPAT_STATE  compat_state[C_NR_OF_RULES];
+  char                 compat_prefix[MAXGEDCLINELEN];
+  struct safe_buffer   compat_buffer;
+
+  /* Dates and ages (date.c, gedcom_date.lex, age.c) */
+  struct date_value    dv_s;
+  struct date          date_s;
+  struct date          def_date;
+  const char*          curr_line_value;
+  void*                date_scanner;
+  void*                date_buffer_state;
+  char                 date_token[MAX_DATE_TOKEN][MAX_PHRASE_LEN+1];
+  int                  date_token_nr;
+  struct safe_buffer   date_buffer;
+  struct date_cache_entry* date_cache;
+  unsigned long        date_cache_hits;
+  unsigned long        date_cache_misses;
+  struct age_value     age_s;
+  struct safe_buffer   age_buffer;
+
+  /* Batch callbacks (batch.c) */
+  struct batch*        batch;
+  int                  batch_active;
+
+  /* Messages (message.c) */
+  struct safe_buffer   mess_buffer;
+  struct msg_count*    msg_counts;
+  size_t               msg_counts_size;
+  size_t               msg_counts_used;
+  unsigned long        msg_reported;
+  unsigned long        msg_suppressed;
+
+  /* Parallel parse (parallel.c) */
+  int                  worker;
+  void*                xref_lock;
+  struct event_log*    recorder;
+};
+
+extern THREAD_LOCAL struct Gedcom_parser_struct* gedcom_current_parser;
+
+#define PARSER gedcom_current_parser
+
+int register_parser_cleanup();
+
+#define line_no          (PARSER->line_no)
+#define read_encoding    (PARSER->read_encoding)
+#define error_mechanism  (PARSER->error_mechanism)
+#define val1             (PARSER->val1)
+#define val2             (PARSER->val2)
+#define compat_buffer    (PARSER->compat_buffer)
+#define dv_s             (PARSER->dv_s)
+#define date_s           (PARSER->date_s)
+#define def_date         (PARSER->def_date)
+#define curr_line_value  (PARSER->curr_line_value)
+
+#endif /* __PARSER_H */
@@ -0,0 +1,475 @@
+/* Input reader for the lexer.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+/* The reader delivers the input file to the lexer (via YY_INPUT).
+
+   Until the character set of the file is known (i.e. until the header
+   is completely parsed), the input is handed over unconverted, one line
+   at a time, and the lexer converts token per token (see TO_INTERNAL in
+   gedcom_lex_common.c).  Once the character set is known, the input is
+   converted to UTF-8 in blocks of READER_BLOCK_SIZE bytes, and the lexer
+   just takes the tokens as they are.  For ASCII and UTF-8 files, the input
+   is only checked, not converted.
+
+   The lexer knows which tokens still need conversion by comparing its line
+   count with the number of lines that were handed over unconverted (see
+   reader_line_converted).  Since the conversion keeps the line terminators,
+   line numbers don't change.
+
+   An invalid character in the input is replaced by READER_INVALID_CHAR,
+   and the original character is kept in a queue; the lexer takes it from
+   there when it encounters the replacement (see reader_invalid_char), so
+   that the error message is the same as before and on the correct line.
+   The replacement is done while handing over the input: the raw input is
+   never modified.
+
+   The input can also be a block of memory (e.g. a mapped file, see
+   reader_open_memory).  In that case, the raw buffer is the memory itself,
+   so nothing needs to be read or moved.
+*/
+
+#include "gedcom_internal.h"
+#include "gedcom.h"
+#include "encoding_state.h"
+#include "reader.h"
+#include "parser.h"
+#include "utf8tools.h"
+#include <string.h>
+
+/* The converted output can be larger than the input */
+#define READER_CONV_SIZE (READER_BLOCK_SIZE * UTF_FACTOR)
+
+#define INITIAL_INVALID_SIZE 64
+
+/* The state of the reader is kept in the current parser (see parser.h) */
+#define rd (PARSER->reader)
+
+static void push_invalid(char c)
+{
+  if (rd.invalid_tail == rd.invalid_size) {
+    if (rd.invalid_head > 0) {
+      memmove(rd.invalid, rd.invalid + rd.invalid_head,
+	      rd.invalid_tail - rd.invalid_head);
+      rd.invalid_tail -= rd.invalid_head;
+      rd.invalid_head = 0;
+    }
+    else {
+      size_t new_size = (rd.invalid_size ?
+			 rd.invalid_size * 2 : INITIAL_INVALID_SIZE);
+      char* new_invalid = (char*)realloc(rd.invalid, new_size);
+      if (!new_invalid) {
+	MEMORY_ERROR;
+	return;
+      }
+      rd.invalid      = new_invalid;
+      rd.invalid_size = new_size;
+    }
+  }
+  rd.invalid[rd.invalid_tail++] = c;
+}
+
+/** Returns the original character that was replaced by READER_INVALID_CHAR
+    in the input.  This must be called by the lexer for each occurrence of
+    READER_INVALID_CHAR in converted input, in the order of the input.
+*/
+char reader_invalid_char()
+{
+  if (rd.invalid_head < rd.invalid_tail)
+    return rd.invalid[rd.invalid_head++];
+  else
+    return READER_INVALID_CHAR;
+}
+
+/* Moves what is left in the raw buffer to the front, and reads more */
+static void fill_raw()
+{
+  size_t used = rd.raw_end - rd.raw_start;
+
+  if (rd.in_memory)
+    return;
+
+  if (rd.raw_start > 0) {
+    memmove(rd.raw, rd.raw + rd.raw_start, used);
+    rd.raw_valid = (rd.raw_valid > rd.raw_start ?
+		    rd.raw_valid - rd.raw_start : 0);
+    rd.raw_start = 0;
+    rd.raw_end   = used;
+  }
+
+  if (!rd.eof && rd.raw_end < READER_BLOCK_SIZE) {
+    size_t want = READER_BLOCK_SIZE - rd.raw_end;
+    size_t len = 0;
+    if (rd.limited && want > rd.left)
+      want = rd.left;
+    if (want > 0)
+      len = fread(rd.raw + rd.raw_end, 1, want, rd.file);
+    if (len == 0) {
+      if (ferror(rd.file))
+	gedcom_error(_("Error reading from input file: %s"), strerror(errno));
+      rd.eof = 1;
+    }
+    if (rd.limited)
+      rd.left -= len;
+    rd.raw_end += len;
+  }
+}
+
+static int is_terminator(char c)
+{
+  return (c == '\x0D' || c == '\x0A');
+}
+
+/* Returns the length of the rest of the current line in the raw buffer,
+   including the line terminator (which can be 2 characters, as in the
+   lexer).  If the line continues beyond the buffer, complete is set to 0 */
+static size_t raw_line_length(int* complete)
+{
+  size_t i = rd.raw_start;
+
+  *complete = 1;
+  while (1) {
+    while (i < rd.raw_end && !is_terminator(rd.raw[i]))
+      i++;
+    if (i + 1 < rd.raw_end || (i < rd.raw_end && rd.eof)) {
+      /* Terminator found, and next character is known */
+      if (i + 1 < rd.raw_end && is_terminator(rd.raw[i+1])
+	  && rd.raw[i+1] != rd.raw[i])
+	i++;
+      return i + 1 - rd.raw_start;
+    }
+    else if (rd.eof || (rd.raw_start == 0 && rd.raw_end == READER_BLOCK_SIZE)) {
+      /* End of input, or line doesn't fit in the buffer */
+      *complete = rd.eof;
+      return rd.raw_end - rd.raw_start;
+    }
+    else {
+      i -= rd.raw_start;
+      fill_raw();
+      i += rd.raw_start;
+    }
+  }
+}
+
+/* The check functions advance raw_valid up to the next invalid character
+   (for which raw_invalid is set) or up to the end of the raw input */
+static void check_ascii()
+{
+  size_t i = rd.raw_valid;
+  i += ascii_length(rd.raw + i, rd.raw_end - i);
+  rd.raw_invalid = (i < rd.raw_end);
+  rd.raw_valid   = i;
+}
+
+static void check_utf8()
+{
+  size_t i = rd.raw_valid;
+  int incomplete;
+  i += utf8_valid_length(rd.raw + i, rd.raw_end - i, &incomplete);
+  /* An incomplete sequence at the end waits for the next block */
+  rd.raw_invalid = (i < rd.raw_end && !(incomplete && !rd.eof));
+  rd.raw_valid   = i;
+}
+
+/* Converts as much as possible of the raw input into the conversion
+   buffer (which must be empty) */
+static void convert_block()
+{
+  char* outptr;
+  size_t outsize;
+
+  rd.conv_start = rd.conv_end = 0;
+  outptr  = rd.conv;
+  outsize = READER_CONV_SIZE;
+
+  while (rd.conv_end == 0) {
+    ICONV_CONST char* inptr;
+    size_t insize, res;
+
+    fill_raw();
+    if (rd.raw_start == rd.raw_end) {
+      /* End of input: flush the state of the conversion */
+      iconv(rd.cd, NULL, NULL, &outptr, &outsize);
+      rd.conv_end = outptr - rd.conv;
+      break;
+    }
+
+    inptr  = (ICONV_CONST char*) rd.raw + rd.raw_start;
+    insize = rd.raw_end - rd.raw_start;
+    res = iconv(rd.cd, &inptr, &insize, &outptr, &outsize);
+    rd.raw_start = inptr - rd.raw;
+
+    while (res == (size_t)-1 && outsize > 0
+	   && (errno == EILSEQ || (errno == EINVAL && rd.eof))) {
+      /* Invalid (or at the end of input incomplete) character: replace it
+	 and skip it */
+      size_t skip = (insize < rd.unit ? insize : rd.unit);
+      push_invalid(rd.raw[rd.raw_start]);
+      *outptr++ = READER_INVALID_CHAR;
+      outsize--;
+      rd.raw_start += skip;
+      inptr  += skip;
+      insize -= skip;
+      res = iconv(rd.cd, &inptr, &insize, &outptr, &outsize);
+      rd.raw_start = inptr - rd.raw;
+    }
+    /* For E2BIG the rest is for the next block; for EINVAL the incomplete
+       character at the end is kept for the next block */
+    rd.conv_end = outptr - rd.conv;
+  }
+}
+
+static int read_lines(char* buf, int max_size)
+{
+  size_t len;
+
+  if (rd.line_left == 0) {
+    int complete;
+    if (!rd.line_open && rd.switch_pending) {
+      /* At a line boundary, so switch to the new mode */
+      rd.mode           = rd.next_mode;
+      rd.raw_valid      = rd.raw_start;
+      rd.raw_invalid    = 0;
+      rd.switch_pending = 0;
+      return reader_read(buf, max_size);
+    }
+    rd.line_left = raw_line_length(&complete);
+    if (rd.line_left == 0)
+      return 0;
+    if (!rd.line_open)
+      rd.raw_lines++;
+    rd.line_open = !complete;
+  }
+
+  len = (rd.line_left < (size_t)max_size ? rd.line_left : (size_t)max_size);
+  memcpy(buf, rd.raw + rd.raw_start, len);
+  rd.raw_start += len;
+  rd.line_left -= len;
+  return len;
+}
+
+static int read_checked(char* buf, int max_size)
+{
+  size_t len;
+
+  while (rd.raw_start == rd.raw_valid) {
+    if (rd.raw_invalid) {
+      /* Hand over the replacement of the invalid character */
+      push_invalid(rd.raw[rd.raw_start]);
+      rd.raw_start++;
+      rd.raw_valid++;
+      rd.raw_invalid = 0;
+      buf[0] = READER_INVALID_CHAR;
+      return 1;
+    }
+    if (rd.eof && rd.raw_start == rd.raw_end)
+      return 0;
+    fill_raw();
+    if (rd.mode == READ_ASCII)
+      check_ascii();
+    else
+      check_utf8();
+  }
+
+  len = rd.raw_valid - rd.raw_start;
+  if (len > (size_t)max_size)
+    len = max_size;
+  memcpy(buf, rd.raw + rd.raw_start, len);
+  rd.raw_start += len;
+  return len;
+}
+
+static int read_converted(char* buf, int max_size)
+{
+  size_t len;
+
+  if (rd.conv_start == rd.conv_end) {
+    convert_block();
+    if (rd.conv_start == rd.conv_end)
+      return 0;
+  }
+
+  len = rd.conv_end - rd.conv_start;
+  if (len > (size_t)max_size)
+    len = max_size;
+  memcpy(buf, rd.conv + rd.conv_start, len);
+  rd.conv_start += len;
+  return len;
+}
+
+/** Reads the next piece of input for the lexer (this is used as YY_INPUT).
+    Returns the number of bytes put in buf (at most max_size), or 0 at the
+    end of the input.
+*/
+int reader_read(char* buf, int max_size)
+{
+  if (!rd.raw || max_size <= 0)
+    return 0;
+
+  switch (rd.mode) {
+    case READ_LINES:   return read_lines(buf, max_size);
+    case READ_ASCII:
+    case READ_UTF8:    return read_checked(buf, max_size);
+    case READ_CONVERT: return read_converted(buf, max_size);
+    default:           return 0;
+  }
+}
+
+/** Returns 1 if the given line (counting from 0, as the number of line
+    terminators seen by the lexer) is handed over to the lexer in UTF-8,
+    0 if the lexer still has to convert it.
+*/
+int reader_line_converted(int line)
+{
+  return (rd.mode != READ_LINES && line >= rd.raw_lines);
+}
+
+/** Switches the reader to converting the input in blocks, using the current
+    read encoding (see encoding_state.c).  The switch happens at the start
+    of the next line that is not handed over yet.
+
+    Returns 1 on success, 0 if the conversion couldn't be set up (in which
+    case the input stays unconverted, which is slower but still correct).
+*/
+int reader_start_conversion()
+{
+  const char* encoding = read_encoding.encoding;
+
+  if (!rd.raw)
+    return 0;
+  if (rd.mode != READ_LINES || rd.switch_pending)
+    return 1;
+  if (!encoding)
+    return 0;
+
+  if (!strcmp(encoding, "ASCII"))
+    rd.next_mode = READ_ASCII;
+  else if (!strcmp(encoding, INTERNAL_ENCODING))
+    rd.next_mode = READ_UTF8;
+  else {
+    if (!rd.conv) {
+      rd.conv = (char*)malloc(READER_CONV_SIZE);
+      if (!rd.conv) {
+	MEMORY_ERROR;
+	return 0;
+      }
+    }
+    rd.cd = iconv_open(INTERNAL_ENCODING, encoding);
+    if (rd.cd == (iconv_t)-1)
+      return 0;
+    rd.unit       = (read_encoding.width == ONE_BYTE ? 1 : 2);
+    rd.next_mode  = READ_CONVERT;
+    rd.conv_start = rd.conv_end = 0;
+  }
+  rd.switch_pending = 1;
+  return 1;
+}
+
+static void reset_reader()
+{
+  rd.limited        = 0;
+  rd.mode           = READ_LINES;
+  rd.next_mode      = READ_LINES;
+  rd.switch_pending = 0;
+  rd.raw_start      = rd.raw_valid = 0;
+  rd.raw_invalid    = 0;
+  rd.conv_start     = rd.conv_end = 0;
+  rd.unit           = 1;
+  rd.raw_lines      = 0;
+  rd.line_left      = 0;
+  rd.line_open      = 0;
+  rd.invalid_head   = rd.invalid_tail = 0;
+}
+
+/** Starts reading from the given file (from its current position).
+    Returns 1 on success, 0 on failure.
+*/
+int reader_open(FILE* f)
+{
+  reader_close();
+  rd.raw = (char*)malloc(READER_BLOCK_SIZE);
+  if (!rd.raw) {
+    MEMORY_ERROR;
+    return 0;
+  }
+  reset_reader();
+  rd.file      = f;
+  rd.in_memory = 0;
+  rd.eof       = 0;
+  rd.raw_end   = 0;
+  return 1;
+}
+
+/** Starts reading from the given block of memory, which must stay valid
+    (and unchanged) until the reader is closed.  Returns 1 on success, 0 on
+    failure.
+*/
+int reader_open_memory(const char* buf, size_t len)
+{
+  reader_close();
+  if (!buf) {
+    gedcom_error(_("Internal error: no input buffer given"));
+    return 0;
+  }
+  reset_reader();
+  /* The raw input is never modified, so the cast is safe */
+  rd.raw       = (char*)buf;
+  rd.file      = NULL;
+  rd.in_memory = 1;
+  rd.eof       = 1;
+  rd.raw_end   = len;
+  return 1;
+}
+
+/** Makes the reader stop after the given number of bytes from the current
+    position, as if the file ended there.  This must be called right after
+    reader_open.
+*/
+void reader_set_limit(size_t len)
+{
+  if (rd.in_memory) {
+    if (rd.raw_start + len < rd.raw_end)
+      rd.raw_end = rd.raw_start + len;
+  }
+  else {
+    rd.limited = 1;
+    rd.left    = len;
+  }
+}
+
+void reader_close()
+{
+  /* The conversion descriptor is only open in this case */
+  if (rd.next_mode == READ_CONVERT) {
+    iconv_close(rd.cd);
+    rd.next_mode = READ_LINES;
+  }
+  if (!rd.in_memory)
+    free(rd.raw);
+  rd.raw       = NULL;
+  rd.in_memory = 0;
+  free(rd.conv);
+  rd.conv = NULL;
+  free(rd.invalid);
+  rd.invalid      = NULL;
+  rd.invalid_size = 0;
+  rd.file         = NULL;
+}
@@ -0,0 +1,93 @@
+/* Header for reader.c
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#ifndef __READER_H
+#define __READER_H
+
+#include <stdio.h>
+#include <iconv.h>
+
+/* Size of the blocks that are read from the input file */
+#define READER_BLOCK_SIZE 65536
+
+/* Byte that replaces an invalid input character in the converted input
+   (it can never appear in valid UTF-8) */
+#define READER_INVALID_CHAR '\xFF'
+
+typedef enum _READ_MODE {
+  READ_LINES,        /* unconverted, line per line */
+  READ_ASCII,        /* unconverted, but checked for ASCII */
+  READ_UTF8,         /* unconverted, but checked for UTF-8 */
+  READ_CONVERT       /* converted to UTF-8 in blocks */
+} Read_mode;
+
+/* The state of the reader; a zero-initialized struct is a closed reader */
+struct reader {
+  FILE*      file;
+  int        in_memory;      /* raw is the input itself, see
+				reader_open_memory */
+  int        eof;
+  int        limited;        /* only 'left' more bytes are read */
+  size_t     left;
+  Read_mode  mode;
+  Read_mode  next_mode;
+  int        switch_pending;
+
+  /* Raw input: [raw_start, raw_end) is not handed over yet; in the modes
+     READ_ASCII and READ_UTF8, [raw_start, raw_valid) is already checked,
+     and raw_invalid says whether raw[raw_valid] is an invalid character */
+  char*      raw;
+  size_t     raw_start;
+  size_t     raw_valid;
+  size_t     raw_end;
+  int        raw_invalid;
+
+  /* Converted input (READ_CONVERT): [conv_start, conv_end) is not handed
+     over yet */
+  char*      conv;
+  size_t     conv_start;
+  size_t     conv_end;
+  iconv_t    cd;
+  size_t     unit;
+
+  /* Line bookkeeping for READ_LINES */
+  int        raw_lines;
+  size_t     line_left;
+  int        line_open;
+
+  /* Queue of the original invalid characters */
+  char*      invalid;
+  size_t     invalid_size;
+  size_t     invalid_head;
+  size_t     invalid_tail;
+};
+
+int  reader_open(FILE* f);
+int  reader_open_memory(const char* buf, size_t len);
+void reader_set_limit(size_t len);
+void reader_close();
+int  reader_read(char* buf, int max_size);
+int  reader_start_conversion();
+int  reader_line_converted(int line);
+char reader_invalid_char();
+
+#endif /* __READER_H */
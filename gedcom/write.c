@@ -26,8 +26,8 @@
 #include "encoding.h"
 #include "encoding_state.h"
 #include "tag_data.h"
-#include "buffer.h"
 #include "utf8tools.h"
+#include "parser.h"
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -35,8 +35,36 @@
 
 #define MAXWRITELEN MAXGEDCLINELEN
 
+/* Values of the identity field of a write handle */
+#define IDENTITY_NONE   0
+#define IDENTITY_ASCII  1
+#define IDENTITY_UTF8   2
+
+/* Default size of the output buffer of a write handle */
+#define WRITE_BUFFER_SIZE 65536
+
+typedef enum _WRITE_SINK {
+  SINK_FD,           /* a file descriptor */
+  SINK_FILE,         /* a stdio stream */
+  SINK_MEMORY        /* the output buffer itself, handed over at close */
+} Write_sink;
+
 struct Gedcom_write_struct {
+  Write_sink sink;
   int       filedesc;
+  int       own_filedesc;
+  FILE*     file;
+  char**    mem_buffer;
+  size_t*   mem_size;
+  char*     out;
+  size_t    out_size;
+  size_t    out_len;
+  int       write_error;
+  char*     line;            /* the line being formatted */
+  size_t    line_size;
+  char*     at_buf;          /* a value with '@' doubled */
+  size_t    at_size;
+  int       identity;        /* output encoding is ASCII or UTF-8 */
   convert_t conv;
   int       total_conv_fails;
   const char* term;
@@ -44,53 +72,219 @@ struct Gedcom_write_struct {
   int       ctxt_level;
 };
 
-void cleanup_write_buffer();
-struct safe_buffer write_buffer = { NULL, 0, NULL, 0, cleanup_write_buffer };
+/* Writes directly to the sink (not for SINK_MEMORY); the first error is
+   reported, and makes all further writes fail */
+static int sink_write(Gedcom_write_hndl hndl, const char* data, size_t len)
+{
+  if (hndl->write_error)
+    return 1;
+  if (hndl->sink == SINK_FD) {
+    while (len > 0) {
+      ssize_t res = write(hndl->filedesc, data, len);
+      if (res < 0 && errno == EINTR)
+	continue;
+      if (res <= 0)
+	break;
+      data += res;
+      len  -= res;
+    }
+  }
+  else if (hndl->sink == SINK_FILE) {
+    if (fwrite(data, 1, len, hndl->file) == len)
+      len = 0;
+  }
+  if (len > 0) {
+    hndl->write_error = 1;
+    gedcom_error(_("Error writing output: %s"), strerror(errno));
+  }
+  return hndl->write_error;
+}
 
-void cleanup_convert_at_buffer();
-struct safe_buffer convert_at_buffer = { NULL, 0, NULL, 0,
-					 cleanup_convert_at_buffer };
+static int flush_out(Gedcom_write_hndl hndl)
+{
+  int result = 0;
+  if (hndl->sink != SINK_MEMORY && hndl->out_len > 0) {
+    result = sink_write(hndl, hndl->out, hndl->out_len);
+    hndl->out_len = 0;
+  }
+  return result || hndl->write_error;
+}
 
-void cleanup_write_buffer()
+/* Grows the output buffer to at least the given size */
+static int grow_out(Gedcom_write_hndl hndl, size_t size)
 {
-  cleanup_buffer(&write_buffer);
+  if (size > hndl->out_size) {
+    size_t new_size = (hndl->out_size ? hndl->out_size : WRITE_BUFFER_SIZE);
+    char* new_out;
+    while (new_size < size)
+      new_size *= 2;
+    new_out = (char*)realloc(hndl->out, new_size);
+    if (!new_out) {
+      MEMORY_ERROR;
+      hndl->write_error = 1;
+      return 0;
+    }
+    hndl->out      = new_out;
+    hndl->out_size = new_size;
+  }
+  return 1;
 }
 
-void cleanup_convert_at_buffer()
+/* Adds data to the output buffer, flushing it to the sink when full.  Data
+   that doesn't fit in an empty buffer is written directly */
+static int write_out(Gedcom_write_hndl hndl, const char* data, size_t len)
 {
-  cleanup_buffer(&convert_at_buffer);
+  if (hndl->write_error)
+    return 1;
+  if (hndl->sink == SINK_MEMORY) {
+    /* Keep room for the terminating null character */
+    if (!grow_out(hndl, hndl->out_len + len + 1))
+      return 1;
+  }
+  else if (hndl->out_len + len > hndl->out_size) {
+    if (flush_out(hndl))
+      return 1;
+    if (len >= hndl->out_size)
+      return sink_write(hndl, data, len);
+  }
+  memcpy(hndl->out + hndl->out_len, data, len);
+  hndl->out_len += len;
+  return 0;
 }
 
-int write_simple(Gedcom_write_hndl hndl,
-		 int level, const char* xref, const char* tag,
-		 const char* value)
+/* Makes sure that the buffer can hold size bytes */
+static int reserve(char** buf, size_t* buf_size, size_t size)
+{
+  if (size > *buf_size) {
+    size_t new_size = (*buf_size ? *buf_size : MAXWRITELEN * 2);
+    char* new_buf;
+    while (new_size < size)
+      new_size *= 2;
+    new_buf = (char*)realloc(*buf, new_size);
+    if (!new_buf) {
+      MEMORY_ERROR;
+      return 0;
+    }
+    *buf      = new_buf;
+    *buf_size = new_size;
+  }
+  return 1;
+}
+
+/* Counts the characters in the same way as utf8_strlen */
+#define IS_COUNTED_CHAR(c)  (((c) & 0xC0) != 0xC0)
+
+/* Copies str to p, returns the position after it, and adds the number of
+   characters to *chars */
+static char* put_string(char* p, const char* str, int* chars)
+{
+  for (; *str; str++) {
+    *p++ = *str;
+    *chars += IS_COUNTED_CHAR(*str);
+  }
+  return p;
+}
+
+/* Same as put_string, but doubles each '@' */
+static char* put_string_at(char* p, const char* str, int* chars)
+{
+  for (; *str; str++) {
+    if (*str == '@') {
+      *p++ = '@';
+      (*chars)++;
+    }
+    *p++ = *str;
+    *chars += IS_COUNTED_CHAR(*str);
+  }
+  return p;
+}
+
+static char* put_number(char* p, int num, int* chars)
+{
+  char digits[12];
+  int i = 0;
+  unsigned int n = (num < 0 ? -(unsigned int)num : (unsigned int)num);
+
+  if (num < 0) {
+    *p++ = '-';
+    (*chars)++;
+  }
+  do {
+    digits[i++] = '0' + n % 10;
+    n /= 10;
+  } while (n > 0);
+  *chars += i;
+  while (i > 0)
+    *p++ = digits[--i];
+  return p;
+}
+
+/* Returns 1 if the line doesn't need conversion; if not, it goes through
+   iconv, which also reports the invalid characters */
+static int is_identity(Gedcom_write_hndl hndl, const char* line, size_t len)
+{
+  if (hndl->identity == IDENTITY_ASCII)
+    return (ascii_length(line, len) == len);
+  else
+    return (utf8_valid_length(line, len, NULL) == len);
+}
+
+/* Formats the line "level [xref] tag [value]" with the line terminator in
+   one pass (doubling the '@' characters in the value if escape_at is set),
+   and writes it in the output encoding */
+static int write_line(Gedcom_write_hndl hndl,
+		      int level, const char* xref, const char* tag,
+		      const char* value, int escape_at)
 {
-  int res;
-  
   if (hndl) {
     char* converted;
-    int conv_fails;
-    size_t outlen;
-    
-    reset_buffer(&write_buffer);
-    res = safe_buf_append(&write_buffer, "%d", level);
+    char* p;
+    int conv_fails, chars = 0;
+    size_t outlen, max_len;
+
+    max_len = 16 + strlen(tag) + strlen(hndl->term);
     if (xref)
-      res += safe_buf_append(&write_buffer, " %s", xref);
-    res += safe_buf_append(&write_buffer, " %s", tag);
+      max_len += strlen(xref);
     if (value)
-      res += safe_buf_append(&write_buffer, " %s", value);
-    res += safe_buf_append(&write_buffer, hndl->term);
+      max_len += (escape_at ? 2 : 1) * strlen(value);
+    if (!reserve(&hndl->line, &hndl->line_size, max_len))
+      return 1;
+
+    p = put_number(hndl->line, level, &chars);
+    if (xref) {
+      *p++ = ' ';
+      p = put_string(p, xref, &chars);
+      chars++;
+    }
+    *p++ = ' ';
+    chars++;
+    p = put_string(p, tag, &chars);
+    if (value) {
+      *p++ = ' ';
+      chars++;
+      p = (escape_at ? put_string_at(p, value, &chars)
+	             : put_string(p, value, &chars));
+    }
+    p = put_string(p, hndl->term, &chars);
+    *p = '\0';
 
-    if (utf8_strlen(get_buf_string(&write_buffer)) > MAXGEDCLINELEN) {
+    if (chars > MAXGEDCLINELEN) {
       gedcom_error(_("Line too long"));
     }
+    else if (hndl->identity && is_identity(hndl, hndl->line, p - hndl->line)) {
+      /* The line is already in the output encoding */
+      line_no++;
+      if (write_out(hndl, hndl->line, p - hndl->line))
+	return 1;
+    }
     else {
-      converted = convert_from_utf8(hndl->conv, get_buf_string(&write_buffer),
+      converted = convert_from_utf8(hndl->conv, hndl->line,
 				    &conv_fails, &outlen);
       
       if (converted && (conv_fails == 0)) {
 	line_no++;
-	write(hndl->filedesc, converted, outlen);
+	if (write_out(hndl, converted, outlen))
+	  return 1;
       }
       else {
 	hndl->total_conv_fails += conv_fails;
@@ -103,6 +297,13 @@ int write_simple(Gedcom_write_hndl hndl,
   return 0;
 }
 
+int write_simple(Gedcom_write_hndl hndl,
+		 int level, const char* xref, const char* tag,
+		 const char* value)
+{
+  return write_line(hndl, level, xref, tag, value, 0);
+}
+
 int write_encoding_value(Gedcom_write_hndl hndl,
 			 int level, const char* xref, const char* tag,
 			 const char* value)
@@ -189,25 +390,21 @@ int write_long(Gedcom_write_hndl hndl, int elt_or_rec,
   return 0;
 }
 
-/** The basic function for opening a GEDCOM file for writing.
-
-    \param filename  The name of the file to write
-
-    \return A write handle, which needs to be used in the writing functions,
-    or \c NULL in case of errors.
- */
-Gedcom_write_hndl gedcom_write_open(const char *filename)
+/* Creates a write handle for the given sink, with the current write
+   settings; the caller fills in the sink details and calls write_bom */
+static Gedcom_write_hndl new_write_hndl(Write_sink sink)
 {
   Gedcom_write_hndl hndl;
 
-  hndl = (Gedcom_write_hndl)malloc(sizeof(struct Gedcom_write_struct));
+  hndl = (Gedcom_write_hndl)calloc(1, sizeof(struct Gedcom_write_struct));
 
   if (!hndl)
     MEMORY_ERROR;
   else {
     init_write_encoding();
     init_write_terminator();
-    hndl->total_conv_fails = 0;
+    hndl->sink     = sink;
+    hndl->filedesc = -1;
     hndl->conv = initialize_utf8_conversion(write_encoding.encoding, 0);
     if (!hndl->conv) {
       gedcom_error(_("Could not open encoding '%s' for writing: %s"),
@@ -215,44 +412,210 @@ Gedcom_write_hndl gedcom_write_open(const char *filename)
       free(hndl);
       hndl = NULL;
     }
+    else if (!grow_out(hndl, WRITE_BUFFER_SIZE)) {
+      cleanup_utf8_conversion(hndl->conv);
+      free(hndl);
+      hndl = NULL;
+    }
     else {
-      hndl->filedesc = open(filename, O_WRONLY|O_CREAT|O_TRUNC, 0666);
-      if (!hndl->filedesc) {
-	gedcom_error(_("Could not open file '%s' for writing: %s"),
-		     filename, strerror(errno));
-	cleanup_utf8_conversion(hndl->conv);
-	free(hndl);
-	hndl = NULL;
+      hndl->term = write_encoding.terminator;
+      hndl->ctxt_level = -1;
+      if (write_encoding.width == ONE_BYTE) {
+	if (!strcmp(write_encoding.encoding, "ASCII"))
+	  hndl->identity = IDENTITY_ASCII;
+	else if (!strcmp(write_encoding.encoding, INTERNAL_ENCODING))
+	  hndl->identity = IDENTITY_UTF8;
       }
+    }
+  }
+
+  return hndl;
+}
+
+static void free_write_hndl(Gedcom_write_hndl hndl)
+{
+  cleanup_utf8_conversion(hndl->conv);
+  free(hndl->out);
+  free(hndl->line);
+  free(hndl->at_buf);
+  free(hndl);
+}
+
+static void write_bom(Gedcom_write_hndl hndl)
+{
+  if (write_encoding.bom == WITH_BOM) {
+    if (write_encoding.width == TWO_BYTE_HILO)
+      write_out(hndl, "\xFE\xFF", 2);
+    else if (write_encoding.width == TWO_BYTE_LOHI)
+      write_out(hndl, "\xFF\xFE", 2);
+    else if (!strcmp(write_encoding.encoding, "UTF-8"))
+      write_out(hndl, "\xEF\xBB\xBF", 3);
+    else
+      gedcom_warning(_("Byte order mark configured, but not relevant"));
+  }
+}
+
+/** The basic function for opening a GEDCOM file for writing.
+
+    \param filename  The name of the file to write
+
+    \return A write handle, which needs to be used in the writing functions,
+    or \c NULL in case of errors.
+ */
+Gedcom_write_hndl gedcom_write_open(const char *filename)
+{
+  Gedcom_write_hndl hndl = new_write_hndl(SINK_FD);
+
+  if (hndl) {
+    hndl->filedesc = open(filename, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (hndl->filedesc < 0) {
+      gedcom_error(_("Could not open file '%s' for writing: %s"),
+		   filename, strerror(errno));
+      free_write_hndl(hndl);
+      hndl = NULL;
+    }
+    else {
+      hndl->own_filedesc = 1;
+      write_bom(hndl);
+    }
+  }
+
+  return hndl;
+}
+
+/** Opens a write handle on a file descriptor that is already open for
+    writing.  The file descriptor is not closed by gedcom_write_close().
+
+    \param fd  The file descriptor to write to
+
+    \return A write handle, or \c NULL in case of errors.
+ */
+Gedcom_write_hndl gedcom_write_open_fd(int fd)
+{
+  Gedcom_write_hndl hndl = new_write_hndl(SINK_FD);
+
+  if (hndl) {
+    hndl->filedesc = fd;
+    write_bom(hndl);
+  }
+
+  return hndl;
+}
+
+/** Opens a write handle on a stdio stream that is already open for
+    writing.  The stream is flushed, but not closed, by
+    gedcom_write_close().
+
+    \param file  The stream to write to
+
+    \return A write handle, or \c NULL in case of errors.
+ */
+Gedcom_write_hndl gedcom_write_open_file(FILE* file)
+{
+  Gedcom_write_hndl hndl = new_write_hndl(SINK_FILE);
+
+  if (hndl) {
+    hndl->file = file;
+    write_bom(hndl);
+  }
+
+  return hndl;
+}
+
+/** Opens a write handle that writes to memory.  When the handle is closed
+    with gedcom_write_close(), the output is handed over in \c *buffer
+    (null-terminated, to be freed by the caller) and its size (without the
+    null character) in \c *size.
+
+    \param buffer  Where to put the output at close
+    \param size    Where to put the size of the output at close
+
+    \return A write handle, or \c NULL in case of errors.
+ */
+Gedcom_write_hndl gedcom_write_open_mem(char** buffer, size_t* size)
+{
+  Gedcom_write_hndl hndl = new_write_hndl(SINK_MEMORY);
+
+  if (hndl) {
+    hndl->mem_buffer = buffer;
+    hndl->mem_size   = size;
+    write_bom(hndl);
+  }
+
+  return hndl;
+}
+
+/** Sets the size of the output buffer of a write handle.  The output is
+    written when the buffer is full, when gedcom_write_flush() is called,
+    and at close.  The default size is 64 kB; a size of 0 writes every line
+    as it is generated.  This has no effect on handles that write to memory.
+
+    \param hndl  The write handle
+    \param size  The new size of the buffer
+
+    \retval 0 on success
+    \retval >0 on failure (including earlier write errors)
+ */
+int gedcom_write_set_buffer_size(Gedcom_write_hndl hndl, size_t size)
+{
+  int result = 1;
+  if (hndl && !flush_out(hndl)) {
+    if (hndl->sink == SINK_MEMORY)
+      result = 0;
+    else if (size == 0) {
+      free(hndl->out);
+      hndl->out      = NULL;
+      hndl->out_size = 0;
+      result = 0;
+    }
+    else {
+      char* new_out = (char*)realloc(hndl->out, size);
+      if (!new_out)
+	MEMORY_ERROR;
       else {
-	hndl->term = write_encoding.terminator;
-	hndl->ctxt_level = -1;
-	if (write_encoding.bom == WITH_BOM) {
-	  if (write_encoding.width == TWO_BYTE_HILO)
-	    write(hndl->filedesc, "\xFE\xFF", 2);
-	  else if (write_encoding.width == TWO_BYTE_LOHI)
-	    write(hndl->filedesc, "\xFF\xFE", 2);
-	  else if (!strcmp(write_encoding.encoding, "UTF-8"))
-	    write(hndl->filedesc, "\xEF\xBB\xBF", 3);
-	  else
-	    gedcom_warning(_("Byte order mark configured, but not relevant"));
-	}
+	hndl->out      = new_out;
+	hndl->out_size = size;
+	result = 0;
       }
     }
   }
+  return result;
+}
 
-  return hndl;
+/** Writes out everything that is in the output buffer of the write handle
+    (for a stdio stream, the stream is also flushed).
+
+    \param hndl  The write handle
+
+    \retval 0 on success
+    \retval >0 on failure (including earlier write errors)
+ */
+int gedcom_write_flush(Gedcom_write_hndl hndl)
+{
+  int result = 1;
+  if (hndl) {
+    result = flush_out(hndl);
+    if (!result && hndl->sink == SINK_FILE && fflush(hndl->file) != 0) {
+      hndl->write_error = 1;
+      gedcom_error(_("Error writing output: %s"), strerror(errno));
+      result = 1;
+    }
+  }
+  return result;
 }
 
-/** The basic function for closing a GEDCOM file for writing.
+/** The basic function for closing a GEDCOM file for writing.  This writes
+    the trailer and the rest of the output buffer.
 
-    \param hndl  The write handle as returned by gedcom_write_open().
+    \param hndl  The write handle as returned by gedcom_write_open() (or one
+    of the other open functions).
     \param total_conv_fails  If you pass an actual integer pointer for this,
     the function will write in it the total number of conversion failures;
     you can pass \c NULL if you're not interested
 
     \retval 0 in case of success
-    \retval >0 in case of failure.
+    \retval >0 in case of failure, including errors while writing the
+    output at any time since the handle was opened.
  */
 int gedcom_write_close(Gedcom_write_hndl hndl, int* total_conv_fails)
 {
@@ -260,9 +623,24 @@ int gedcom_write_close(Gedcom_write_hndl hndl, int* total_conv_fails)
   if (hndl) {
     write_simple(hndl, 0, NULL, "TRLR", NULL);
     if (total_conv_fails)  *total_conv_fails = hndl->total_conv_fails;
-    result = close(hndl->filedesc);
-    cleanup_utf8_conversion(hndl->conv);
-    free(hndl);
+    result = gedcom_write_flush(hndl);
+    if (hndl->own_filedesc && close(hndl->filedesc) != 0) {
+      gedcom_error(_("Error writing output: %s"), strerror(errno));
+      result = 1;
+    }
+    if (hndl->sink == SINK_MEMORY) {
+      if (result == 0) {
+	hndl->out[hndl->out_len] = '\0';
+	*hndl->mem_buffer = hndl->out;
+	*hndl->mem_size   = hndl->out_len;
+	hndl->out = NULL;
+      }
+      else {
+	*hndl->mem_buffer = NULL;
+	*hndl->mem_size   = 0;
+      }
+    }
+    free_write_hndl(hndl);
   }
   return result;
 }
@@ -321,30 +699,25 @@ int get_level(Gedcom_write_hndl hndl, int elt_or_rec, int parent)
   return hndl->ctxt_level;
 }
 
-char* convert_at(const char* input)
+/* Returns the value with each '@' doubled (the value itself if it doesn't
+   contain any) */
+static const char* convert_at(Gedcom_write_hndl hndl, const char* input)
 {
-  if (input) {
-    const char* ptr = input;
-    reset_buffer(&convert_at_buffer);
-    while (*ptr) {
-      if (*ptr == '@') {
-	SAFE_BUF_ADDCHAR(&convert_at_buffer, '@');
-	SAFE_BUF_ADDCHAR(&convert_at_buffer, '@');
-      }
-      else {
-	SAFE_BUF_ADDCHAR(&convert_at_buffer, *ptr);
-      }
-      ptr++;
-    }
-    return get_buf_string(&convert_at_buffer);
+  if (input && strchr(input, '@')) {
+    int chars = 0;
+    if (!reserve(&hndl->at_buf, &hndl->at_size, 2 * strlen(input) + 1))
+      return input;
+    *put_string_at(hndl->at_buf, input, &chars) = '\0';
+    return hndl->at_buf;
   }
   else
-    return NULL;
+    return input;
 }
 
+/* If escape_at is set, the '@' characters in val are doubled */
 int _gedcom_write_val(Gedcom_write_hndl hndl,
 		      int rec_or_elt, int tag, int parent_rec_or_elt,
-		      const char* xrefstr, const char* val)
+		      const char* xrefstr, const char* val, int escape_at)
 {
   int result = 1;
   int level = 0;
@@ -356,9 +729,11 @@ int _gedcom_write_val(Gedcom_write_hndl hndl,
     if (rec_or_elt == ELT_HEAD_CHAR)
       result = write_encoding_value(hndl, level, xrefstr, tag_str, val);
     else if (supports_continuation(rec_or_elt, OPT_CONT|OPT_CONC))
-      result = write_long(hndl, rec_or_elt, level, xrefstr, tag_str, val);
+      /* The value is split on the escaped form */
+      result = write_long(hndl, rec_or_elt, level, xrefstr, tag_str,
+			  (escape_at ? convert_at(hndl, val) : val));
     else
-      result = write_simple(hndl, level, xrefstr, tag_str, val);
+      result = write_line(hndl, level, xrefstr, tag_str, val, escape_at);
   }
 
   return result;
@@ -385,7 +760,7 @@ int gedcom_write_record_str(Gedcom_write_hndl hndl,
 {
   int result = 1;
   if (check_type(rec, (val ? GV_CHAR_PTR : GV_NULL)))
-    result = _gedcom_write_val(hndl, rec, 0, -1, xrefstr, convert_at(val));
+    result = _gedcom_write_val(hndl, rec, 0, -1, xrefstr, val, 1);
   return result;
 }
 
@@ -421,7 +796,7 @@ int gedcom_write_element_str(Gedcom_write_hndl hndl,
   int result = 1;
   if (check_type(elt, (val ? GV_CHAR_PTR : GV_NULL)))
     result = _gedcom_write_val(hndl, elt, tag, parent_rec_or_elt, NULL,
-			       convert_at(val));
+			       val, 1);
   return result;
 }
 
@@ -437,7 +812,7 @@ int gedcom_write_element_xref(Gedcom_write_hndl hndl,
   int result = 1;
   if (check_type(elt, (val ? GV_XREF_PTR : GV_NULL)))
     result = _gedcom_write_val(hndl, elt, tag, parent_rec_or_elt, NULL,
-			       val->string);
+			       val->string, 0);
   return result;
 }
 
@@ -453,7 +828,7 @@ int gedcom_write_element_date(Gedcom_write_hndl hndl,
   int result = 1;
   if (check_type(elt, (val ? GV_DATE_VALUE : GV_NULL)))
     result = _gedcom_write_val(hndl, elt, tag, parent_rec_or_elt, NULL,
-			       gedcom_date_to_string(val));
+			       gedcom_date_to_string(val), 0);
   return result;
 }
 
@@ -469,7 +844,7 @@ int gedcom_write_element_age(Gedcom_write_hndl hndl,
   int result = 1;
   if (check_type(elt, (val ? GV_AGE_VALUE : GV_NULL)))
     result = _gedcom_write_val(hndl, elt, tag, parent_rec_or_elt, NULL,
-			       gedcom_age_to_string(val));
+			       gedcom_age_to_string(val), 0);
   return result;
 }
 
@@ -495,7 +870,7 @@ int gedcom_write_user_str(Gedcom_write_hndl hndl, int level, const char* tag,
 {
   int result = 1;
   if (tag && tag[0] == '_')
-    result = write_simple(hndl, level, xrefstr, tag, convert_at(value));
+    result = write_line(hndl, level, xrefstr, tag, value, 1);
   return result;
 }
 
@@ -23,12 +23,15 @@
 
 #include "gedcom_internal.h"
 #include "gedcom.h"
-#include "gedcom.tabgen.h"
 #include "xref.h"
-#include "hash.h"
+#include "parser.h"
+#include "parallel.h"
 
 struct xref_value def_xref_val = { XREF_NONE, "<error>", NULL };
-static hash_t *xrefs = NULL;
+
+/* In a parallel parse, the parsers share the table of the main parser, so
+   all accesses to it are done between lock_xrefs and unlock_xrefs */
+#define xrefs (PARSER->xrefs)
 
 const char* xref_type_str[] = { N_("nothing"),
 				N_("a family"),
@@ -42,6 +45,19 @@ const char* xref_type_str[] = { N_("nothing"),
 				N_("an application-specific record"),
                               };
 
+/* The cross-references are kept in an open-addressing hash table with
+   linear probing.  The nodes themselves are allocated from large blocks,
+   together with their key, which is also used as the 'string' member of
+   the xref_value; they are only freed when the table is cleaned up, so that
+   the xref_value pointers given to the application stay valid until then.
+*/
+
+#define XREF_BLOCK_SIZE   (64 * 1024)
+/* Rough estimate of the number of bytes of input per cross-reference, to
+   presize the table */
+#define XREF_INPUT_BYTES  256
+#define XREF_MIN_SLOTS    64
+
 struct xref_node {
   struct xref_value xref;
   Xref_type defined_type;
@@ -49,87 +65,202 @@ struct xref_node {
   int defined_line;
   int used_line;
   int use_count;
+  struct xref_node* next;      /* in order of creation */
+  char key[1];
 };
 
-hnode_t *xref_alloc(void *c UNUSED)
-{
-  return malloc(sizeof *xref_alloc(NULL));
-}
+struct xref_slot {
+  unsigned int      hash;
+  struct xref_node* node;      /* NULL if the slot is empty */
+};
+
+union xref_align {
+  long   l;
+  double d;
+  void*  p;
+};
+
+#define XREF_ALIGN(N) \
+   (((N) + sizeof(union xref_align) - 1) / sizeof(union xref_align) \
+    * sizeof(union xref_align))
+
+struct xref_block {
+  struct xref_block* next;
+};
 
-void xref_free(hnode_t *n, void *c UNUSED)
+struct xref_table {
+  struct xref_slot*  slots;
+  size_t             mask;     /* number of slots - 1 */
+  size_t             count;
+  struct xref_node*  first;
+  struct xref_node** last_next;
+  struct xref_block* blocks;
+  char*              block_free;
+  char*              block_end;
+};
+
+/* Hash function for the keys (the 32-bit variant of MurmurHash3) */
+static unsigned int hash_xref_key(const char* key, size_t len)
 {
-  struct xref_node *xr = (struct xref_node *)hnode_get(n);
-  free((void*)hnode_getkey(n));
-  free(xr->xref.string);
-  free(xr);
-  free(n);
+  unsigned int h = 0x9747b28cU ^ (unsigned int)len;
+  unsigned int k;
+
+  for (; len >= 4; key += 4, len -= 4) {
+    memcpy(&k, key, 4);
+    k *= 0xcc9e2d51U;
+    k = (k << 15) | (k >> 17);
+    k *= 0x1b873593U;
+    h ^= k;
+    h = (h << 13) | (h >> 19);
+    h = h * 5 + 0xe6546b64U;
+  }
+  if (len) {
+    k = 0;
+    memcpy(&k, key, len);
+    k *= 0xcc9e2d51U;
+    k = (k << 15) | (k >> 17);
+    k *= 0x1b873593U;
+    h ^= k;
+  }
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35U;
+  h ^= h >> 16;
+  return h;
 }
 
-void clear_xref_node(struct xref_node *xr)
+/* Returns the slot that contains the given key, or the empty slot where it
+   should be inserted */
+static size_t find_slot(const char* key, size_t len, unsigned int hash)
 {
-  xr->xref.type    = XREF_NONE;
-  /* Make sure that the 'string' member always contains a valid string */
-  if (!xr->xref.string)
-    xr->xref.string  = strdup("");
-  if (!xr->xref.string) MEMORY_ERROR;
-  xr->xref.object  = NULL;
-  xr->defined_type = XREF_NONE;
-  xr->used_type    = XREF_NONE;
-  xr->defined_line = -1;
-  xr->used_line    = -1;
-  xr->use_count    = 0;
+  size_t i = hash & xrefs->mask;
+  struct xref_slot* slot;
+
+  while ((slot = &xrefs->slots[i])->node) {
+    if (slot->hash == hash && memcmp(slot->node->key, key, len + 1) == 0)
+      break;
+    i = (i + 1) & xrefs->mask;
+  }
+  return i;
 }
 
-struct xref_node *make_xref_node()
+static struct xref_node* lookup_xref(const char* key)
 {
-  struct xref_node *xr = (struct xref_node *)malloc(sizeof(struct xref_node));
-  if (xr) {
-    xr->xref.string = NULL;
-    clear_xref_node(xr);
+  if (xrefs) {
+    size_t len = strlen(key);
+    return xrefs->slots[find_slot(key, len, hash_xref_key(key, len))].node;
   }
   else
+    return NULL;
+}
+
+static int grow_xref_table()
+{
+  size_t new_size = (xrefs->mask + 1) * 2;
+  size_t new_mask = new_size - 1;
+  struct xref_slot* new_slots
+    = (struct xref_slot*)calloc(new_size, sizeof(struct xref_slot));
+  size_t i, j;
+
+  if (!new_slots) {
     MEMORY_ERROR;
-  return xr;
+    return 0;
+  }
+  for (i = 0; i <= xrefs->mask; i++) {
+    if (xrefs->slots[i].node) {
+      j = xrefs->slots[i].hash & new_mask;
+      while (new_slots[j].node)
+	j = (j + 1) & new_mask;
+      new_slots[j] = xrefs->slots[i];
+    }
+  }
+  free(xrefs->slots);
+  xrefs->slots = new_slots;
+  xrefs->mask  = new_mask;
+  return 1;
 }
 
-void delete_xref_node(struct xref_node* xr)
+static struct xref_node* alloc_xref_node(size_t len)
 {
-  if (!xr->xref.string)
-    free(xr->xref.string);
-  free(xr);
+  size_t size = XREF_ALIGN(sizeof(struct xref_node) + len);
+  size_t header = XREF_ALIGN(sizeof(struct xref_block));
+  char* ptr;
+
+  if (size > (size_t)(xrefs->block_end - xrefs->block_free)) {
+    size_t block_size = (size > XREF_BLOCK_SIZE / 4 ?
+			 header + size : XREF_BLOCK_SIZE);
+    struct xref_block* block = (struct xref_block*)malloc(block_size);
+    if (!block) {
+      MEMORY_ERROR;
+      return NULL;
+    }
+    block->next   = xrefs->blocks;
+    xrefs->blocks = block;
+    if (block_size == XREF_BLOCK_SIZE) {
+      xrefs->block_free = (char*)block + header;
+      xrefs->block_end  = (char*)block + block_size;
+    }
+    else
+      return (struct xref_node*)((char*)block + header);
+  }
+  ptr = xrefs->block_free;
+  xrefs->block_free += size;
+  return (struct xref_node*)ptr;
 }
 
 void cleanup_xrefs()
 {
-  hash_free(xrefs);
-  xrefs = NULL;
+  if (xrefs) {
+    struct xref_block* block = xrefs->blocks;
+    while (block) {
+      struct xref_block* next = block->next;
+      free(block);
+      block = next;
+    }
+    free(xrefs->slots);
+    free(xrefs);
+    xrefs = NULL;
+  }
 }
 
-void make_xref_table()
+/* Creates a new, empty table, presized for an input of the given number of
+   bytes (0 if unknown) */
+void make_xref_table(size_t input_size)
 {
+  size_t nr_of_slots = XREF_MIN_SLOTS;
+  size_t expected = input_size / XREF_INPUT_BYTES;
+
+  cleanup_xrefs();
+  while (nr_of_slots < expected * 2)
+    nr_of_slots *= 2;
+  xrefs = (struct xref_table*)calloc(1, sizeof(struct xref_table));
   if (xrefs)
-    cleanup_xrefs();
-  else
-    /* Only register initially (if xrefs is still NULL) */
-    /* So that it is only registered once */
-    if (atexit(cleanup_xrefs) != 0) {
-      gedcom_warning(_("Could not register xref cleanup function"));
-    }
-  xrefs = hash_create(HASHCOUNT_T_MAX, NULL, NULL);
-  hash_set_allocator(xrefs, xref_alloc, xref_free, NULL);
+    xrefs->slots
+      = (struct xref_slot*)calloc(nr_of_slots, sizeof(struct xref_slot));
+  if (!xrefs || !xrefs->slots) {
+    MEMORY_ERROR;
+    free(xrefs);
+    xrefs = NULL;
+  }
+  else {
+    xrefs->mask      = nr_of_slots - 1;
+    xrefs->last_next = &xrefs->first;
+  }
 }
 
 int check_xref_table()
 {
   int result = 0;
-  hscan_t hs;
-  hnode_t *node;
   struct xref_node *xr;
 
-  /* Check for undefined and unused xrefs */
-  hash_scan_begin(&hs, xrefs);
-  while ((node = hash_scan_next(&hs))) {
-    xr = (struct xref_node *)hnode_get(node);
+  /* Not all cross-references are in the table */
+  if (PARSER->skip_options & SKIP_XREFS)
+    return 0;
+
+  /* Check for undefined and unused xrefs, in the order in which they
+     appeared */
+  for (xr = (xrefs ? xrefs->first : NULL); xr; xr = xr->next) {
     if (xr->defined_type == XREF_NONE && xr->used_type != XREF_NONE) {
       gedcom_error(_("Cross-reference %s used on line %d is not defined"),
 		   xr->xref.string, xr->used_line);
@@ -148,33 +279,70 @@ struct xref_node* add_xref(Xref_type xref_type, const char* xrefstr,
 			   Gedcom_ctxt object)
 {
   struct xref_node *xr = NULL;
-  char *key = strdup(xrefstr);
-  if (key) {
-    xr = make_xref_node();
-    xr->xref.type = xref_type;
-    xr->xref.object = object;
-    if (xr->xref.string)
-      free(xr->xref.string);
-    xr->xref.string = strdup(xrefstr);
-    if (! xr->xref.string) {
-      MEMORY_ERROR;
-      free(key);
-      delete_xref_node(xr);
-      xr = NULL;
-    }
-    else {
-      hash_alloc_insert(xrefs, key, xr);
-    }
+  size_t len = strlen(xrefstr);
+  unsigned int hash = hash_xref_key(xrefstr, len);
+  size_t i;
+
+  if (!xrefs)
+    make_xref_table(0);
+  if (!xrefs)
+    return NULL;
+  if ((xrefs->count + 1) * 10 > (xrefs->mask + 1) * 7 && !grow_xref_table())
+    return NULL;
+
+  xr = alloc_xref_node(len);
+  if (xr) {
+    memcpy(xr->key, xrefstr, len + 1);
+    xr->xref.type    = xref_type;
+    xr->xref.string  = xr->key;
+    xr->xref.object  = object;
+    xr->defined_type = XREF_NONE;
+    xr->used_type    = XREF_NONE;
+    xr->defined_line = -1;
+    xr->used_line    = -1;
+    xr->use_count    = 0;
+    xr->next         = NULL;
+    *xrefs->last_next = xr;
+    xrefs->last_next  = &xr->next;
+
+    i = find_slot(xrefstr, len, hash);
+    xrefs->slots[i].hash = hash;
+    xrefs->slots[i].node = xr;
+    xrefs->count++;
   }
-  else
-    MEMORY_ERROR;
   return xr;
 }
 
+/* Removes the node from the table; its memory is only reclaimed when the
+   table is cleaned up */
 void remove_xref(struct xref_node* xr)
 {
-  hnode_t *node = hash_lookup(xrefs, xr->xref.string);
-  hash_delete_free(xrefs, node);
+  size_t len = strlen(xr->key);
+  size_t i = find_slot(xr->key, len, hash_xref_key(xr->key, len));
+  size_t j = i, k;
+
+  if (xrefs->slots[i].node != xr)
+    return;
+  /* Move the following entries of the cluster back, so that no entry
+     becomes unreachable */
+  for (;;) {
+    j = (j + 1) & xrefs->mask;
+    if (!xrefs->slots[j].node)
+      break;
+    k = xrefs->slots[j].hash & xrefs->mask;
+    if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+      xrefs->slots[i] = xrefs->slots[j];
+      i = j;
+    }
+  }
+  xrefs->slots[i].node = NULL;
+  xrefs->count--;
+
+  /* Not reported by check_xref_table any more */
+  xr->xref.type    = XREF_NONE;
+  xr->xref.object  = NULL;
+  xr->defined_type = XREF_NONE;
+  xr->used_type    = XREF_NONE;
 }
 
 int set_xref_fields(struct xref_node* xr, Xref_ctxt ctxt, Xref_type xref_type)
@@ -227,29 +395,58 @@ struct xref_value *gedcom_parse_xref(const char *raw_value,
 				     Xref_ctxt ctxt, Xref_type xref_type)
 {
   struct xref_node *xr = NULL;
-  
-  hnode_t *node = hash_lookup(xrefs, raw_value);
-  if (node) {
-    xr = (struct xref_node *)hnode_get(node);
-  }
-  else {
+
+  lock_xrefs();
+  xr = lookup_xref(raw_value);
+  if (!xr)
     xr = add_xref(xref_type, raw_value, NULL);
-  }
 
-  if (xr) {
+  if (xr)
     set_xref_fields(xr, ctxt, xref_type);
+  unlock_xrefs();
+
+  if (xr)
     return &(xr->xref);
-  }
   else
     return NULL;
 }
 
 /* Functions for retrieving, modifying and deleting cross-references */
 
+/* The characters allowed in a pointer, following the 'pointer' pattern in
+   gedcom_1byte.lex: after the '@', an alphanumeric character (alpha
+   includes '_'), followed by any characters except '@', the control
+   characters and 0xFF */
+static int is_pointer_start(unsigned char c)
+{
+  return ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+	  (c >= '0' && c <= '9') || c == '_');
+}
+
+static int is_pointer_char(unsigned char c)
+{
+  return ((c >= 0x20 && c <= 0x7E && c != '@') || (c >= 0x80 && c != 0xFF));
+}
+
+/* Checks whether the key is a pointer as the lexer would accept it; this
+   doesn't use the lexer, so it is also safe during a parse.  Like the
+   lexer, it complains about a single '@' that doesn't start a pointer or
+   an escape */
 int is_valid_pointer(const char *key)
 {
-  return (strlen(key) <= 22 &&
-	  gedcom_check_token(key, STATE_NORMAL, POINTER) == 0);
+  const unsigned char* p = (const unsigned char*)key;
+  int i;
+
+  if (strlen(key) > MAXGEDCPTRLEN || p[0] != '@')
+    return 0;
+  for (i = 1; is_pointer_char(p[i]); i++)
+    ;
+  if (p[i] != '@' || i == 1 || (p[1] != '#' && !is_pointer_start(p[1]))) {
+    if (p[1] != '@')
+      gedcom_error(_("'@' character should be written as '@@' in values"));
+    return 0;
+  }
+  return (p[1] != '#' && p[i+1] == '\0');
 }
 
 /** Retrieve an xref_value by its key.
@@ -267,11 +464,12 @@ struct xref_value* gedcom_get_by_xref(const char *key)
     return NULL;
   }
   else {
-    hnode_t *node = hash_lookup(xrefs, key);
-    if (node) {
-      struct xref_node *xr = (struct xref_node *)hnode_get(node);
+    struct xref_node *xr = NULL;
+    lock_xrefs();
+    xr = lookup_xref(key);
+    unlock_xrefs();
+    if (xr)
       return &(xr->xref);
-    }
     else
       return NULL;
   }
@@ -300,8 +498,8 @@ struct xref_value* gedcom_add_xref(Xref_type type, const char* xrefstr,
     gedcom_error(_("String '%s' is not a valid cross-reference key"), xrefstr);
   }
   else {
-    hnode_t *node = hash_lookup(xrefs, xrefstr);
-    if (node) {
+    lock_xrefs();
+    if (lookup_xref(xrefstr)) {
       gedcom_error(_("Cross-reference %s already exists"), xrefstr);
     }
     else {
@@ -309,6 +507,7 @@ struct xref_value* gedcom_add_xref(Xref_type type, const char* xrefstr,
       if (xr)
 	set_xref_fields(xr, XREF_DEFINED, type);
     }
+    unlock_xrefs();
   }
   if (xr)
     return &(xr->xref);
@@ -340,15 +539,16 @@ struct xref_value* gedcom_link_xref(Xref_type type, const char* xrefstr)
     gedcom_error(_("String '%s' is not a valid cross-reference key"), xrefstr);
   }
   else {
-    hnode_t *node = hash_lookup(xrefs, xrefstr);
-    if (!node) {
+    lock_xrefs();
+    xr = lookup_xref(xrefstr);
+    if (!xr) {
       gedcom_error(_("Cross-reference %s not defined"), xrefstr);
     }
     else {
-      xr = (struct xref_node *)hnode_get(node);
       if (set_xref_fields(xr, XREF_USED, type) != 0)
 	xr = NULL;
     }
+    unlock_xrefs();
   }
 
   if (xr)
@@ -380,12 +580,12 @@ struct xref_value* gedcom_unlink_xref(Xref_type type, const char* xrefstr)
     gedcom_error(_("String '%s' is not a valid cross-reference key"), xrefstr);
   }
   else {
-    hnode_t *node = hash_lookup(xrefs, xrefstr);
-    if (! node) {
+    lock_xrefs();
+    xr = lookup_xref(xrefstr);
+    if (!xr) {
       gedcom_error(_("Cross-reference %s not defined"), xrefstr);
     }
     else {
-      xr = (struct xref_node*) hnode_get(node);
       if (xr->defined_type != type && xr->defined_type != XREF_ANY) {
 	gedcom_error
 	  (_("Cross-reference %s previously defined as pointer to %s"),
@@ -395,6 +595,7 @@ struct xref_value* gedcom_unlink_xref(Xref_type type, const char* xrefstr)
       else
 	xr->use_count--;
     }
+    unlock_xrefs();
   }
   if (xr)
     return &(xr->xref);
@@ -422,12 +623,12 @@ int gedcom_delete_xref(const char* xrefstr)
     gedcom_error(_("String '%s' is not a valid cross-reference key"), xrefstr);
   }
   else {
-    hnode_t *node = hash_lookup(xrefs, xrefstr);
-    if (! node) {
+    lock_xrefs();
+    xr = lookup_xref(xrefstr);
+    if (!xr) {
       gedcom_error(_("Cross-reference %s not defined"), xrefstr);
     }
     else {
-      xr = (struct xref_node*) hnode_get(node);
       if (xr->use_count != 0)  {
 	gedcom_error(_("Cross-reference %s still in use"), xrefstr);
       }
@@ -436,6 +637,22 @@ int gedcom_delete_xref(const char* xrefstr)
 	result = 0;
       }
     }
+    unlock_xrefs();
   }
   return result;
 }
+
+/** Delete all xref_value objects.  This starts an empty cross-reference
+    table, as at the start of a parse; it is meant for applications that
+    build a complete model themselves (e.g. from a saved copy), instead of
+    via the parser.
+
+    Note that all xref_value pointers that were handed out before become
+    invalid.
+ */
+void gedcom_clear_xrefs()
+{
+  lock_xrefs();
+  make_xref_table(0);
+  unlock_xrefs();
+}
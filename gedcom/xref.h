@@ -31,8 +31,9 @@ typedef enum _XREF_CTXT {
   XREF_USED
 } Xref_ctxt;
 
-void make_xref_table();
+void make_xref_table(size_t input_size);
 int check_xref_table();
+void cleanup_xrefs();
 
 struct xref_value *gedcom_parse_xref(const char *raw_value,
 				     Xref_ctxt ctxt, Xref_type type);
@@ -81,7 +81,7 @@ Gedcom_ctxt sub_assoc_type_start(_ELT_PARAMS_)
     struct association *obj = SAFE_CTXT_CAST(association, ctxt);
     char *str = GEDCOM_STRING(parsed_value);
     if (obj) {
-      obj->type = strdup(str);
+      obj->type = gom_strdup(str);
       if (! obj->type)
 	MEMORY_ERROR;
       else {
@@ -115,7 +115,7 @@ void CLEANFUNC(change_date)(struct change_date *chan)
 int update_date(struct date_value** dv, struct tm* tm_ptr)
 {
   int result;
-  struct date_value* dval = gedcom_new_date_value(NULL);
+  struct date_value* dval = gom_new_date_value(NULL);
   dval->type        = DV_NO_MODIFIER;
   dval->date1.cal   = CAL_GREGORIAN;
   dval->date1.day   = tm_ptr->tm_mday;
@@ -124,9 +124,11 @@ int update_date(struct date_value** dv, struct tm* tm_ptr)
   result = gedcom_normalize_date(DI_FROM_NUMBERS, dval);
 
   if (result == 0) {
-    if (*dv) free(*dv);
+    if (*dv) gom_free(*dv);
     *dv = dval;
   }
+  else
+    gom_free(dval);
   return result;
 }
 
@@ -47,19 +47,19 @@ Gedcom_ctxt sub_evt_start(_ELT_PARAMS_)
     struct event *evt = SUB_MAKEFUNC(event)();
     if (evt) {
       evt->event = parsed_tag;
-      evt->event_name = strdup(tag);
+      evt->event_name = gom_strdup(tag);
       if (! evt->event_name) {
 	MEMORY_ERROR;
-	free(evt);
+	gom_free(evt);
       }
       else {
 	int err = 0;
 	if (GEDCOM_IS_STRING(parsed_value)) {
-	  evt->val = strdup(GEDCOM_STRING(parsed_value));
+	  evt->val = gom_strdup(GEDCOM_STRING(parsed_value));
 	  if (! evt->val) {
 	    MEMORY_ERROR;
-	    free(evt->event_name);
-	    free(evt);
+	    gom_free(evt->event_name);
+	    gom_free(evt);
 	    err = 1;
 	  }
 	}
@@ -94,19 +94,19 @@ Gedcom_ctxt sub_attr_start(_ELT_PARAMS_)
     struct event *evt = SUB_MAKEFUNC(event)();
     if (evt) {
       evt->event = parsed_tag;
-      evt->event_name = strdup(tag);
+      evt->event_name = gom_strdup(tag);
       if (! evt->event_name) {
 	MEMORY_ERROR;
-	free(evt);
+	gom_free(evt);
       }
       else {
 	int err = 0;
 	if (GEDCOM_IS_STRING(parsed_value)) {
-	  evt->val = strdup(GEDCOM_STRING(parsed_value));
+	  evt->val = gom_strdup(GEDCOM_STRING(parsed_value));
 	  if (! evt->val) {
 	    MEMORY_ERROR;
-	    free(evt->event_name);
-	    free(evt);
+	    gom_free(evt->event_name);
+	    gom_free(evt);
 	    err = 1;
 	  }
 	}
@@ -165,14 +165,14 @@ Gedcom_ctxt sub_fam_evt_age_start(_ELT_PARAMS_)
       int type = ctxt_type(ctxt);
       switch (type) {
 	case ELT_SUB_FAM_EVT_HUSB:
-	  evt->husband_age = gedcom_new_age_value(&age);
+	  evt->husband_age = gom_new_age_value(&age);
 	  if (! evt->husband_age) {
 	    MEMORY_ERROR;
 	    err = 1;
 	  }
 	  break;
 	case ELT_SUB_FAM_EVT_WIFE:
-	  evt->wife_age = gedcom_new_age_value(&age);
+	  evt->wife_age = gom_new_age_value(&age);
 	  if (! evt->wife_age) {
 	    MEMORY_ERROR;
 	    err = 1;
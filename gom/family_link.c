@@ -71,7 +71,7 @@ Gedcom_ctxt sub_fam_link_pedi_start(_ELT_PARAMS_)
       struct pedigree *ped = NULL;
       MAKE_CHAIN_ELT(pedigree, link->pedigree, ped);
       if (ped) {
-	ped->pedigree = strdup(GEDCOM_STRING(parsed_value));
+	ped->pedigree = gom_strdup(GEDCOM_STRING(parsed_value));
 	if (! ped->pedigree) {
 	  MEMORY_ERROR;
 	  err = 1;
@@ -136,18 +136,19 @@
 
 #define MAKE_CHAIN_ELT(STRUCTTYPE, FIRSTVAL, VAL)                             \
   {                                                                           \
-    VAL = (struct STRUCTTYPE*) malloc(sizeof(struct STRUCTTYPE));             \
+    VAL = (struct STRUCTTYPE*) gom_alloc(sizeof(struct STRUCTTYPE));          \
     if (! VAL)                                                                \
       MEMORY_ERROR;                                                           \
     else {                                                                    \
-      memset (VAL, 0, sizeof(struct STRUCTTYPE));                             \
       LINK_CHAIN_ELT(STRUCTTYPE, FIRSTVAL, VAL)                               \
     }                                                                         \
   }
 
 #define DESTROY_CHAIN_ELTS(STRUCTTYPE, FIRSTVAL)                              \
   {                                                                           \
-    if (FIRSTVAL) {                                                           \
+    if (gom_arena_active)                                                     \
+      FIRSTVAL = NULL;                                                        \
+    else if (FIRSTVAL) {                                                      \
       struct STRUCTTYPE *runner, *next;                                       \
       runner = FIRSTVAL;                                                      \
       FIRSTVAL = NULL;                                                        \
@@ -167,8 +168,9 @@
     if (xrefstr) {                                                            \
       MAKE_CHAIN_ELT(STRUCTTYPE, FIRSTVAL, obj);                              \
       if (obj) {                                                              \
-	obj->xrefstr = strdup(xrefstr);                                       \
+	obj->xrefstr = gom_strdup(xrefstr);                                   \
 	if (!obj->xrefstr) MEMORY_ERROR;                                      \
+	else gom_index_add(obj->xrefstr, T_ ## STRUCTTYPE, obj);              \
       }                                                                       \
     }                                                                         \
     return obj;                                                               \
@@ -177,11 +179,9 @@
 #define DEFINE_SUB_MAKEFUNC(STRUCTTYPE)                                       \
   struct STRUCTTYPE* SUB_MAKEFUNC(STRUCTTYPE)() {                             \
     struct STRUCTTYPE* obj = NULL;                                            \
-    obj = (struct STRUCTTYPE*) malloc(sizeof(struct STRUCTTYPE));             \
+    obj = (struct STRUCTTYPE*) gom_alloc(sizeof(struct STRUCTTYPE));          \
     if (!obj)                                                                 \
       MEMORY_ERROR;                                                           \
-    else                                                                      \
-      memset(obj, 0, sizeof(struct STRUCTTYPE));                              \
     return obj;                                                               \
   }
 
@@ -189,6 +189,7 @@
   DECLARE_CLEANFUNC(STRUCTTYPE);                                              \
   void DESTROYFUNC(STRUCTTYPE)(struct STRUCTTYPE* obj) {                      \
     if (obj) {                                                                \
+      gom_index_remove(obj->xrefstr, obj);                                    \
       CLEANFUNC(STRUCTTYPE)(obj);                                             \
       UNLINK_CHAIN_ELT(STRUCTTYPE, FIRSTVAL, obj);                            \
       SAFE_FREE(obj);                                                         \
@@ -198,7 +199,11 @@
 #define DEFINE_GETXREFFUNC(STRUCTTYPE,XREF_TYPE)                              \
   struct STRUCTTYPE *GETXREFFUNC(STRUCTTYPE)(const char *xrefstr)             \
   {                                                                           \
-    struct xref_value* xr = gedcom_get_by_xref(xrefstr);                      \
+    struct xref_value* xr;                                                    \
+    void* obj = gom_index_lookup(xrefstr, T_ ## STRUCTTYPE);                  \
+    if (obj)                                                                  \
+      return (struct STRUCTTYPE*)obj;                                         \
+    xr = gedcom_get_by_xref(xrefstr);                                         \
     if (xr && (xr->type == XREF_TYPE) && xr->object)                          \
       return (struct STRUCTTYPE*)(xr->object);                                \
     else                                                                      \
@@ -220,6 +225,8 @@
 	  DESTROYFUNC(STRUCTTYPE)(obj);                                       \
 	  obj = NULL;                                                         \
 	}                                                                     \
+	else                                                                  \
+	  gom_graph_invalidate();                                             \
       }                                                                       \
     }                                                                         \
     return obj;                                                               \
@@ -256,6 +263,7 @@
       if (result == 0) {                                                      \
         UNREFALLFUNC(STRUCTTYPE)(obj);                                        \
 	DESTROYFUNC(STRUCTTYPE)(obj);                                         \
+	gom_graph_invalidate();                                               \
       }                                                                       \
     }                                                                         \
     return result;                                                            \
@@ -352,7 +360,7 @@ void ADDFUNC2_STR(STRUCTTYPE,FIELD)(Gom_ctxt ctxt, const char *str)           \
 {                                                                             \
   struct STRUCTTYPE *obj = SAFE_CTXT_CAST(STRUCTTYPE, ctxt);                  \
   if (obj) {                                                                  \
-    obj->FIELD = strdup(str);                                                 \
+    obj->FIELD = gom_strdup(str);                                             \
     if (! obj->FIELD) MEMORY_ERROR;                                           \
   }                                                                           \
 }
@@ -365,7 +373,7 @@ void ADDFUNC2_STRN(STRUCTTYPE,FIELD)(Gom_ctxt ctxt, const char *str)          \
     int i = 0;                                                                \
     while (i < N-1 && obj->FIELD[i]) i++;                                     \
     if (! obj->FIELD[i]) {                                                    \
-      obj->FIELD[i] = strdup(str);                                            \
+      obj->FIELD[i] = gom_strdup(str);                                        \
       if (! obj->FIELD[i]) MEMORY_ERROR;                                      \
     }                                                                         \
   }                                                                           \
@@ -412,7 +420,7 @@ void ADDFUNC2_STRN(STRUCTTYPE,FIELD)(Gom_ctxt ctxt, const char *str)          \
         = SAFE_CTXT_CAST(STRUCTTYPE, (Gom_ctxt)parent);                       \
       if (obj) {                                                              \
         char *str = GEDCOM_STRING(parsed_value);                              \
-        obj->FIELD = strdup(str);                                             \
+        obj->FIELD = gom_strdup(str);                                         \
         if (! obj->FIELD)                                                     \
 	  MEMORY_ERROR;                                                       \
         else                                                                  \
@@ -431,8 +439,7 @@ void ADDFUNC2_STRN(STRUCTTYPE,FIELD)(Gom_ctxt ctxt, const char *str)          \
     else {                                                                    \
       struct STRUCTTYPE *obj = SAFE_CTXT_CAST(STRUCTTYPE, ctxt);              \
       if (obj) {                                                              \
-	char *str = GEDCOM_STRING(parsed_value);                              \
-	char *newvalue = strdup(str);                                         \
+	char *newvalue = gom_take_string(parsed_value);                       \
 	if (! newvalue)                                                       \
 	  MEMORY_ERROR;                                                       \
 	else                                                                  \
@@ -451,8 +458,7 @@ void ADDFUNC2_STRN(STRUCTTYPE,FIELD)(Gom_ctxt ctxt, const char *str)          \
     else {                                                                    \
       struct STRUCTTYPE *obj = SAFE_CTXT_CAST(STRUCTTYPE, ctxt);              \
       if (obj) {                                                              \
-	char *str = GEDCOM_STRING(parsed_value);                              \
-	char *newvalue = strdup(str);                                         \
+	char *newvalue = gom_take_string(parsed_value);                       \
 	if (! newvalue)                                                       \
 	  MEMORY_ERROR;                                                       \
 	else                                                                  \
@@ -473,7 +479,7 @@ void ADDFUNC2_STRN(STRUCTTYPE,FIELD)(Gom_ctxt ctxt, const char *str)          \
         = SAFE_CTXT_CAST(STRUCTTYPE, (Gom_ctxt)parent);                       \
       if (obj) {                                                              \
         struct date_value dv = GEDCOM_DATE(parsed_value);                     \
-        obj->FIELD = gedcom_new_date_value(&dv);                              \
+        obj->FIELD = gom_new_date_value(&dv);                                 \
         if (! obj->FIELD)                                                     \
 	  MEMORY_ERROR;                                                       \
         else                                                                  \
@@ -494,7 +500,7 @@ void ADDFUNC2_STRN(STRUCTTYPE,FIELD)(Gom_ctxt ctxt, const char *str)          \
         = SAFE_CTXT_CAST(STRUCTTYPE, (Gom_ctxt)parent);                       \
       if (obj) {                                                              \
         struct age_value age = GEDCOM_AGE(parsed_value);                      \
-        obj->FIELD = gedcom_new_age_value(&age);                              \
+        obj->FIELD = gom_new_age_value(&age);                                 \
         if (! obj->FIELD)                                                     \
 	  MEMORY_ERROR;                                                       \
         else                                                                  \
@@ -57,6 +57,8 @@ void gom_default_callback (Gedcom_elt elt, Gedcom_ctxt parent, int level,
 
 void gom_cleanup()
 {
+  gom_index_release();
+  gom_graph_release();
   header_cleanup();
   submission_cleanup();
   families_cleanup();
@@ -67,6 +69,8 @@ void gom_cleanup()
   sources_cleanup();
   submitters_cleanup();
   user_recs_cleanup();
+  gom_release_ctxts();
+  gom_release_memory();
 }
 
 void subscribe_all()
@@ -122,10 +126,34 @@ int gom_parse_file(const char* file_name)
     gedcom_set_compat_options(COMPAT_ALLOW_OUT_OF_CONTEXT);
     subscribe_all();
   }
+  gom_start_memory();
   gom_active = 1;
   return gedcom_parse_file(file_name);
 }
 
+/** This function initializes the object model by parsing GEDCOM data from
+    a block of memory (see \ref gedcom_parse_buffer()).
+
+    \param buffer  The GEDCOM data
+    \param size    The size of the data in bytes
+
+    \retval 0 on success
+    \retval 1 on failure
+*/
+int gom_parse_buffer(const char* buffer, size_t size)
+{
+  if (gom_active) {
+    gom_cleanup();
+  }
+  else {
+    gedcom_set_compat_options(COMPAT_ALLOW_OUT_OF_CONTEXT);
+    subscribe_all();
+  }
+  gom_start_memory();
+  gom_active = 1;
+  return gedcom_parse_buffer(buffer, size);
+}
+
 /** This function starts an empty model.  It does this by parsing the
     \c new.ged
     file in the data directory of the library (\c $PREFIX/share/gedcom-parse).
@@ -144,10 +172,46 @@ int gom_new_model()
   else {
     subscribe_all();
   }
+  gom_start_memory();
   gom_active = 1;
   return gedcom_new_model();
 }
 
+/** This function initializes the object model by loading a snapshot
+    file, written before by \ref gom_save_snapshot().  This is a lot faster
+    than parsing the equivalent GEDCOM file: the file is mapped in memory
+    (where supported), and the strings of the model point directly into it.
+
+    The loaded model is always in arena mode (see \ref gom_set_arena_mode()).
+    The file itself is closed again before the function returns, but the
+    mapping of it (or the copy in memory, where mapping is not supported)
+    is kept until the model is cleaned up.
+
+    \param file_name  The snapshot file
+
+    \retval 0 on success
+    \retval 1 on failure (e.g. if the file was written by another version of
+    the library, or on another platform)
+*/
+int gom_load_snapshot(const char* file_name)
+{
+  if (gom_active) {
+    gom_cleanup();
+  }
+  else {
+    gedcom_set_compat_options(COMPAT_ALLOW_OUT_OF_CONTEXT);
+    subscribe_all();
+  }
+  gom_start_memory();
+  gom_arena_active = 1;
+  gom_active = 1;
+  if (read_snapshot(file_name) != 0) {
+    gom_cleanup();
+    return 1;
+  }
+  return 0;
+}
+
 /** This function writes the current Gedcom model to a file.
 
     \param file_name  The name of the file to write to
@@ -165,22 +229,56 @@ int gom_write_file(const char* file_name, int *total_conv_fails)
 
   hndl = gedcom_write_open(file_name);
   if (hndl) {
-    result = write_header(hndl);
-    result |= write_submission(hndl);
-    result |= write_submitters(hndl);
-    result |= write_individuals(hndl);
-    result |= write_families(hndl);
-    result |= write_multimedia_recs(hndl);
-    result |= write_notes(hndl);
-    result |= write_repositories(hndl);
-    result |= write_sources(hndl);
-    result |= write_user_recs(hndl);
+    result = gom_write_hndl(hndl);
     result |= gedcom_write_close(hndl, total_conv_fails);
   }
 
   return result;
 }
 
+/** This function writes the current Gedcom model to the given write handle,
+    which can be opened by any of the gedcom_write_open functions (e.g. to
+    write to memory).  The handle is not closed.
+
+    \param hndl  The write handle
+
+    \retval 0 on success
+    \retval nonzero on errors
+*/
+int gom_write_hndl(Gedcom_write_hndl hndl)
+{
+  int result;
+
+  result = write_header(hndl);
+  result |= write_submission(hndl);
+  result |= write_submitters(hndl);
+  result |= write_individuals(hndl);
+  result |= write_families(hndl);
+  result |= write_multimedia_recs(hndl);
+  result |= write_notes(hndl);
+  result |= write_repositories(hndl);
+  result |= write_sources(hndl);
+  result |= write_user_recs(hndl);
+
+  return result;
+}
+
+/** This function saves the current Gedcom model in a binary snapshot file,
+    which can be loaded again with \ref gom_load_snapshot().  The snapshot
+    contains the same information as the file written by
+    \ref gom_write_file(), but it can only be read by the same version of
+    the library, on the same platform.
+
+    \param file_name  The name of the file to write to
+
+    \retval 0 on success
+    \retval nonzero on errors
+*/
+int gom_save_snapshot(const char* file_name)
+{
+  return write_snapshot(file_name);
+}
+
 int gom_write_xref_list(Gedcom_write_hndl hndl,
 			Gedcom_elt elt, int tag, int parent_rec_or_elt,
 			struct xref_list* val)
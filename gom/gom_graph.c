@@ -0,0 +1,387 @@
+/* Family graph of the gedcom object model.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#include "gom.h"
+#include "gom_internal.h"
+
+/* The graph is built on demand from the family records (HUSB, WIFE and
+   CHIL, with the PEDI lines in the FAMC links of the children), and is
+   thrown away when the model changes; it is rebuilt by the next
+   gom_get_family_graph().
+
+   The ids of the records are found via a hash table on the record
+   pointer, which is built together with the graph.
+*/
+
+struct id_slot {
+  const void* obj;       /* NULL if the slot is empty */
+  int         id;
+  OBJ_TYPE    type;
+};
+
+static struct family_graph* graph = NULL;
+static int graph_valid = 0;
+
+static struct id_slot* ids = NULL;
+static size_t ids_mask = 0;
+
+static size_t hash_ptr(const void* ptr)
+{
+  size_t h = (size_t)ptr;
+  h ^= h >> 16;
+  h *= 0x45d9f3bU;
+  h ^= h >> 16;
+  return h;
+}
+
+static size_t find_id_slot(const void* obj)
+{
+  size_t i = hash_ptr(obj) & ids_mask;
+  while (ids[i].obj && ids[i].obj != obj)
+    i = (i + 1) & ids_mask;
+  return i;
+}
+
+static void add_id(const void* obj, OBJ_TYPE type, int id)
+{
+  size_t i = find_id_slot(obj);
+  ids[i].obj  = obj;
+  ids[i].type = type;
+  ids[i].id   = id;
+}
+
+static int get_id(const void* obj, OBJ_TYPE type)
+{
+  if (obj && ids) {
+    size_t i = find_id_slot(obj);
+    if (ids[i].obj && ids[i].type == type)
+      return ids[i].id;
+  }
+  return -1;
+}
+
+static int xref_to_id(struct xref_value* xr, OBJ_TYPE type)
+{
+  return xr ? get_id(xr->object, type) : -1;
+}
+
+static void free_graph()
+{
+  if (graph) {
+    free(graph->individuals);
+    free(graph->families);
+    free(graph->husband);
+    free(graph->wife);
+    free(graph->family_children_start);
+    free(graph->family_children);
+    free(graph->parents_start);
+    free(graph->parents);
+    free(graph->children_start);
+    free(graph->children);
+    free(graph->spouses_start);
+    free(graph->spouses);
+    free(graph->family_children_pedigree);
+    free(graph->parents_pedigree);
+    free(graph->children_pedigree);
+    free(graph);
+    graph = NULL;
+  }
+  free(ids);
+  ids = NULL;
+  ids_mask = 0;
+  graph_valid = 0;
+}
+
+static int* alloc_ints(int nr)
+{
+  return (int*)calloc(nr > 0 ? nr : 1, sizeof(int));
+}
+
+static unsigned char* alloc_bytes(int nr)
+{
+  return (unsigned char*)calloc(nr > 0 ? nr : 1, 1);
+}
+
+static int pedigree_flag(const char* str)
+{
+  if (!str)
+    return 0;
+  else if (!strcasecmp(str, "birth"))
+    return PEDIGREE_BIRTH;
+  else if (!strcasecmp(str, "adopted"))
+    return PEDIGREE_ADOPTED;
+  else if (!strcasecmp(str, "foster"))
+    return PEDIGREE_FOSTER;
+  else if (!strcasecmp(str, "sealing"))
+    return PEDIGREE_SEALING;
+  else
+    return PEDIGREE_OTHER;
+}
+
+/* The pedigree linkage types of the child in the family, from the
+   child-to-family links of the child */
+static unsigned char child_pedigree(struct individual* child,
+				    struct family* fam)
+{
+  struct family_link* link;
+  struct pedigree* ped;
+  int flags = 0;
+
+  for (link = child->child_to_family; link; link = link->next) {
+    if (link->family && link->family->object == (Gedcom_ctxt)fam)
+      for (ped = link->pedigree; ped; ped = ped->next)
+	flags |= pedigree_flag(ped->pedigree);
+  }
+  return (unsigned char)(flags ? flags : PEDIGREE_BIRTH);
+}
+
+/* Turns the counts in start[0..n-1] into offsets, with start[n] the total */
+static int make_offsets(int* start, int n)
+{
+  int i, total = 0;
+  for (i = 0; i < n; i++) {
+    int cnt = start[i];
+    start[i] = total;
+    total += cnt;
+  }
+  start[n] = total;
+  return total;
+}
+
+static int build_graph()
+{
+  struct family_graph* g;
+  struct individual* ind;
+  struct family* fam;
+  struct xref_list* xrl;
+  int *p_pos, *c_pos, *s_pos;
+  size_t size = 64;
+  int i, f, h, w, c, nr_ch;
+
+  g = (struct family_graph*)calloc(1, sizeof(struct family_graph));
+  if (!g)
+    return 0;
+  graph = g;
+
+  for (ind = gom_get_first_individual(); ind; ind = ind->next)
+    g->nr_of_individuals++;
+  for (fam = gom_get_first_family(); fam; fam = fam->next)
+    g->nr_of_families++;
+
+  while (size < 2 * (size_t)(g->nr_of_individuals + g->nr_of_families))
+    size *= 2;
+  ids      = (struct id_slot*)calloc(size, sizeof(struct id_slot));
+  ids_mask = size - 1;
+
+  g->individuals = (struct individual**)
+    calloc(g->nr_of_individuals + 1, sizeof(struct individual*));
+  g->families = (struct family**)
+    calloc(g->nr_of_families + 1, sizeof(struct family*));
+  g->husband = alloc_ints(g->nr_of_families);
+  g->wife    = alloc_ints(g->nr_of_families);
+  g->family_children_start = alloc_ints(g->nr_of_families + 1);
+  g->parents_start  = alloc_ints(g->nr_of_individuals + 1);
+  g->children_start = alloc_ints(g->nr_of_individuals + 1);
+  g->spouses_start  = alloc_ints(g->nr_of_individuals + 1);
+  if (!ids || !g->individuals || !g->families || !g->husband || !g->wife
+      || !g->family_children_start || !g->parents_start
+      || !g->children_start || !g->spouses_start)
+    return 0;
+
+  i = 0;
+  for (ind = gom_get_first_individual(); ind; ind = ind->next) {
+    g->individuals[i] = ind;
+    add_id(ind, T_individual, i++);
+  }
+  f = 0;
+  for (fam = gom_get_first_family(); fam; fam = fam->next) {
+    g->families[f] = fam;
+    add_id(fam, T_family, f++);
+  }
+
+  /* First pass: the spouses and the number of children of the families,
+     and the degrees of the individuals */
+  for (f = 0; f < g->nr_of_families; f++) {
+    fam = g->families[f];
+    h = g->husband[f] = xref_to_id(fam->husband, T_individual);
+    w = g->wife[f]    = xref_to_id(fam->wife, T_individual);
+    nr_ch = 0;
+    for (xrl = fam->children; xrl; xrl = xrl->next) {
+      c = xref_to_id(xrl->xref, T_individual);
+      if (c >= 0) {
+	nr_ch++;
+	g->parents_start[c] += (h >= 0) + (w >= 0);
+      }
+    }
+    g->family_children_start[f] = nr_ch;
+    if (h >= 0)
+      g->children_start[h] += nr_ch;
+    if (w >= 0)
+      g->children_start[w] += nr_ch;
+    if (h >= 0 && w >= 0) {
+      g->spouses_start[h]++;
+      g->spouses_start[w]++;
+    }
+  }
+
+  g->family_children
+    = alloc_ints(make_offsets(g->family_children_start, g->nr_of_families));
+  g->parents
+    = alloc_ints(make_offsets(g->parents_start, g->nr_of_individuals));
+  g->children
+    = alloc_ints(make_offsets(g->children_start, g->nr_of_individuals));
+  g->spouses
+    = alloc_ints(make_offsets(g->spouses_start, g->nr_of_individuals));
+  g->family_children_pedigree
+    = alloc_bytes(g->family_children_start[g->nr_of_families]);
+  g->parents_pedigree  = alloc_bytes(g->parents_start[g->nr_of_individuals]);
+  g->children_pedigree = alloc_bytes(g->children_start[g->nr_of_individuals]);
+  if (!g->family_children || !g->parents || !g->children || !g->spouses
+      || !g->family_children_pedigree || !g->parents_pedigree
+      || !g->children_pedigree)
+    return 0;
+
+  /* Second pass: fill in the adjacency arrays, in the order of the
+     families (and of the children within a family) */
+  p_pos = alloc_ints(g->nr_of_individuals);
+  c_pos = alloc_ints(g->nr_of_individuals);
+  s_pos = alloc_ints(g->nr_of_individuals);
+  if (!p_pos || !c_pos || !s_pos) {
+    free(p_pos);
+    free(c_pos);
+    free(s_pos);
+    return 0;
+  }
+  for (i = 0; i < g->nr_of_individuals; i++) {
+    p_pos[i] = g->parents_start[i];
+    c_pos[i] = g->children_start[i];
+    s_pos[i] = g->spouses_start[i];
+  }
+  for (f = 0; f < g->nr_of_families; f++) {
+    int* fc = g->family_children + g->family_children_start[f];
+    unsigned char* fp
+      = g->family_children_pedigree + g->family_children_start[f];
+    fam = g->families[f];
+    h = g->husband[f];
+    w = g->wife[f];
+    nr_ch = 0;
+    for (xrl = fam->children; xrl; xrl = xrl->next) {
+      c = xref_to_id(xrl->xref, T_individual);
+      if (c >= 0) {
+	unsigned char ped = child_pedigree(g->individuals[c], fam);
+	fp[nr_ch]   = ped;
+	fc[nr_ch++] = c;
+	if (h >= 0) {
+	  g->parents_pedigree[p_pos[c]] = ped;
+	  g->parents[p_pos[c]++] = h;
+	}
+	if (w >= 0) {
+	  g->parents_pedigree[p_pos[c]] = ped;
+	  g->parents[p_pos[c]++] = w;
+	}
+      }
+    }
+    if (h >= 0) {
+      memcpy(g->children + c_pos[h], fc, nr_ch * sizeof(int));
+      memcpy(g->children_pedigree + c_pos[h], fp, nr_ch);
+      c_pos[h] += nr_ch;
+    }
+    if (w >= 0) {
+      memcpy(g->children + c_pos[w], fc, nr_ch * sizeof(int));
+      memcpy(g->children_pedigree + c_pos[w], fp, nr_ch);
+      c_pos[w] += nr_ch;
+    }
+    if (h >= 0 && w >= 0) {
+      g->spouses[s_pos[h]++] = w;
+      g->spouses[s_pos[w]++] = h;
+    }
+  }
+  free(p_pos);
+  free(c_pos);
+  free(s_pos);
+  return 1;
+}
+
+/** This function returns the family graph of the current object model: a
+    compact representation of the relations between the individuals, with
+    dense integer ids for the individuals and the families, and arrays of
+    parents, children and spouses (see struct family_graph).
+
+    The graph is built from the family records on the first call, and is
+    kept until the model is modified via the functions of the library
+    (adding or deleting records, or changing cross-references), after which
+    the next call builds it again.  The returned pointer is valid until
+    then (and until the model is cleaned up).
+
+    \return The family graph, or \c NULL in case of memory errors.
+*/
+const struct family_graph* gom_get_family_graph()
+{
+  if (!graph_valid) {
+    free_graph();
+    if (!build_graph()) {
+      MEMORY_ERROR;
+      free_graph();
+      return NULL;
+    }
+    graph_valid = 1;
+  }
+  return graph;
+}
+
+/** This function returns the id of an individual in the family graph, i.e.
+    its index in the \c individuals array of the graph.
+
+    \param obj The individual
+
+    \return The id, or -1 if the individual is not in the current graph
+    (or if there is no current graph, see \ref gom_get_family_graph()).
+*/
+int gom_get_individual_id(const struct individual* obj)
+{
+  return graph_valid ? get_id(obj, T_individual) : -1;
+}
+
+/** This function returns the id of a family in the family graph, i.e. its
+    index in the \c families array of the graph.
+
+    \param obj The family
+
+    \return The id, or -1 if the family is not in the current graph (or if
+    there is no current graph, see \ref gom_get_family_graph()).
+*/
+int gom_get_family_id(const struct family* obj)
+{
+  return graph_valid ? get_id(obj, T_family) : -1;
+}
+
+/* Called when records or cross-references are added or removed */
+void gom_graph_invalidate()
+{
+  graph_valid = 0;
+}
+
+/* Called from gom_cleanup */
+void gom_graph_release()
+{
+  free_graph();
+}
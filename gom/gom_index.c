@@ -0,0 +1,167 @@
+/* Index of the records of the gedcom object model on cross-reference.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#include "gom.h"
+#include "gom_internal.h"
+
+/* The records that have a cross-reference key are kept in an
+   open-addressing hash table with linear probing, so that the
+   gom_get_..._by_xref functions don't have to go via the cross-reference
+   table of the parser (which needs locking and key validation).
+
+   The keys are not copied: the table points to the xrefstr of the record
+   itself, which doesn't change during the lifetime of the record.
+*/
+
+#define INDEX_MIN_SLOTS  256
+
+struct index_slot {
+  unsigned int hash;
+  OBJ_TYPE     type;
+  const char*  key;       /* NULL if the slot is empty */
+  void*        obj;
+};
+
+static struct index_slot* slots = NULL;
+static size_t mask  = 0;  /* number of slots - 1 */
+static size_t count = 0;
+
+/* FNV-1a; the keys are short */
+static unsigned int hash_key(const char* key)
+{
+  unsigned int h = 2166136261U;
+  for (; *key; key++) {
+    h ^= (unsigned char)*key;
+    h *= 16777619U;
+  }
+  return h;
+}
+
+static size_t find_slot(const char* key, unsigned int hash)
+{
+  size_t i = hash & mask;
+  while (slots[i].key) {
+    if (slots[i].hash == hash && strcmp(slots[i].key, key) == 0)
+      break;
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+static int grow_index()
+{
+  size_t new_size = slots ? (mask + 1) * 2 : INDEX_MIN_SLOTS;
+  size_t new_mask = new_size - 1;
+  struct index_slot* new_slots
+    = (struct index_slot*)calloc(new_size, sizeof(struct index_slot));
+  size_t i, j;
+
+  if (!new_slots)
+    return 0;
+  if (slots) {
+    for (i = 0; i <= mask; i++) {
+      if (slots[i].key) {
+	j = slots[i].hash & new_mask;
+	while (new_slots[j].key)
+	  j = (j + 1) & new_mask;
+	new_slots[j] = slots[i];
+      }
+    }
+    free(slots);
+  }
+  slots = new_slots;
+  mask  = new_mask;
+  return 1;
+}
+
+/* Adds a record to the index (called when the record is made) */
+void gom_index_add(const char* xrefstr, OBJ_TYPE type, void* obj)
+{
+  unsigned int hash;
+  size_t i;
+
+  if (!xrefstr || !obj)
+    return;
+  if ((!slots || (count + 1) * 10 > (mask + 1) * 7) && !grow_index()) {
+    MEMORY_ERROR;
+    return;
+  }
+  hash = hash_key(xrefstr);
+  i = find_slot(xrefstr, hash);
+  if (!slots[i].key)
+    count++;
+  slots[i].hash = hash;
+  slots[i].type = type;
+  slots[i].key  = xrefstr;
+  slots[i].obj  = obj;
+}
+
+/* Removes a record from the index (called when the record is destroyed) */
+void gom_index_remove(const char* xrefstr, void* obj)
+{
+  size_t i, j;
+
+  if (!xrefstr || !slots)
+    return;
+  i = find_slot(xrefstr, hash_key(xrefstr));
+  if (!slots[i].key || slots[i].obj != obj)
+    return;
+
+  /* Shift the following entries of the cluster back, so that no
+     tombstones are needed */
+  j = i;
+  for (;;) {
+    size_t home;
+    j = (j + 1) & mask;
+    if (!slots[j].key)
+      break;
+    home = slots[j].hash & mask;
+    if ((j > i && (home <= i || home > j))
+	|| (j < i && (home <= i && home > j))) {
+      slots[i] = slots[j];
+      i = j;
+    }
+  }
+  slots[i].key = NULL;
+  slots[i].obj = NULL;
+  count--;
+}
+
+/* Returns the record with the given key, if it has the given type */
+void* gom_index_lookup(const char* xrefstr, OBJ_TYPE type)
+{
+  if (xrefstr && slots) {
+    size_t i = find_slot(xrefstr, hash_key(xrefstr));
+    if (slots[i].key && slots[i].type == type)
+      return slots[i].obj;
+  }
+  return NULL;
+}
+
+/* Called from gom_cleanup */
+void gom_index_release()
+{
+  free(slots);
+  slots = NULL;
+  mask  = 0;
+  count = 0;
+}
@@ -42,34 +42,69 @@ const char* ctxt_names[] =
     - If not NULL, the ctxt_ptr of the context is not NULL also
     - UNEXPECTED_CONTEXT is not treated as an error, but as a warning
 
-   The context chain keeps contexts until the end of the record, so that
-   elements out of context can be handled.
+   The contexts are kept until the end of the record, so that elements out
+   of context can be handled.  They are taken from a pool of blocks, which
+   is rewound at the end of each record; the blocks themselves are only
+   freed by gom_cleanup.
 */
 
+#define CTXT_BLOCK_SIZE 256
+
 struct Gom_ctxt_struct {
   int ctxt_type;
   OBJ_TYPE obj_type;
   void* ctxt_ptr;
-  struct Gom_ctxt_struct* next;
 };
 
-struct Gom_ctxt_struct* ctxt_chain = NULL;
+struct ctxt_block {
+  struct ctxt_block* next;
+  struct Gom_ctxt_struct ctxts[CTXT_BLOCK_SIZE];
+};
+
+static struct ctxt_block* ctxt_blocks  = NULL;
+static struct ctxt_block* ctxt_current = NULL;  /* the block in use */
+static int ctxt_used                   = 0;     /* used in that block */
 
 Gom_ctxt make_gom_ctxt(int ctxt_type, OBJ_TYPE obj_type, void *ctxt_ptr)
 {
-  Gom_ctxt ctxt   = (Gom_ctxt)malloc(sizeof(struct Gom_ctxt_struct));
-  if (! ctxt)
-    MEMORY_ERROR;
-  else {
-    ctxt->ctxt_type = ctxt_type;
-    ctxt->obj_type  = obj_type;
-    ctxt->ctxt_ptr  = ctxt_ptr;
-    ctxt->next      = ctxt_chain;
-    ctxt_chain      = ctxt;
+  Gom_ctxt ctxt;
+  if (! ctxt_current || ctxt_used == CTXT_BLOCK_SIZE) {
+    struct ctxt_block* next
+      = (ctxt_current ? ctxt_current->next : ctxt_blocks);
+    if (! next) {
+      next = (struct ctxt_block*)malloc(sizeof(struct ctxt_block));
+      if (! next) {
+	MEMORY_ERROR;
+	return NULL;
+      }
+      next->next = NULL;
+      if (ctxt_current)
+	ctxt_current->next = next;
+      else
+	ctxt_blocks = next;
+    }
+    ctxt_current = next;
+    ctxt_used    = 0;
   }
+  ctxt = &ctxt_current->ctxts[ctxt_used++];
+  ctxt->ctxt_type = ctxt_type;
+  ctxt->obj_type  = obj_type;
+  ctxt->ctxt_ptr  = ctxt_ptr;
   return ctxt;
 }
 
+/* Called from gom_cleanup */
+void gom_release_ctxts()
+{
+  while (ctxt_blocks) {
+    struct ctxt_block* next = ctxt_blocks->next;
+    free(ctxt_blocks);
+    ctxt_blocks = next;
+  }
+  ctxt_current = NULL;
+  ctxt_used    = 0;
+}
+
 Gom_ctxt dup_gom_ctxt(Gom_ctxt ctxt, int ctxt_type)
 {
   return make_gom_ctxt(ctxt_type, ctxt->obj_type, ctxt->ctxt_ptr);
@@ -97,11 +132,6 @@ void NULL_DESTROY(void* anything UNUSED)
 {
 }
 
-void destroy_gom_ctxt(Gom_ctxt ctxt)
-{
-  SAFE_FREE(ctxt);
-}
-
 void gom_cast_error(const char* file, int line,
 		    OBJ_TYPE expected, OBJ_TYPE found)
 {
@@ -135,12 +165,8 @@ void gom_no_context(const char* file, int line)
 void def_rec_end(Gedcom_rec rec UNUSED, Gedcom_ctxt self UNUSED,
 		 Gedcom_val parsed_value UNUSED)
 {
-  Gom_ctxt ctxt;
-  while (ctxt_chain) {
-    ctxt = ctxt_chain;
-    ctxt_chain = ctxt->next;
-    destroy_gom_ctxt(ctxt);
-  }
+  ctxt_current = NULL;
+  ctxt_used    = 0;
 }
 
 void def_elt_end(Gedcom_elt elt UNUSED, Gedcom_ctxt parent UNUSED,
@@ -65,6 +65,7 @@ Gom_ctxt dup_gom_ctxt(Gom_ctxt ctxt, int ctxt_type);
 void* safe_ctxt_cast(Gom_ctxt ctxt, OBJ_TYPE type, const char* file, int line);
 int ctxt_type(Gom_ctxt ctxt);
 OBJ_TYPE ctxt_obj_type(Gom_ctxt ctxt);
+void gom_release_ctxts();
 
 void gom_cast_error(const char* file, int line,
 		    OBJ_TYPE expected, OBJ_TYPE found);
@@ -87,7 +88,7 @@ int gom_write_xref_list(Gedcom_write_hndl hndl,
 
 #define SAFE_FREE(PTR)                                                        \
   if (PTR) {                                                                  \
-    free(PTR);                                                                \
+    gom_free(PTR);                                                            \
     PTR = NULL;                                                               \
   }
 
@@ -99,8 +100,39 @@ int gom_write_xref_list(Gedcom_write_hndl hndl,
 
 void gom_mem_error(const char *filename, int line);
 
+/* Memory of the object model (gom_memory.c) */
+extern int gom_arena_active;
+
+#define ADOPT_NONE    0
+#define ADOPT_MAPPED  1
+#define ADOPT_MALLOC  2
+
+void  gom_start_memory();
+void  gom_release_memory();
+int   gom_adopt_memory(void* start, size_t size, int adopted);
+void* gom_alloc(size_t size);
+char* gom_strdup(const char* str);
+char* gom_take_string(Gedcom_val val);
+void  gom_free(void* ptr);
+struct date_value* gom_new_date_value(const struct date_value* copy_from);
+struct age_value*  gom_new_age_value(const struct age_value* copy_from);
+
 #define MEMORY_ERROR gom_mem_error(__FILE__, __LINE__)
 
+/* Index of the records on cross-reference (gom_index.c) */
+void  gom_index_add(const char* xrefstr, OBJ_TYPE type, void* obj);
+void  gom_index_remove(const char* xrefstr, void* obj);
+void* gom_index_lookup(const char* xrefstr, OBJ_TYPE type);
+void  gom_index_release();
+
+/* Family graph (gom_graph.c) */
+void gom_graph_invalidate();
+void gom_graph_release();
+
+/* Snapshots (gom_snapshot.c) */
+int write_snapshot(const char* file_name);
+int read_snapshot(const char* file_name);
+
 void def_rec_end(Gedcom_rec rec, Gedcom_ctxt self, Gedcom_val parsed_value);
 void def_elt_end(Gedcom_elt elt, Gedcom_ctxt parent,
 		 Gedcom_ctxt self, Gedcom_val parsed_value);
@@ -0,0 +1,317 @@
+/* Memory allocation for the gedcom object model.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#include "gom.h"
+#include "gom_internal.h"
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+/* All the memory of the object model (the structs and the strings) is
+   allocated via the functions below.  By default they just use malloc and
+   free, but in arena mode the memory comes from large slabs, which are
+   only given back when the model is cleaned up.
+
+   In arena mode, gom_free() doesn't give memory back to the slabs: memory
+   that is freed during modifications of the model is only reclaimed by
+   the next cleanup.  Pointers that don't come from the slabs (e.g. date
+   values allocated with gedcom_new_date_value() and stored in the model
+   by the application) are still freed.
+
+   Blocks of memory that were not allocated here (e.g. a mapped snapshot
+   file, see gom_snapshot.c) can be adopted as slabs, so that the model can
+   point into them; they are released together with the other slabs.
+*/
+
+#define SLAB_SIZE       (1024 * 1024)
+#define MAX_SLAB_ALLOC  (SLAB_SIZE / 8)
+
+union max_align {
+  long        l;
+  double      d;
+  long double ld;
+  void*       p;
+};
+
+#define ALIGNMENT     sizeof(union max_align)
+#define ALIGN_UP(N)   (((N) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT)
+#define SLAB_HEADER   ALIGN_UP(sizeof(struct slab))
+
+struct slab {
+  char* start;
+  char* end;
+  int   adopted;
+};
+
+static int arena_setting = 0;
+int gom_arena_active     = 0;
+
+/* The slabs, sorted on their start address (for gom_free) */
+static struct slab** slabs = NULL;
+static int nr_of_slabs     = 0;
+static int max_slabs       = 0;
+
+/* The current slab, and the free space in it */
+static char* slab_start = NULL;
+static char* slab_free  = NULL;
+static char* slab_end   = NULL;
+
+static int find_slab(const char* ptr)
+{
+  int low = 0, high = nr_of_slabs;
+  while (low < high) {
+    int mid = (low + high) / 2;
+    if (slabs[mid]->start <= ptr)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low - 1;
+}
+
+static int reserve_slab()
+{
+  if (nr_of_slabs == max_slabs) {
+    int new_max = max_slabs ? max_slabs * 2 : 64;
+    struct slab** new_slabs
+      = (struct slab**)realloc(slabs, new_max * sizeof(struct slab*));
+    if (!new_slabs)
+      return 0;
+    slabs     = new_slabs;
+    max_slabs = new_max;
+  }
+  return 1;
+}
+
+static struct slab* new_slab(size_t size)
+{
+  struct slab* slab;
+  int pos;
+
+  if (!reserve_slab())
+    return NULL;
+
+  slab = (struct slab*)malloc(SLAB_HEADER + size);
+  if (!slab)
+    return NULL;
+  slab->start   = (char*)slab + SLAB_HEADER;
+  slab->end     = slab->start + size;
+  slab->adopted = ADOPT_NONE;
+
+  pos = find_slab(slab->start) + 1;
+  memmove(slabs + pos + 1, slabs + pos,
+	  (nr_of_slabs - pos) * sizeof(struct slab*));
+  slabs[pos] = slab;
+  nr_of_slabs++;
+  return slab;
+}
+
+static void* arena_alloc(size_t size, size_t align)
+{
+  char* ptr;
+
+  if (size > MAX_SLAB_ALLOC) {
+    /* Big allocations get their own slab, the current slab is kept */
+    struct slab* slab = new_slab(ALIGN_UP(size));
+    return slab ? slab->start : NULL;
+  }
+
+  ptr = slab_free;
+  if (ptr && align > 1)
+    ptr = slab_start + ALIGN_UP((size_t)(ptr - slab_start));
+  if (!ptr || ptr + size > slab_end) {
+    struct slab* slab = new_slab(SLAB_SIZE);
+    if (!slab)
+      return NULL;
+    ptr        = slab->start;
+    slab_start = slab->start;
+    slab_end   = slab->end;
+  }
+  slab_free = ptr + size;
+  return ptr;
+}
+
+/** This function enables or disables the arena allocation mode for the
+    Gedcom object model.  In arena mode, all the memory of the model is
+    allocated from large blocks, which makes building the model faster, and
+    which allows \ref gom_cleanup() (and the cleanup at the start of the
+    next \ref gom_parse_file()) to release the model at once, instead of
+    object per object.
+
+    The model can still be modified in arena mode, but the memory of
+    deleted objects and replaced strings is only reclaimed when the model
+    is cleaned up.
+
+    The setting takes effect for the next model that is built, via
+    \ref gom_parse_file(), \ref gom_parse_buffer() or \ref gom_new_model().
+
+    \param enable  Nonzero to enable arena mode, 0 to disable it (the
+    default)
+*/
+void gom_set_arena_mode(int enable)
+{
+  arena_setting = enable;
+}
+
+/* Called when a new model is started (after the cleanup of the old one) */
+void gom_start_memory()
+{
+  gom_arena_active = arena_setting;
+}
+
+/* Adds the given block as slab; 'adopted' says how to release it
+   (ADOPT_MAPPED or ADOPT_MALLOC).  Returns 0 on memory errors, in which
+   case the block is not adopted */
+int gom_adopt_memory(void* start, size_t size, int adopted)
+{
+  struct slab* slab;
+  int pos;
+
+  if (!reserve_slab())
+    return 0;
+  slab = (struct slab*)malloc(sizeof(struct slab));
+  if (!slab)
+    return 0;
+  slab->start   = (char*)start;
+  slab->end     = slab->start + size;
+  slab->adopted = adopted;
+
+  pos = find_slab(slab->start) + 1;
+  memmove(slabs + pos + 1, slabs + pos,
+	  (nr_of_slabs - pos) * sizeof(struct slab*));
+  slabs[pos] = slab;
+  nr_of_slabs++;
+  return 1;
+}
+
+/* Called at the end of gom_cleanup: releases all the slabs */
+void gom_release_memory()
+{
+  int i;
+  for (i = 0; i < nr_of_slabs; i++) {
+#ifdef HAVE_MMAP
+    if (slabs[i]->adopted == ADOPT_MAPPED)
+      munmap(slabs[i]->start, slabs[i]->end - slabs[i]->start);
+#endif
+    if (slabs[i]->adopted == ADOPT_MALLOC)
+      free(slabs[i]->start);
+    free(slabs[i]);
+  }
+  free(slabs);
+  slabs       = NULL;
+  nr_of_slabs = 0;
+  max_slabs   = 0;
+  slab_start  = NULL;
+  slab_free   = NULL;
+  slab_end    = NULL;
+  gom_arena_active = 0;
+}
+
+/* Returns zero-initialized memory, or NULL if no memory is available */
+void* gom_alloc(size_t size)
+{
+  void* ptr;
+  if (gom_arena_active) {
+    ptr = arena_alloc(size, ALIGNMENT);
+    if (ptr)
+      memset(ptr, 0, size);
+  }
+  else
+    ptr = calloc(1, size);
+  return ptr;
+}
+
+char* gom_strdup(const char* str)
+{
+  if (gom_arena_active) {
+    size_t len = strlen(str) + 1;
+    char* ptr  = (char*)arena_alloc(len, 1);
+    if (ptr)
+      memcpy(ptr, str, len);
+    return ptr;
+  }
+  else
+    return strdup(str);
+}
+
+/* Returns the string of a parsed value for storing in the model: outside
+   arena mode, the string is taken over from the parser (see
+   gedcom_take_string), which avoids copying long concatenated values */
+char* gom_take_string(Gedcom_val val)
+{
+  if (gom_arena_active)
+    return gom_strdup(GEDCOM_STRING(val));
+  else
+    return gedcom_take_string(val);
+}
+
+void gom_free(void* ptr)
+{
+  if (ptr && gom_arena_active && nr_of_slabs) {
+    int pos = find_slab((const char*)ptr);
+    if (pos >= 0 && (char*)ptr < slabs[pos]->end)
+      return;
+  }
+  free(ptr);
+}
+
+struct date_value* gom_new_date_value(const struct date_value* copy_from)
+{
+  struct date_value* dv;
+  if (!gom_arena_active)
+    return gedcom_new_date_value(copy_from);
+
+  dv = (struct date_value*)arena_alloc(sizeof(struct date_value), ALIGNMENT);
+  if (dv) {
+    if (copy_from)
+      memcpy(dv, copy_from, sizeof(struct date_value));
+    else {
+      struct date_value* init = gedcom_new_date_value(NULL);
+      if (!init)
+	return NULL;
+      memcpy(dv, init, sizeof(struct date_value));
+      free(init);
+    }
+  }
+  return dv;
+}
+
+struct age_value* gom_new_age_value(const struct age_value* copy_from)
+{
+  struct age_value* age;
+  if (!gom_arena_active)
+    return gedcom_new_age_value(copy_from);
+
+  age = (struct age_value*)arena_alloc(sizeof(struct age_value), ALIGNMENT);
+  if (age) {
+    if (copy_from)
+      memcpy(age, copy_from, sizeof(struct age_value));
+    else {
+      struct age_value* init = gedcom_new_age_value(NULL);
+      if (!init)
+	return NULL;
+      memcpy(age, init, sizeof(struct age_value));
+      free(init);
+    }
+  }
+  return age;
+}
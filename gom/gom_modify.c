@@ -104,7 +104,7 @@ char* gom_set_string(char** data, const char* utf8_str)
       gedcom_error(_("The input '%s' is not a valid UTF-8 string"), utf8_str);
     }
     else {
-      newptr = strdup(utf8_str);
+      newptr = gom_strdup(utf8_str);
       if (!newptr)
 	MEMORY_ERROR;
       else {
@@ -222,6 +222,7 @@ struct xref_value* gom_set_xref(struct xref_value** data, const char* xref)
     if (result != NULL) {
       *data = newval;
       result = newval;
+      gom_graph_invalidate();
     }
   }
   return result;
@@ -250,7 +251,10 @@ struct xref_list* gom_add_xref(struct xref_list** data, const char* xref)
       result = gedcom_link_xref(newval->type, newval->string);
       if (result != NULL) {
 	MAKE_CHAIN_ELT(xref_list, *data, xrl);
-	if (xrl) xrl->xref = newval;
+	if (xrl) {
+	  xrl->xref = newval;
+	  gom_graph_invalidate();
+	}
       }
     }
   }
@@ -299,6 +303,7 @@ int gom_remove_xref(struct xref_list** data, const char* xref)
       gedcom_unlink_xref(xrl->xref->type, xrl->xref->string);
       CLEANFUNC(xref_list)(xrl);
       SAFE_FREE(xrl);
+      gom_graph_invalidate();
       result = 0;
     }
   }
@@ -328,6 +333,7 @@ int gom_move_xref(Gom_direction dir, struct xref_list** data, const char* xref)
     struct xref_list* xrl = find_xref(data, xref);
     if (xrl) {
       MOVE_CHAIN_ELT(xref_list, dir, *data, xrl);
+      gom_graph_invalidate();
       result = 0;
     }
   }
@@ -0,0 +1,1015 @@
+/* Binary snapshots of the gedcom object model.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#include "header.h"
+#include "submission.h"
+#include "submitter.h"
+#include "family.h"
+#include "individual.h"
+#include "multimedia.h"
+#include "note.h"
+#include "repository.h"
+#include "source.h"
+#include "user_rec.h"
+#include "gom.h"
+#include "gedcom.h"
+#include "gom_internal.h"
+#include <stddef.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+/* A snapshot file consists of:
+
+     - a header (struct snapshot_header), which identifies the version of
+       the format and the sizes of the native types;
+     - the cross-reference table: for each cross-reference two words, its
+       type and the offset of its key in the string pool;
+     - the string pool: all strings, null-terminated;
+     - the data: a sequence of words, in which the records and their
+       sub-structures are written field by field, as described by the
+       tables below.
+
+   All offsets are relative to the sections, so the file can be mapped
+   anywhere.  On loading, the strings (and the date and age values) of the
+   model point into the mapped file, which is adopted as an arena slab (see
+   gom_memory.c); only the structs are allocated and filled in.
+
+   The data encodes the fields as follows:
+     - strings: 0 for NULL, otherwise the offset in the pool plus 1;
+     - cross-references: 0 for NULL, otherwise the index plus 1;
+     - integers: the value;
+     - dates and ages: 0 for NULL, otherwise 1 followed by the native
+       struct, padded to whole words;
+     - single sub-structures: 0 for NULL, otherwise 1 followed by the
+       fields of the sub-structure;
+     - lists of sub-structures: the number of elements, followed by the
+       fields of each element.
+
+   Each record starts with the index plus 1 of its own cross-reference (0 if
+   it has none), then come its fields.  The header comes first, then the
+   submission (preceded by 1 if there is one, 0 otherwise), and then the
+   other record lists, each preceded by its length.
+*/
+
+#define SNAPSHOT_MAGIC      "GOMSNAP"
+#define SNAPSHOT_VERSION    1
+#define SNAPSHOT_BYTE_ORDER 0x01020304U
+#define MAX_NESTING         256
+
+typedef unsigned int snap_word;
+
+struct snapshot_header {
+  char      magic[8];
+  snap_word version;
+  snap_word byte_order;
+  snap_word word_size;
+  snap_word date_size;
+  snap_word age_size;
+  snap_word nr_of_xrefs;
+  snap_word pool_size;       /* in bytes, a multiple of the word size */
+  snap_word nr_of_words;     /* of the data */
+};
+
+#define WORDS(SIZE)  (((SIZE) + sizeof(snap_word) - 1) / sizeof(snap_word))
+
+/* Description of the structs */
+
+typedef enum {
+  F_END, F_STRING, F_INT, F_XREF, F_DATE, F_AGE, F_SUB, F_LIST
+} field_kind;
+
+typedef enum {
+  S_user_data, S_address, S_text, S_source_citation, S_note_sub, S_place,
+  S_multimedia_link, S_lds_event, S_user_ref_number, S_change_date,
+  S_event, S_xref_list, S_personal_name, S_pedigree, S_family_link,
+  S_association, S_source_event, S_source_description,
+  S_header, S_submission, S_family, S_individual, S_multimedia, S_note,
+  S_repository, S_source, S_submitter, S_user_rec,
+  S_LAST
+} struct_kind;
+
+struct field_desc {
+  field_kind  kind;
+  size_t      offset;
+  struct_kind sub;
+};
+
+struct struct_desc {
+  size_t size;
+  size_t next;       /* offsets of next and previous, for lists */
+  size_t previous;
+  const struct field_desc* fields;
+};
+
+#define FLD(KIND,S,F,SUB)  { KIND, offsetof(struct S, F), SUB }
+#define STR(S,F)           FLD(F_STRING, S, F, 0)
+#define STR_N(S,F,N)       { F_STRING, offsetof(struct S, F) \
+                                       + (N) * sizeof(char*), 0 }
+#define STR3(S,F)          STR_N(S,F,0), STR_N(S,F,1), STR_N(S,F,2)
+#define INT(S,F)           FLD(F_INT, S, F, 0)
+#define XREF(S,F)          FLD(F_XREF, S, F, 0)
+#define DATE(S,F)          FLD(F_DATE, S, F, 0)
+#define AGE(S,F)           FLD(F_AGE, S, F, 0)
+#define SUB(S,F,T)         FLD(F_SUB, S, F, S_ ## T)
+#define LIST(S,F,T)        FLD(F_LIST, S, F, S_ ## T)
+#define EXTRA(S)           LIST(S, extra, user_data)
+#define END                { F_END, 0, 0 }
+
+static const struct field_desc user_data_fields[] = {
+  INT(user_data, level), STR(user_data, tag), STR(user_data, str_value),
+  XREF(user_data, xref_value), END
+};
+
+static const struct field_desc address_fields[] = {
+  STR(address, full_label), STR(address, line1), STR(address, line2),
+  STR(address, city), STR(address, state), STR(address, postal),
+  STR(address, country), EXTRA(address), END
+};
+
+static const struct field_desc text_fields[] = {
+  STR(text, text), EXTRA(text), END
+};
+
+static const struct field_desc source_citation_fields[] = {
+  STR(source_citation, description), XREF(source_citation, reference),
+  STR(source_citation, page), STR(source_citation, event),
+  STR(source_citation, role), DATE(source_citation, date),
+  LIST(source_citation, text, text), STR(source_citation, quality),
+  LIST(source_citation, mm_link, multimedia_link),
+  LIST(source_citation, note, note_sub), EXTRA(source_citation), END
+};
+
+static const struct field_desc note_sub_fields[] = {
+  STR(note_sub, text), XREF(note_sub, reference),
+  LIST(note_sub, citation, source_citation), EXTRA(note_sub), END
+};
+
+static const struct field_desc place_fields[] = {
+  STR(place, value), STR(place, place_hierarchy),
+  LIST(place, citation, source_citation), LIST(place, note, note_sub),
+  EXTRA(place), END
+};
+
+static const struct field_desc multimedia_link_fields[] = {
+  XREF(multimedia_link, reference), STR(multimedia_link, form),
+  STR(multimedia_link, title), STR(multimedia_link, file),
+  LIST(multimedia_link, note, note_sub), EXTRA(multimedia_link), END
+};
+
+static const struct field_desc lds_event_fields[] = {
+  INT(lds_event, event), STR(lds_event, event_name),
+  STR(lds_event, date_status), DATE(lds_event, date),
+  STR(lds_event, temple_code), STR(lds_event, place_living_ordinance),
+  XREF(lds_event, family), LIST(lds_event, citation, source_citation),
+  LIST(lds_event, note, note_sub), EXTRA(lds_event), END
+};
+
+static const struct field_desc user_ref_number_fields[] = {
+  STR(user_ref_number, value), STR(user_ref_number, type),
+  EXTRA(user_ref_number), END
+};
+
+static const struct field_desc change_date_fields[] = {
+  DATE(change_date, date), STR(change_date, time),
+  LIST(change_date, note, note_sub), EXTRA(change_date), END
+};
+
+static const struct field_desc event_fields[] = {
+  INT(event, event), STR(event, event_name), STR(event, val),
+  STR(event, type), DATE(event, date), SUB(event, place, place),
+  SUB(event, address, address), STR3(event, phone), AGE(event, age),
+  STR(event, agency), STR(event, cause),
+  LIST(event, citation, source_citation),
+  LIST(event, mm_link, multimedia_link), LIST(event, note, note_sub),
+  AGE(event, husband_age), AGE(event, wife_age), XREF(event, family),
+  STR(event, adoption_parent), EXTRA(event), END
+};
+
+static const struct field_desc xref_list_fields[] = {
+  XREF(xref_list, xref), EXTRA(xref_list), END
+};
+
+static const struct field_desc personal_name_fields[] = {
+  STR(personal_name, name), STR(personal_name, prefix),
+  STR(personal_name, given), STR(personal_name, nickname),
+  STR(personal_name, surname_prefix), STR(personal_name, surname),
+  STR(personal_name, suffix), LIST(personal_name, citation, source_citation),
+  LIST(personal_name, note, note_sub), EXTRA(personal_name), END
+};
+
+static const struct field_desc pedigree_fields[] = {
+  STR(pedigree, pedigree), EXTRA(pedigree), END
+};
+
+static const struct field_desc family_link_fields[] = {
+  XREF(family_link, family), LIST(family_link, pedigree, pedigree),
+  LIST(family_link, note, note_sub), EXTRA(family_link), END
+};
+
+static const struct field_desc association_fields[] = {
+  XREF(association, to), STR(association, type), STR(association, relation),
+  LIST(association, citation, source_citation),
+  LIST(association, note, note_sub), EXTRA(association), END
+};
+
+static const struct field_desc source_event_fields[] = {
+  STR(source_event, recorded_events), DATE(source_event, date_period),
+  STR(source_event, jurisdiction), EXTRA(source_event), END
+};
+
+static const struct field_desc source_description_fields[] = {
+  STR(source_description, call_number), STR(source_description, media),
+  EXTRA(source_description), END
+};
+
+static const struct field_desc header_fields[] = {
+  STR(header, source.id), STR(header, source.name),
+  STR(header, source.version), STR(header, source.corporation.name),
+  SUB(header, source.corporation.address, address),
+  STR3(header, source.corporation.phone), STR(header, source.data.name),
+  DATE(header, source.data.date), STR(header, source.data.copyright),
+  STR(header, destination), DATE(header, date), STR(header, time),
+  XREF(header, submitter), XREF(header, submission), STR(header, filename),
+  STR(header, copyright), STR(header, gedcom.version),
+  STR(header, gedcom.form), STR(header, charset.name),
+  STR(header, charset.version), STR(header, language),
+  STR(header, place_hierarchy), STR(header, note), EXTRA(header), END
+};
+
+static const struct field_desc submission_fields[] = {
+  XREF(submission, submitter), STR(submission, family_file),
+  STR(submission, temple_code), STR(submission, nr_of_ancestor_gens),
+  STR(submission, nr_of_descendant_gens),
+  STR(submission, ordinance_process_flag), STR(submission, record_id),
+  EXTRA(submission), END
+};
+
+static const struct field_desc family_fields[] = {
+  LIST(family, event, event), XREF(family, husband), XREF(family, wife),
+  LIST(family, children, xref_list), STR(family, nr_of_children),
+  LIST(family, submitters, xref_list),
+  LIST(family, lds_spouse_sealing, lds_event),
+  LIST(family, citation, source_citation),
+  LIST(family, mm_link, multimedia_link), LIST(family, note, note_sub),
+  LIST(family, ref, user_ref_number), STR(family, record_id),
+  SUB(family, change_date, change_date), EXTRA(family), END
+};
+
+static const struct field_desc individual_fields[] = {
+  STR(individual, restriction_notice),
+  LIST(individual, name, personal_name), STR(individual, sex),
+  LIST(individual, event, event), LIST(individual, attribute, event),
+  LIST(individual, lds_individual_ordinance, lds_event),
+  LIST(individual, child_to_family, family_link),
+  LIST(individual, spouse_to_family, family_link),
+  LIST(individual, submitters, xref_list),
+  LIST(individual, association, association),
+  LIST(individual, alias, xref_list),
+  LIST(individual, ancestor_interest, xref_list),
+  LIST(individual, descendant_interest, xref_list),
+  LIST(individual, citation, source_citation),
+  LIST(individual, mm_link, multimedia_link),
+  LIST(individual, note, note_sub), STR(individual, record_file_nr),
+  STR(individual, ancestral_file_nr), LIST(individual, ref, user_ref_number),
+  STR(individual, record_id), SUB(individual, change_date, change_date),
+  EXTRA(individual), END
+};
+
+static const struct field_desc multimedia_fields[] = {
+  STR(multimedia, form), STR(multimedia, title),
+  LIST(multimedia, note, note_sub), STR(multimedia, data),
+  XREF(multimedia, continued), LIST(multimedia, ref, user_ref_number),
+  STR(multimedia, record_id), SUB(multimedia, change_date, change_date),
+  EXTRA(multimedia), END
+};
+
+static const struct field_desc note_fields[] = {
+  STR(note, text), LIST(note, citation, source_citation),
+  LIST(note, ref, user_ref_number), STR(note, record_id),
+  SUB(note, change_date, change_date), EXTRA(note), END
+};
+
+static const struct field_desc repository_fields[] = {
+  STR(repository, name), SUB(repository, address, address),
+  STR3(repository, phone), LIST(repository, note, note_sub),
+  LIST(repository, ref, user_ref_number), STR(repository, record_id),
+  SUB(repository, change_date, change_date), EXTRA(repository), END
+};
+
+static const struct field_desc source_fields[] = {
+  LIST(source, data.event, source_event), STR(source, data.agency),
+  LIST(source, data.note, note_sub), STR(source, author),
+  STR(source, title), STR(source, abbreviation), STR(source, publication),
+  STR(source, text), XREF(source, repository.link),
+  LIST(source, repository.note, note_sub),
+  LIST(source, repository.description, source_description),
+  LIST(source, mm_link, multimedia_link), LIST(source, note, note_sub),
+  LIST(source, ref, user_ref_number), STR(source, record_id),
+  SUB(source, change_date, change_date), EXTRA(source), END
+};
+
+static const struct field_desc submitter_fields[] = {
+  STR(submitter, name), SUB(submitter, address, address),
+  STR3(submitter, phone), LIST(submitter, mm_link, multimedia_link),
+  STR3(submitter, language), STR(submitter, record_file_nr),
+  STR(submitter, record_id), SUB(submitter, change_date, change_date),
+  EXTRA(submitter), END
+};
+
+static const struct field_desc user_rec_fields[] = {
+  STR(user_rec, tag), STR(user_rec, str_value), XREF(user_rec, xref_value),
+  EXTRA(user_rec), END
+};
+
+#define DESC(S)       { sizeof(struct S), 0, 0, S ## _fields }
+#define LIST_DESC(S)  { sizeof(struct S), offsetof(struct S, next), \
+                        offsetof(struct S, previous), S ## _fields }
+
+static const struct struct_desc descs[S_LAST] = {
+  LIST_DESC(user_data), DESC(address), LIST_DESC(text),
+  LIST_DESC(source_citation), LIST_DESC(note_sub), DESC(place),
+  LIST_DESC(multimedia_link), LIST_DESC(lds_event),
+  LIST_DESC(user_ref_number), DESC(change_date), LIST_DESC(event),
+  LIST_DESC(xref_list), LIST_DESC(personal_name), LIST_DESC(pedigree),
+  LIST_DESC(family_link), LIST_DESC(association), LIST_DESC(source_event),
+  LIST_DESC(source_description),
+  DESC(header), DESC(submission), LIST_DESC(family), LIST_DESC(individual),
+  LIST_DESC(multimedia), LIST_DESC(note), LIST_DESC(repository),
+  LIST_DESC(source), LIST_DESC(submitter), LIST_DESC(user_rec)
+};
+
+#define FIELD(OBJ, OFFSET, TYPE)  (*(TYPE*)((char*)(OBJ) + (OFFSET)))
+
+/* Writing */
+
+struct growbuf {
+  char*  data;
+  size_t used;
+  size_t size;
+};
+
+struct xref_entry {
+  struct xref_value* xref;   /* NULL if the slot is empty */
+  snap_word          index;
+};
+
+struct writer {
+  struct growbuf     data;
+  struct growbuf     pool;
+  struct growbuf     xref_table;
+  struct xref_entry* xrefs;
+  size_t             xrefs_mask;
+  snap_word          nr_of_xrefs;
+  int                error;
+};
+
+static void buf_add(struct writer* w, struct growbuf* buf,
+		    const void* data, size_t len)
+{
+  if (w->error)
+    return;
+  if (buf->used + len > buf->size) {
+    size_t new_size = buf->size ? buf->size : 65536;
+    char* new_data;
+    while (new_size < buf->used + len)
+      new_size *= 2;
+    new_data = (char*)realloc(buf->data, new_size);
+    if (!new_data) {
+      w->error = 1;
+      return;
+    }
+    buf->data = new_data;
+    buf->size = new_size;
+  }
+  memcpy(buf->data + buf->used, data, len);
+  buf->used += len;
+}
+
+static void put_word(struct writer* w, snap_word word)
+{
+  buf_add(w, &w->data, &word, sizeof(snap_word));
+}
+
+/* Adds a string to the pool and returns its offset plus 1 */
+static snap_word pool_string(struct writer* w, const char* str)
+{
+  size_t offset = w->pool.used;
+  if ((snap_word)(offset + 1) != offset + 1) {
+    w->error = 1;
+    return 0;
+  }
+  buf_add(w, &w->pool, str, strlen(str) + 1);
+  return (snap_word)(offset + 1);
+}
+
+static void put_string(struct writer* w, const char* str)
+{
+  put_word(w, str ? pool_string(w, str) : 0);
+}
+
+static void put_blob(struct writer* w, const void* data, size_t size)
+{
+  static const char padding[sizeof(snap_word)] = { 0 };
+  put_word(w, 1);
+  buf_add(w, &w->data, data, size);
+  buf_add(w, &w->data, padding,
+	  WORDS(size) * sizeof(snap_word) - size);
+}
+
+static size_t hash_ptr(const void* ptr)
+{
+  size_t h = (size_t)ptr;
+  h ^= h >> 16;
+  h *= 0x45d9f3bU;
+  h ^= h >> 16;
+  return h;
+}
+
+static int grow_xrefs(struct writer* w)
+{
+  size_t new_size = w->xrefs ? (w->xrefs_mask + 1) * 2 : 1024;
+  size_t new_mask = new_size - 1;
+  struct xref_entry* new_xrefs
+    = (struct xref_entry*)calloc(new_size, sizeof(struct xref_entry));
+  size_t i, j;
+
+  if (!new_xrefs)
+    return 0;
+  if (w->xrefs) {
+    for (i = 0; i <= w->xrefs_mask; i++) {
+      if (w->xrefs[i].xref) {
+	j = hash_ptr(w->xrefs[i].xref) & new_mask;
+	while (new_xrefs[j].xref)
+	  j = (j + 1) & new_mask;
+	new_xrefs[j] = w->xrefs[i];
+      }
+    }
+    free(w->xrefs);
+  }
+  w->xrefs      = new_xrefs;
+  w->xrefs_mask = new_mask;
+  return 1;
+}
+
+/* Returns the index plus 1 of the cross-reference, adding it to the table
+   if needed */
+static snap_word xref_index(struct writer* w, struct xref_value* xref)
+{
+  size_t i;
+
+  if (!xref || w->error)
+    return 0;
+  if ((!w->xrefs || (w->nr_of_xrefs + 1) * 2 > w->xrefs_mask + 1)
+      && !grow_xrefs(w)) {
+    w->error = 1;
+    return 0;
+  }
+  i = hash_ptr(xref) & w->xrefs_mask;
+  while (w->xrefs[i].xref && w->xrefs[i].xref != xref)
+    i = (i + 1) & w->xrefs_mask;
+  if (!w->xrefs[i].xref) {
+    snap_word entry[2];
+    entry[0] = (snap_word)xref->type;
+    entry[1] = pool_string(w, xref->string) - 1;
+    buf_add(w, &w->xref_table, entry, sizeof(entry));
+    w->xrefs[i].xref  = xref;
+    w->xrefs[i].index = w->nr_of_xrefs++;
+  }
+  return w->xrefs[i].index + 1;
+}
+
+static void put_struct(struct writer* w, struct_kind kind, const void* obj);
+
+static void put_list(struct writer* w, struct_kind kind, const void* first)
+{
+  const void* elt;
+  snap_word count = 0;
+  for (elt = first; elt; elt = FIELD(elt, descs[kind].next, void*))
+    count++;
+  put_word(w, count);
+  for (elt = first; elt; elt = FIELD(elt, descs[kind].next, void*))
+    put_struct(w, kind, elt);
+}
+
+static void put_struct(struct writer* w, struct_kind kind, const void* obj)
+{
+  const struct field_desc* f;
+  for (f = descs[kind].fields; f->kind != F_END && !w->error; f++) {
+    switch (f->kind) {
+      case F_STRING:
+	put_string(w, FIELD(obj, f->offset, char*));
+	break;
+      case F_INT:
+	put_word(w, (snap_word)FIELD(obj, f->offset, int));
+	break;
+      case F_XREF:
+	put_word(w, xref_index(w, FIELD(obj, f->offset, struct xref_value*)));
+	break;
+      case F_DATE:
+	if (FIELD(obj, f->offset, struct date_value*))
+	  put_blob(w, FIELD(obj, f->offset, struct date_value*),
+		   sizeof(struct date_value));
+	else
+	  put_word(w, 0);
+	break;
+      case F_AGE:
+	if (FIELD(obj, f->offset, struct age_value*))
+	  put_blob(w, FIELD(obj, f->offset, struct age_value*),
+		   sizeof(struct age_value));
+	else
+	  put_word(w, 0);
+	break;
+      case F_SUB:
+	if (FIELD(obj, f->offset, void*)) {
+	  put_word(w, 1);
+	  put_struct(w, f->sub, FIELD(obj, f->offset, void*));
+	}
+	else
+	  put_word(w, 0);
+	break;
+      case F_LIST:
+	put_list(w, f->sub, FIELD(obj, f->offset, void*));
+	break;
+      default:
+	break;
+    }
+  }
+}
+
+/* Writes a record: its own cross-reference, then its fields */
+static void put_record(struct writer* w, struct_kind kind, const void* obj,
+		       const char* xrefstr)
+{
+  snap_word index = 0;
+  if (xrefstr) {
+    index = xref_index(w, gedcom_get_by_xref(xrefstr));
+    if (!index && !w->error) {
+      gedcom_error(_("No cross-reference found for record '%s'"), xrefstr);
+      w->error = 2;
+    }
+  }
+  put_word(w, index);
+  put_struct(w, kind, obj);
+}
+
+#define PUT_RECORDS(W, STRUCTTYPE, FIRST)                                     \
+  {                                                                           \
+    struct STRUCTTYPE* rec;                                                   \
+    snap_word count = 0;                                                      \
+    for (rec = FIRST; rec; rec = rec->next)                                   \
+      count++;                                                                \
+    put_word(W, count);                                                       \
+    for (rec = FIRST; rec && !(W)->error; rec = rec->next)                    \
+      put_record(W, S_ ## STRUCTTYPE, rec, rec->xrefstr);                     \
+  }
+
+static int write_file(const char* file_name, struct writer* w)
+{
+  struct snapshot_header header;
+  FILE* file;
+  int result = 1;
+
+  memset(&header, 0, sizeof(header));
+  strcpy(header.magic, SNAPSHOT_MAGIC);
+  header.version     = SNAPSHOT_VERSION;
+  header.byte_order  = SNAPSHOT_BYTE_ORDER;
+  header.word_size   = sizeof(snap_word);
+  header.date_size   = sizeof(struct date_value);
+  header.age_size    = sizeof(struct age_value);
+  header.nr_of_xrefs = w->nr_of_xrefs;
+  header.pool_size   = (snap_word)(w->pool.used);
+  header.nr_of_words = (snap_word)(w->data.used / sizeof(snap_word));
+
+  file = fopen(file_name, "wb");
+  if (!file) {
+    gedcom_error(_("Could not open file '%s': %s"), file_name,
+		 strerror(errno));
+    return 1;
+  }
+  if (fwrite(&header, sizeof(header), 1, file) == 1
+      && fwrite(w->xref_table.data, 1, w->xref_table.used, file)
+         == w->xref_table.used
+      && fwrite(w->pool.data, 1, w->pool.used, file) == w->pool.used
+      && fwrite(w->data.data, 1, w->data.used, file) == w->data.used)
+    result = 0;
+  if (fclose(file) != 0)
+    result = 1;
+  if (result)
+    gedcom_error(_("Error writing to file '%s': %s"), file_name,
+		 strerror(errno));
+  return result;
+}
+
+/* Saves the current model to the given file; returns 0 on success */
+int write_snapshot(const char* file_name)
+{
+  static const char padding[sizeof(snap_word)] = { 0 };
+  struct writer w;
+  int result = 1;
+
+  memset(&w, 0, sizeof(w));
+  put_struct(&w, S_header, gom_get_header());
+  if (gom_get_submission()) {
+    put_word(&w, 1);
+    put_record(&w, S_submission, gom_get_submission(),
+	       gom_get_submission()->xrefstr);
+  }
+  else
+    put_word(&w, 0);
+  PUT_RECORDS(&w, family, gom_get_first_family());
+  PUT_RECORDS(&w, individual, gom_get_first_individual());
+  PUT_RECORDS(&w, multimedia, gom_get_first_multimedia());
+  PUT_RECORDS(&w, note, gom_get_first_note());
+  PUT_RECORDS(&w, repository, gom_get_first_repository());
+  PUT_RECORDS(&w, source, gom_get_first_source());
+  PUT_RECORDS(&w, submitter, gom_get_first_submitter());
+  PUT_RECORDS(&w, user_rec, gom_get_first_user_rec());
+  /* Keep the data aligned on words */
+  buf_add(&w, &w.pool, padding,
+	  WORDS(w.pool.used) * sizeof(snap_word) - w.pool.used);
+
+  if (w.error == 1)
+    MEMORY_ERROR;
+  else if (!w.error)
+    result = write_file(file_name, &w);
+
+  free(w.data.data);
+  free(w.pool.data);
+  free(w.xref_table.data);
+  free(w.xrefs);
+  return result;
+}
+
+/* Reading */
+
+struct reader {
+  const snap_word*    pos;
+  const snap_word*    end;
+  const char*         pool;
+  size_t              pool_size;
+  struct xref_value** xrefs;
+  snap_word           nr_of_xrefs;
+  int                 copy_values;
+  int                 depth;
+  int                 error;
+};
+
+static snap_word get_word(struct reader* r)
+{
+  if (r->pos < r->end)
+    return *r->pos++;
+  r->error = 1;
+  return 0;
+}
+
+static char* get_string(struct reader* r)
+{
+  snap_word offset = get_word(r);
+  if (!offset)
+    return NULL;
+  else if (offset > r->pool_size) {
+    r->error = 1;
+    return NULL;
+  }
+  else
+    return (char*)r->pool + offset - 1;
+}
+
+static struct xref_value* get_xref(struct reader* r)
+{
+  snap_word index = get_word(r);
+  struct xref_value* xr;
+  if (!index)
+    return NULL;
+  else if (index > r->nr_of_xrefs) {
+    r->error = 1;
+    return NULL;
+  }
+  xr = r->xrefs[index - 1];
+  if (!gedcom_link_xref(xr->type, xr->string))
+    r->error = 1;
+  return xr;
+}
+
+/* Returns a pointer to the native struct in the data (or a copy of it, if
+   the data is not aligned well enough for the struct) */
+static void* get_blob(struct reader* r, size_t size, int is_date)
+{
+  const snap_word* start;
+  if (!get_word(r))
+    return NULL;
+  start = r->pos;
+  if ((size_t)(r->end - r->pos) < WORDS(size)) {
+    r->error = 1;
+    return NULL;
+  }
+  r->pos += WORDS(size);
+  if (r->copy_values) {
+    void* copy = (is_date ?
+		  (void*)gom_new_date_value((const struct date_value*)start) :
+		  (void*)gom_new_age_value((const struct age_value*)start));
+    if (!copy)
+      r->error = 2;
+    return copy;
+  }
+  return (void*)start;
+}
+
+static int get_struct(struct reader* r, struct_kind kind, void* obj);
+
+static void* get_list(struct reader* r, struct_kind kind)
+{
+  const struct struct_desc* d = &descs[kind];
+  snap_word count = get_word(r);
+  void *first = NULL, *last = NULL;
+
+  while (count-- > 0 && !r->error) {
+    void* elt = gom_alloc(d->size);
+    if (!elt) {
+      r->error = 2;
+      break;
+    }
+    /* Link like LINK_CHAIN_ELT does: the previous of the first element is
+       the last element */
+    FIELD(elt, d->next, void*) = NULL;
+    if (!first) {
+      FIELD(elt, d->previous, void*) = elt;
+      first = elt;
+    }
+    else {
+      FIELD(last, d->next, void*)     = elt;
+      FIELD(elt, d->previous, void*)  = last;
+      FIELD(first, d->previous, void*) = elt;
+    }
+    last = elt;
+    get_struct(r, kind, elt);
+  }
+  return first;
+}
+
+static int get_struct(struct reader* r, struct_kind kind, void* obj)
+{
+  const struct field_desc* f;
+
+  if (++r->depth > MAX_NESTING)
+    r->error = 1;
+  for (f = descs[kind].fields; f->kind != F_END && !r->error; f++) {
+    switch (f->kind) {
+      case F_STRING:
+	FIELD(obj, f->offset, char*) = get_string(r);
+	break;
+      case F_INT:
+	FIELD(obj, f->offset, int) = (int)get_word(r);
+	break;
+      case F_XREF:
+	FIELD(obj, f->offset, struct xref_value*) = get_xref(r);
+	break;
+      case F_DATE:
+	FIELD(obj, f->offset, struct date_value*)
+	  = (struct date_value*)get_blob(r, sizeof(struct date_value), 1);
+	break;
+      case F_AGE:
+	FIELD(obj, f->offset, struct age_value*)
+	  = (struct age_value*)get_blob(r, sizeof(struct age_value), 0);
+	break;
+      case F_SUB:
+	FIELD(obj, f->offset, void*) = NULL;
+	if (get_word(r)) {
+	  void* sub = gom_alloc(descs[f->sub].size);
+	  if (!sub)
+	    r->error = 2;
+	  else {
+	    FIELD(obj, f->offset, void*) = sub;
+	    get_struct(r, f->sub, sub);
+	  }
+	}
+	break;
+      case F_LIST:
+	FIELD(obj, f->offset, void*) = get_list(r, f->sub);
+	break;
+      default:
+	break;
+    }
+  }
+  r->depth--;
+  return !r->error;
+}
+
+/* Reads the cross-reference of a record, and makes the record via the
+   given function */
+static void* get_record(struct reader* r, struct_kind kind,
+			void* (*make)(const char*))
+{
+  snap_word index = get_word(r);
+  struct xref_value* xr = NULL;
+  void* obj;
+
+  /* Only user records can be made without cross-reference */
+  if (index > r->nr_of_xrefs || (!index && kind != S_user_rec)) {
+    r->error = 1;
+    return NULL;
+  }
+  if (index)
+    xr = r->xrefs[index - 1];
+  obj = make(xr ? xr->string : NULL);
+  if (!obj) {
+    r->error = 2;
+    return NULL;
+  }
+  if (xr)
+    xr->object = (Gedcom_ctxt)obj;
+  get_struct(r, kind, obj);
+  return obj;
+}
+
+#define DEFINE_SNAPSHOT_MAKEFUNC(STRUCTTYPE)                                  \
+  static void* snapshot_make_ ## STRUCTTYPE(const char* xrefstr)              \
+  {                                                                           \
+    return MAKEFUNC(STRUCTTYPE)(xrefstr);                                     \
+  }
+
+DEFINE_SNAPSHOT_MAKEFUNC(submission)
+DEFINE_SNAPSHOT_MAKEFUNC(family)
+DEFINE_SNAPSHOT_MAKEFUNC(individual)
+DEFINE_SNAPSHOT_MAKEFUNC(multimedia)
+DEFINE_SNAPSHOT_MAKEFUNC(note)
+DEFINE_SNAPSHOT_MAKEFUNC(repository)
+DEFINE_SNAPSHOT_MAKEFUNC(source)
+DEFINE_SNAPSHOT_MAKEFUNC(submitter)
+DEFINE_SNAPSHOT_MAKEFUNC(user_rec)
+
+#define GET_RECORDS(R, STRUCTTYPE)                                            \
+  {                                                                           \
+    snap_word count = get_word(R);                                            \
+    while (count-- > 0 && !(R)->error)                                        \
+      get_record(R, S_ ## STRUCTTYPE, snapshot_make_ ## STRUCTTYPE);          \
+  }
+
+static int check_header(const struct snapshot_header* header, size_t size)
+{
+  size_t total;
+  if (size < sizeof(struct snapshot_header)
+      || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+      || header->version != SNAPSHOT_VERSION
+      || header->byte_order != SNAPSHOT_BYTE_ORDER
+      || header->word_size != sizeof(snap_word)
+      || header->date_size != sizeof(struct date_value)
+      || header->age_size != sizeof(struct age_value)
+      || header->pool_size % sizeof(snap_word) != 0)
+    return 0;
+  total = sizeof(struct snapshot_header)
+    + (size_t)header->nr_of_xrefs * 2 * sizeof(snap_word)
+    + header->pool_size
+    + (size_t)header->nr_of_words * sizeof(snap_word);
+  return total == size;
+}
+
+static int read_data(const char* file_name, const char* data, size_t size)
+{
+  const struct snapshot_header* header = (const struct snapshot_header*)data;
+  const snap_word* xref_table;
+  struct reader r;
+  snap_word i;
+  struct align_check { char c; struct date_value dv; struct age_value av; };
+
+  if (!check_header(header, size)) {
+    gedcom_error(_("File '%s' is not a snapshot of this version of the library"),
+		 file_name);
+    return 1;
+  }
+
+  memset(&r, 0, sizeof(r));
+  xref_table  = (const snap_word*)(data + sizeof(struct snapshot_header));
+  r.pool      = (const char*)(xref_table + 2 * (size_t)header->nr_of_xrefs);
+  r.pool_size = header->pool_size;
+  r.pos       = (const snap_word*)(r.pool + r.pool_size);
+  r.end       = r.pos + header->nr_of_words;
+  r.copy_values = (offsetof(struct align_check, dv) > sizeof(snap_word));
+  r.nr_of_xrefs = header->nr_of_xrefs;
+
+  /* All strings must be terminated within the pool */
+  if (r.pool_size > 0 && r.pool[r.pool_size - 1] != '\0')
+    r.error = 1;
+
+  /* The cross-references of the snapshot replace those of the last parse */
+  gedcom_clear_xrefs();
+  r.xrefs = (struct xref_value**)calloc(header->nr_of_xrefs + 1,
+					sizeof(struct xref_value*));
+  if (!r.xrefs)
+    r.error = 2;
+  for (i = 0; i < header->nr_of_xrefs && !r.error; i++) {
+    if (xref_table[2*i+1] >= r.pool_size)
+      r.error = 1;
+    else {
+      r.xrefs[i] = gedcom_add_xref((Xref_type)xref_table[2*i],
+				   r.pool + xref_table[2*i+1], NULL);
+      if (!r.xrefs[i])
+	r.error = 1;
+    }
+  }
+
+  if (!r.error)
+    get_struct(&r, S_header, gom_get_header());
+  if (!r.error && get_word(&r))
+    get_record(&r, S_submission, snapshot_make_submission);
+  GET_RECORDS(&r, family);
+  GET_RECORDS(&r, individual);
+  GET_RECORDS(&r, multimedia);
+  GET_RECORDS(&r, note);
+  GET_RECORDS(&r, repository);
+  GET_RECORDS(&r, source);
+  GET_RECORDS(&r, submitter);
+  GET_RECORDS(&r, user_rec);
+  if (!r.error && r.pos != r.end)
+    r.error = 1;
+
+  free(r.xrefs);
+  if (r.error == 2)
+    MEMORY_ERROR;
+  else if (r.error)
+    gedcom_error(_("Snapshot file '%s' is corrupt"), file_name);
+  return r.error ? 1 : 0;
+}
+
+/* Loads the model from the given file into the current (empty) model; the
+   model must be in arena mode.  Returns 0 on success */
+int read_snapshot(const char* file_name)
+{
+  struct stat st;
+  char* data = NULL;
+  int adopted = ADOPT_MALLOC;
+  FILE* file = fopen(file_name, "rb");
+
+  if (!file) {
+    gedcom_error(_("Could not open file '%s': %s"), file_name,
+		 strerror(errno));
+    return 1;
+  }
+  if (fstat(fileno(file), &st) != 0 || st.st_size <= 0) {
+    gedcom_error(_("File '%s' is not a snapshot of this version of the library"),
+		 file_name);
+    fclose(file);
+    return 1;
+  }
+
+#ifdef HAVE_MMAP
+  /* Private and writable, so that the application can modify the strings
+     and dates in place, as in a parsed model */
+  data = (char*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		     fileno(file), 0);
+  if (data == (char*)MAP_FAILED)
+    data = NULL;
+  else
+    adopted = ADOPT_MAPPED;
+#endif
+  if (!data) {
+    data = (char*)malloc(st.st_size);
+    if (!data) {
+      MEMORY_ERROR;
+      fclose(file);
+      return 1;
+    }
+    if (fread(data, 1, st.st_size, file) != (size_t)st.st_size) {
+      gedcom_error(_("Error reading from input file: %s"), strerror(errno));
+      free(data);
+      fclose(file);
+      return 1;
+    }
+  }
+  fclose(file);
+
+  if (!gom_adopt_memory(data, st.st_size, adopted)) {
+    MEMORY_ERROR;
+#ifdef HAVE_MMAP
+    if (adopted == ADOPT_MAPPED)
+      munmap(data, st.st_size);
+    else
+#endif
+      free(data);
+    return 1;
+  }
+  return read_data(file_name, data, st.st_size);
+}
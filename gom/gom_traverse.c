@@ -0,0 +1,533 @@
+/* Traversal of ancestors and descendants in the gedcom object model.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#include "gom.h"
+#include "gom_internal.h"
+#include <limits.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
+/* All traversals work on the family graph (gom_graph.c).  Every walk keeps
+   a bitset of the individuals it has seen, indexed on their id, so that
+   each individual is visited only once, also when it can be reached in
+   several ways (pedigree collapse) or when the data contains cycles.
+
+   The individuals that are seen are appended to an array of entries,
+   which is the queue for breadth-first walks; depth-first walks keep a
+   separate stack of entry indexes.  The entries are never removed from the
+   array, so that after the walk the bits can be cleared again via the
+   array (which is cheaper than clearing the whole bitset when one walk is
+   done per individual), and so that the path to an entry can be followed
+   back via 'from'.
+
+   A depth-first walk with a maximum number of generations can reach an
+   individual first via a long path, and only later via a shorter one,
+   which brings more of its relatives within the limit.  Such walks keep
+   the smallest generation per individual in 'best', and add a new entry
+   each time a shorter path is found, so that the relatives are visited
+   again; the bitset then marks the individuals that were already given to
+   the callback.
+*/
+
+#define BITS_PER_WORD   (8 * sizeof(unsigned long))
+#define BIT_WORD(ID)    ((ID) / BITS_PER_WORD)
+#define BIT_MASK(ID)    (1UL << ((ID) % BITS_PER_WORD))
+
+struct walk_entry {
+  int id;
+  int generation;
+  int from;               /* index of the entry it was reached from */
+};
+
+struct walk {
+  const struct family_graph* graph;
+  unsigned long*     seen;
+  struct walk_entry* entries;
+  int                nr_of_entries;
+  int                max_entries;
+  int*               stack;
+  int                stack_size;
+  int                max_stack;
+  int*               best;        /* NULL, except in limited depth-first
+				     walks */
+};
+
+static int init_walk(struct walk* w, const struct family_graph* graph)
+{
+  size_t words = graph->nr_of_individuals / BITS_PER_WORD + 1;
+  w->graph   = graph;
+  w->seen    = (unsigned long*)calloc(words, sizeof(unsigned long));
+  w->max_entries   = 256;
+  w->nr_of_entries = 0;
+  w->entries
+    = (struct walk_entry*)malloc(w->max_entries * sizeof(struct walk_entry));
+  w->stack      = NULL;
+  w->stack_size = 0;
+  w->max_stack  = 0;
+  w->best       = NULL;
+  return (w->seen && w->entries);
+}
+
+static void free_walk(struct walk* w)
+{
+  free(w->seen);
+  free(w->entries);
+  free(w->stack);
+  free(w->best);
+  w->seen    = NULL;
+  w->entries = NULL;
+  w->stack   = NULL;
+  w->best    = NULL;
+}
+
+static int init_best(struct walk* w)
+{
+  int i;
+  w->best = (int*)malloc(w->graph->nr_of_individuals * sizeof(int));
+  if (!w->best)
+    return 0;
+  for (i = 0; i < w->graph->nr_of_individuals; i++)
+    w->best[i] = INT_MAX;
+  return 1;
+}
+
+static int push_stack(struct walk* w, int index)
+{
+  if (w->stack_size == w->max_stack) {
+    int new_max = w->max_stack ? w->max_stack * 2 : 256;
+    int* new_stack = (int*)realloc(w->stack, new_max * sizeof(int));
+    if (!new_stack)
+      return 0;
+    w->stack     = new_stack;
+    w->max_stack = new_max;
+  }
+  w->stack[w->stack_size++] = index;
+  return 1;
+}
+
+/* Clears the bits of the entries, so that the walk can be reused */
+static void reset_walk(struct walk* w)
+{
+  int i;
+  for (i = 0; i < w->nr_of_entries; i++) {
+    int id = w->entries[i].id;
+    w->seen[BIT_WORD(id)] &= ~BIT_MASK(id);
+    if (w->best)
+      w->best[id] = INT_MAX;
+  }
+  w->nr_of_entries = 0;
+}
+
+/* Appends an entry; returns 0 on memory errors */
+static int append_entry(struct walk* w, int id, int generation, int from)
+{
+  struct walk_entry* e;
+  if (w->nr_of_entries == w->max_entries) {
+    int new_max = w->max_entries * 2;
+    struct walk_entry* new_entries
+      = (struct walk_entry*)realloc(w->entries,
+				    new_max * sizeof(struct walk_entry));
+    if (!new_entries)
+      return 0;
+    w->entries     = new_entries;
+    w->max_entries = new_max;
+  }
+  e = &w->entries[w->nr_of_entries++];
+  e->id         = id;
+  e->generation = generation;
+  e->from       = from;
+  return 1;
+}
+
+/* Adds an entry if the individual wasn't seen yet; in limited depth-first
+   walks, adds an entry if the individual wasn't reached yet via a path of
+   the same length or shorter.  Returns 0 on memory errors */
+static int push_entry(struct walk* w, int id, int generation, int from)
+{
+  if (w->best) {
+    if (w->best[id] <= generation)
+      return 1;
+    w->best[id] = generation;
+  }
+  else if (w->seen[BIT_WORD(id)] & BIT_MASK(id))
+    return 1;
+  else
+    w->seen[BIT_WORD(id)] |= BIT_MASK(id);
+  return append_entry(w, id, generation, from);
+}
+
+/* Returns the relatives of an individual in the given direction */
+static void get_relatives(const struct family_graph* g, Gom_traverse_dir dir,
+			  int id, const int** ids, const unsigned char** peds,
+			  int* nr)
+{
+  if (dir == TRAVERSE_ANCESTORS) {
+    *ids  = g->parents + g->parents_start[id];
+    *peds = g->parents_pedigree + g->parents_start[id];
+    *nr   = g->parents_start[id + 1] - g->parents_start[id];
+  }
+  else {
+    *ids  = g->children + g->children_start[id];
+    *peds = g->children_pedigree + g->children_start[id];
+    *nr   = g->children_start[id + 1] - g->children_start[id];
+  }
+}
+
+/* Adds entries for the relatives of the given entry, via push_entry */
+static int push_relatives(struct walk* w, Gom_traverse_dir dir,
+			  int pedigree_mask, int index)
+{
+  const int* ids;
+  const unsigned char* peds;
+  int nr, k;
+  int generation = w->entries[index].generation + 1;
+
+  get_relatives(w->graph, dir, w->entries[index].id, &ids, &peds, &nr);
+  for (k = 0; k < nr; k++) {
+    if ((peds[k] & pedigree_mask)
+	&& !push_entry(w, ids[k], generation, index))
+      return 0;
+  }
+  return 1;
+}
+
+/* Walks from the given individual; returns the number of individuals
+   visited (including the start), or -1 on memory errors.  The callback
+   may be NULL */
+static int do_walk(struct walk* w, int start, Gom_traverse_dir dir,
+		   Gom_traverse_order order, int max_generations,
+		   int pedigree_mask, Gom_traverse_cb cb, void* data)
+{
+  int visited = 0;
+  int next    = 0;
+
+  if (order == TRAVERSE_DEPTH_FIRST && max_generations >= 0
+      && !w->best && !init_best(w))
+    return -1;
+  if (!push_entry(w, start, 0, -1))
+    return -1;
+
+  if (order == TRAVERSE_DEPTH_FIRST) {
+    w->stack_size = 0;
+    if (!push_stack(w, 0))
+      return -1;
+    while (w->stack_size > 0) {
+      int index = w->stack[--w->stack_size];
+      struct walk_entry e = w->entries[index];
+      int first_time = 1;
+      if (w->best) {
+	/* Skip the entry if a shorter path was found in the meantime; the
+	   callback is only called on the first entry of an individual */
+	if (e.generation > w->best[e.id])
+	  continue;
+	first_time = !(w->seen[BIT_WORD(e.id)] & BIT_MASK(e.id));
+	w->seen[BIT_WORD(e.id)] |= BIT_MASK(e.id);
+      }
+      if (first_time) {
+	visited++;
+	if (cb && cb(w->graph->individuals[e.id], e.id, e.generation, data))
+	  break;
+      }
+      if (max_generations < 0 || e.generation < max_generations) {
+	/* Push the new entries in reverse order, so that the relatives are
+	   visited in their normal order */
+	int first = w->nr_of_entries, k;
+	if (!push_relatives(w, dir, pedigree_mask, index))
+	  return -1;
+	for (k = w->nr_of_entries - 1; k >= first; k--)
+	  if (!push_stack(w, k))
+	    return -1;
+      }
+    }
+  }
+  else {
+    while (next < w->nr_of_entries) {
+      int index = next++;
+      struct walk_entry e = w->entries[index];
+      visited++;
+      if (cb && cb(w->graph->individuals[e.id], e.id, e.generation, data))
+	break;
+      if ((max_generations < 0 || e.generation < max_generations)
+	  && !push_relatives(w, dir, pedigree_mask, index))
+	return -1;
+    }
+  }
+  return visited;
+}
+
+/** This function visits the ancestors or the descendants of an individual,
+    in breadth-first or depth-first order.  The relations are taken from the
+    family graph (see \ref gom_get_family_graph()).
+
+    Each individual is visited only once, also if it can be reached in
+    several ways (e.g. when cousins married) or if the data contains cycles.
+    In breadth-first order, the generation passed to the callback is the
+    smallest distance to the start; in depth-first order, it is the distance
+    via the first path that was found.  Both orders visit the same
+    individuals, also with a maximum number of generations: an individual
+    that is within the limit via some path is visited, even if the
+    depth-first walk reached it first via a longer path.
+
+    \param start  The individual to start from; it is visited first, with
+    generation 0
+    \param dir  TRAVERSE_ANCESTORS or TRAVERSE_DESCENDANTS
+    \param order  TRAVERSE_BREADTH_FIRST or TRAVERSE_DEPTH_FIRST
+    \param max_generations  The maximum number of generations to go up or
+    down, or -1 for no limit
+    \param pedigree_mask  The pedigree linkage types of the parent-child
+    relations to follow (e.g. PEDIGREE_BIRTH, or PEDIGREE_ANY)
+    \param cb  The function to call for each individual; if it returns
+    nonzero, the traversal stops
+    \param data  Passed to the callback
+
+    \return The number of individuals visited, or -1 in case of errors (e.g.
+    the individual is not part of the model)
+*/
+int gom_traverse(struct individual* start, Gom_traverse_dir dir,
+		 Gom_traverse_order order, int max_generations,
+		 int pedigree_mask, Gom_traverse_cb cb, void* data)
+{
+  const struct family_graph* graph = gom_get_family_graph();
+  struct walk w;
+  int id, result;
+
+  if (!graph)
+    return -1;
+  id = gom_get_individual_id(start);
+  if (id < 0) {
+    gedcom_error(_("Individual not found in the object model"));
+    return -1;
+  }
+  if (!init_walk(&w, graph)) {
+    MEMORY_ERROR;
+    free_walk(&w);
+    return -1;
+  }
+  result = do_walk(&w, id, dir, order, max_generations, pedigree_mask,
+		   cb, data);
+  if (result < 0)
+    MEMORY_ERROR;
+  free_walk(&w);
+  return result;
+}
+
+/** This function finds a shortest path between two individuals via
+    parent-child relations (in both directions), i.e. via their closest
+    common ancestor or descendant.  Marriages are not followed.
+
+    \param from  The first individual
+    \param to  The second individual
+    \param max_length  The maximum number of steps in the path, or -1 for
+    no limit
+    \param pedigree_mask  The pedigree linkage types of the parent-child
+    relations to follow
+    \param path  On success, this is set to a newly allocated array with the
+    ids (see \ref gom_get_individual_id()) of the individuals on the path,
+    starting with \c from and ending with \c to; the application must free
+    it with free()
+
+    \return The number of individuals in the path, 0 if there is no such
+    path (in which case \c path is set to \c NULL), or -1 in case of
+    errors
+*/
+int gom_get_relationship_path(struct individual* from, struct individual* to,
+			      int max_length, int pedigree_mask, int** path)
+{
+  const struct family_graph* graph = gom_get_family_graph();
+  struct walk w;
+  int from_id, to_id, next = 0, found = -1, result = 0;
+
+  if (!path)
+    return -1;
+  *path = NULL;
+  if (!graph)
+    return -1;
+  from_id = gom_get_individual_id(from);
+  to_id   = gom_get_individual_id(to);
+  if (from_id < 0 || to_id < 0) {
+    gedcom_error(_("Individual not found in the object model"));
+    return -1;
+  }
+  if (!init_walk(&w, graph) || !push_entry(&w, from_id, 0, -1)) {
+    MEMORY_ERROR;
+    free_walk(&w);
+    return -1;
+  }
+
+  while (next < w.nr_of_entries) {
+    int index = next++;
+    if (w.entries[index].id == to_id) {
+      found = index;
+      break;
+    }
+    if (max_length < 0 || w.entries[index].generation < max_length) {
+      if (!push_relatives(&w, TRAVERSE_ANCESTORS, pedigree_mask, index)
+	  || !push_relatives(&w, TRAVERSE_DESCENDANTS, pedigree_mask, index)) {
+	MEMORY_ERROR;
+	result = -1;
+	break;
+      }
+    }
+  }
+
+  if (found >= 0) {
+    int length = w.entries[found].generation + 1;
+    int* ids = (int*)malloc(length * sizeof(int));
+    if (!ids) {
+      MEMORY_ERROR;
+      result = -1;
+    }
+    else {
+      int index, pos = length;
+      for (index = found; index >= 0; index = w.entries[index].from)
+	ids[--pos] = w.entries[index].id;
+      *path  = ids;
+      result = length;
+    }
+  }
+  free_walk(&w);
+  return result;
+}
+
+struct count_job {
+  const struct family_graph* graph;
+  Gom_traverse_dir dir;
+  int   max_generations;
+  int   pedigree_mask;
+  int*  counts;
+  int   first;
+  int   step;
+  int   failed;
+};
+
+static void* run_count_job(void* arg)
+{
+  struct count_job* job = (struct count_job*)arg;
+  struct walk w;
+  int id;
+
+  if (!init_walk(&w, job->graph))
+    job->failed = 1;
+  else {
+    for (id = job->first; id < job->graph->nr_of_individuals;
+	 id += job->step) {
+      int visited = do_walk(&w, id, job->dir, TRAVERSE_BREADTH_FIRST,
+			    job->max_generations, job->pedigree_mask,
+			    NULL, NULL);
+      if (visited < 0) {
+	job->failed = 1;
+	break;
+      }
+      job->counts[id] = visited - 1;
+      reset_walk(&w);
+    }
+  }
+  free_walk(&w);
+  return NULL;
+}
+
+/** This function counts the ancestors or descendants of every individual
+    in the model, e.g. for statistics over a whole tree.  The individuals
+    can be divided over several threads.
+
+    \param dir  TRAVERSE_ANCESTORS or TRAVERSE_DESCENDANTS
+    \param max_generations  The maximum number of generations to go up or
+    down, or -1 for no limit
+    \param pedigree_mask  The pedigree linkage types of the parent-child
+    relations to follow
+    \param nr_of_threads  The number of threads to use (values smaller than
+    2, or no thread support in the library, mean that the counting is done
+    in the calling thread)
+    \param counts  An array with room for the number of individuals in the
+    family graph (see \ref gom_get_family_graph()); on success, the entry
+    for each individual id is set to its number of distinct ancestors or
+    descendants (not counting the individual itself)
+
+    \retval 0 on success
+    \retval 1 in case of errors
+*/
+int gom_count_relatives(Gom_traverse_dir dir, int max_generations,
+			int pedigree_mask, int nr_of_threads, int* counts)
+{
+  const struct family_graph* graph = gom_get_family_graph();
+  struct count_job* jobs;
+  int i, result = 0;
+
+  if (!graph || !counts)
+    return 1;
+  if (nr_of_threads < 1)
+    nr_of_threads = 1;
+  if (nr_of_threads > graph->nr_of_individuals)
+    nr_of_threads = (graph->nr_of_individuals ? graph->nr_of_individuals : 1);
+
+  jobs = (struct count_job*)calloc(nr_of_threads, sizeof(struct count_job));
+  if (!jobs) {
+    MEMORY_ERROR;
+    return 1;
+  }
+  for (i = 0; i < nr_of_threads; i++) {
+    jobs[i].graph           = graph;
+    jobs[i].dir             = dir;
+    jobs[i].max_generations = max_generations;
+    jobs[i].pedigree_mask   = pedigree_mask;
+    jobs[i].counts          = counts;
+    jobs[i].first           = i;
+    jobs[i].step            = nr_of_threads;
+  }
+
+#ifdef HAVE_LIBPTHREAD
+  if (nr_of_threads > 1) {
+    /* The graph is only read, and each job has its own walk; the jobs take
+       the individuals in turn, so that big and small families are spread
+       over the threads */
+    pthread_t* threads
+      = (pthread_t*)calloc(nr_of_threads, sizeof(pthread_t));
+    int started = 0;
+    if (threads) {
+      for (started = 0; started < nr_of_threads - 1; started++)
+	if (pthread_create(&threads[started], NULL, run_count_job,
+			   &jobs[started + 1]) != 0)
+	  break;
+    }
+    /* The calling thread does the first job, and the jobs for which no
+       thread could be started */
+    run_count_job(&jobs[0]);
+    for (i = started + 1; i < nr_of_threads; i++)
+      run_count_job(&jobs[i]);
+    for (i = 0; i < started; i++)
+      pthread_join(threads[i], NULL);
+    free(threads);
+  }
+  else
+#endif
+    for (i = 0; i < nr_of_threads; i++)
+      run_count_job(&jobs[i]);
+
+  for (i = 0; i < nr_of_threads; i++)
+    if (jobs[i].failed)
+      result = 1;
+  if (result)
+    MEMORY_ERROR;
+  free(jobs);
+  return result;
+}
@@ -91,7 +91,7 @@ void header_add_phone(Gom_ctxt ctxt, const char* phone)
     int i = 0;
     while (i<2 && corp->phone[i]) i++;
     if (! corp->phone[i]) {
-      corp->phone[i] = strdup(phone);
+      corp->phone[i] = gom_strdup(phone);
       if (! corp->phone[i]) MEMORY_ERROR;
     }
   }
@@ -143,6 +143,7 @@ void header_cleanup()
   SAFE_FREE(gom_header.source.version);
   SAFE_FREE(gom_header.source.corporation.name);
   CLEANFUNC(address)(gom_header.source.corporation.address);
+  gom_header.source.corporation.address = NULL;
   SAFE_FREE(gom_header.source.corporation.phone[0]);
   SAFE_FREE(gom_header.source.corporation.phone[1]);
   SAFE_FREE(gom_header.source.corporation.phone[2]);
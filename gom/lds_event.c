@@ -44,10 +44,10 @@ Gedcom_ctxt sub_lds_event_start(_ELT_PARAMS_)
     struct lds_event *lds_evt = SUB_MAKEFUNC(lds_event)();
     if (lds_evt) {
       lds_evt->event = parsed_tag;
-      lds_evt->event_name = strdup(tag);
+      lds_evt->event_name = gom_strdup(tag);
       if (! lds_evt->event_name) {
 	MEMORY_ERROR;
-	free(lds_evt);
+	gom_free(lds_evt);
       }
       else {
 	int type = ctxt_type(ctxt);
@@ -121,7 +121,7 @@ void sub_note_end(_ELT_END_PARAMS_)
       struct note_sub *obj = SAFE_CTXT_CAST(note_sub, ctxt);
       if (obj) {
 	char *str = GEDCOM_STRING(parsed_value);
-	char *newvalue = strdup(str);
+	char *newvalue = gom_strdup(str);
 	if (! newvalue)
 	  MEMORY_ERROR;
 	else
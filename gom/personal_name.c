@@ -40,11 +40,11 @@ Gedcom_ctxt sub_name_start(_ELT_PARAMS_)
   if (ctxt) {
     struct personal_name *name = SUB_MAKEFUNC(personal_name)();
     if (name) {
-      name->name = strdup(GEDCOM_STRING(parsed_value));
+      name->name = gom_strdup(GEDCOM_STRING(parsed_value));
 
       if (! name->name) {
 	MEMORY_ERROR;
-	free(name);
+	gom_free(name);
       }
       else {
 	int type = ctxt_type(ctxt);
@@ -43,11 +43,11 @@ Gedcom_ctxt sub_place_start(_ELT_PARAMS_)
   else {
     struct place *place = SUB_MAKEFUNC(place)();
     if (place) {
-      place->value = strdup(GEDCOM_STRING(parsed_value));
+      place->value = gom_strdup(GEDCOM_STRING(parsed_value));
       
       if (!place->value) {
 	MEMORY_ERROR;
-	free(place);
+	gom_free(place);
       }
       else {
 	int type = ctxt_type(ctxt);
@@ -102,7 +102,7 @@ void sub_citation_end(_ELT_END_PARAMS_)
       struct source_citation *cit = SAFE_CTXT_CAST(source_citation, ctxt);
       if (cit) {
 	char *str = GEDCOM_STRING(parsed_value);
-	char *newvalue = strdup(str);
+	char *newvalue = gom_strdup(str);
 	if (! newvalue)
 	  MEMORY_ERROR;
 	else
@@ -40,11 +40,11 @@ Gedcom_ctxt sub_sour_caln_start(_ELT_PARAMS_)
   else {
     struct source_description *desc = SUB_MAKEFUNC(source_description)();
     if (desc) {
-      desc->call_number = strdup(GEDCOM_STRING(parsed_value));
+      desc->call_number = gom_strdup(GEDCOM_STRING(parsed_value));
 
       if (! desc->call_number) {
 	MEMORY_ERROR;
-	free(desc);
+	gom_free(desc);
       }
       else {
 	int type = ctxt_type(ctxt);
@@ -40,11 +40,11 @@ Gedcom_ctxt sub_sour_even_start(_ELT_PARAMS_)
   else {
     struct source_event *evt = SUB_MAKEFUNC(source_event)();
     if (evt) {
-      evt->recorded_events = strdup(GEDCOM_STRING(parsed_value));
+      evt->recorded_events = gom_strdup(GEDCOM_STRING(parsed_value));
 
       if (! evt->recorded_events) {
 	MEMORY_ERROR;
-	free(evt);
+	gom_free(evt);
       }
       else {
 	int type = ctxt_type(ctxt);
@@ -86,12 +86,11 @@ struct submission* gom_get_submission()
 struct submission* MAKEFUNC(submission)(const char* xref)
 {
   if (! gom_submission) {
-    gom_submission = (struct submission*)malloc(sizeof(struct submission));
+    gom_submission = (struct submission*)gom_alloc(sizeof(struct submission));
     if (! gom_submission)
       MEMORY_ERROR;
     else {
-      memset(gom_submission, 0, sizeof(struct submission));
-      gom_submission->xrefstr = strdup(xref);
+      gom_submission->xrefstr = gom_strdup(xref);
       if (!gom_submission->xrefstr) MEMORY_ERROR;
     }
   }
@@ -68,7 +68,7 @@ Gedcom_ctxt subm_lang_start(_ELT_PARAMS_)
 
       while (i<2 && subm->language[i]) i++;
       if (! subm->language[i]) {
-	subm->language[i] = strdup(str);
+	subm->language[i] = gom_strdup(str);
 	if (! subm->language[i]) {
 	  MEMORY_ERROR;
 	  err = 1;
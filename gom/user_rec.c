@@ -79,13 +79,13 @@ Gedcom_ctxt user_rec_start(_REC_PARAMS_)
   }
 
   if (user) {
-    user->tag = strdup(tag);
+    user->tag = gom_strdup(tag);
     if (! user->tag) {
       MEMORY_ERROR;
       err = 1;
     }
     else if (GEDCOM_IS_STRING(parsed_value)) {
-      user->str_value = strdup(GEDCOM_STRING(parsed_value));
+      user->str_value = gom_strdup(GEDCOM_STRING(parsed_value));
       if (!user->str_value) {
 	MEMORY_ERROR;
 	err = 1;
@@ -113,8 +113,9 @@ struct user_rec* MAKEFUNC(user_rec)(const char* xrefstr)
   struct user_rec* rec = NULL;
   MAKE_CHAIN_ELT(user_rec, gom_first_user_rec, rec);
   if (rec && xrefstr) {
-    rec->xrefstr = strdup(xrefstr);
+    rec->xrefstr = gom_strdup(xrefstr);
     if (! rec->xrefstr) MEMORY_ERROR;
+    else gom_index_add(rec->xrefstr, T_user_rec, rec);
   }
   return rec;
 }
@@ -129,7 +130,7 @@ struct user_rec* ADDFUNC(user_rec)(const char* xrefstr, const char* tag)
     else {
       obj = MAKEFUNC(user_rec)(xrefstr);
       if (obj) {
-	obj->tag = strdup(tag);
+	obj->tag = gom_strdup(tag);
 	if (! obj->tag)
 	  MEMORY_ERROR;
 	else
@@ -154,26 +155,24 @@ Gedcom_ctxt user_elt_start(_ELT_PARAMS_)
     NO_CONTEXT;
   else {
     struct user_data *data
-      = (struct user_data *)malloc(sizeof(struct user_data));
+      = (struct user_data *)gom_alloc(sizeof(struct user_data));
 
     if (! data)
       MEMORY_ERROR;
     else {
-      memset (data, 0, sizeof(struct user_data));
-      
       data->level = level;
-      data->tag = strdup(tag);
+      data->tag = gom_strdup(tag);
       if (! data->tag) {
 	MEMORY_ERROR;
-	free(data);
+	gom_free(data);
 	err = 1;
       }
       else if (GEDCOM_IS_STRING(parsed_value)) {
-	data->str_value = strdup(GEDCOM_STRING(parsed_value));
+	data->str_value = gom_strdup(GEDCOM_STRING(parsed_value));
 	if (! data->str_value) {
 	  MEMORY_ERROR;
-	  free(data->tag);
-	  free(data->str_value);
+	  gom_free(data->tag);
+	  gom_free(data->str_value);
 	  err = 1;
 	}
       }
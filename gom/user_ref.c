@@ -45,10 +45,10 @@ Gedcom_ctxt sub_user_ref_start(_ELT_PARAMS_)
   else {
     struct user_ref_number *refn = SUB_MAKEFUNC(user_ref_number)();
     if (refn) {
-      refn->value = strdup(GEDCOM_STRING(parsed_value));
+      refn->value = gom_strdup(GEDCOM_STRING(parsed_value));
       if (! refn->value) {
 	MEMORY_ERROR;
-	free(refn);
+	gom_free(refn);
       }
       else {
 	int type = ctxt_type(ctxt);
@@ -422,14 +422,24 @@ struct user_rec {
   /** @{ */
   /** \brief Parses an existing Gedcom file */
 int  gom_parse_file(const char *file_name);
+  /** \brief Parses Gedcom data from a block of memory */
+int  gom_parse_buffer(const char *buffer, size_t size);
   /** \brief Starts a new Gedcom model */
 int  gom_new_model();
+  /** \brief Allocates the next Gedcom model in large blocks */
+void gom_set_arena_mode(int enable);
+  /** \brief Loads a model saved with gom_save_snapshot() */
+int  gom_load_snapshot(const char *file_name);
   /** @} */
 
   /** \addtogroup gom_write */
   /** @{ */
   /** \brief Write a Gedcom file */
 int  gom_write_file(const char* file_name, int *total_conv_fails);
+  /** \brief Write the Gedcom model to an open write handle */
+int  gom_write_hndl(Gedcom_write_hndl hndl);
+  /** \brief Save the Gedcom model in a binary snapshot file */
+int  gom_save_snapshot(const char* file_name);
   /** \brief Update the timestamp in a Gedcom model */
 int  gom_header_update_timestamp(time_t t);
   /** @} */
@@ -508,6 +518,105 @@ struct user_rec*   gom_get_first_user_rec();
 struct user_rec*   gom_get_user_rec_by_xref(const char *xref);
   /** @} */
 
+  /** \addtogroup gom_graph */
+  /** @{ */
+  /** \brief Pedigree linkage types of a child in a family, as flags.
+
+      A child without PEDI line (or with an unknown value) in its
+      link to the family counts as PEDIGREE_BIRTH, resp. PEDIGREE_OTHER. */
+enum _PEDIGREE_TYPE {
+  PEDIGREE_BIRTH   = 0x01,   /**< Birth (or no pedigree given) */
+  PEDIGREE_ADOPTED = 0x02,   /**< Adopted */
+  PEDIGREE_FOSTER  = 0x04,   /**< Foster */
+  PEDIGREE_SEALING = 0x08,   /**< Sealing */
+  PEDIGREE_OTHER   = 0x10,   /**< Any other value */
+  PEDIGREE_ANY     = 0x1F    /**< All of the above */
+};
+
+  /** \brief Pedigree linkage types of a child in a family, as flags. */
+  typedef enum _PEDIGREE_TYPE Gom_pedigree_type;
+
+  /** \brief Relations between the individuals, as arrays of ids.
+
+      For each individual with id \c i, its parents are
+      <code>parents[parents_start[i]]</code> up to (not including)
+      <code>parents[parents_start[i+1]]</code>, and similarly for the
+      children and the spouses.  For each family with id \c f, its children
+      are given by \c family_children_start and \c family_children in the
+      same way.  All the arrays contain individual ids.
+
+      The pedigree arrays run parallel to the \c parents, \c children and
+      \c family_children arrays, and give the pedigree linkage type of the
+      child in that relation (see Gom_pedigree_type). */
+struct family_graph {
+  int nr_of_individuals;
+  int nr_of_families;
+  struct individual **individuals;    /* by individual id */
+  struct family **families;           /* by family id */
+  int *husband;                       /* by family id, -1 if none */
+  int *wife;                          /* by family id, -1 if none */
+  int *family_children_start;         /* nr_of_families + 1 entries */
+  int *family_children;
+  int *parents_start;                 /* nr_of_individuals + 1 entries */
+  int *parents;
+  int *children_start;                /* nr_of_individuals + 1 entries */
+  int *children;
+  int *spouses_start;                 /* nr_of_individuals + 1 entries */
+  int *spouses;
+  unsigned char *family_children_pedigree;
+  unsigned char *parents_pedigree;
+  unsigned char *children_pedigree;
+};
+
+  /** \brief Retrieve the family graph of the model
+      \return The family graph, or \c NULL in case of memory errors */
+const struct family_graph* gom_get_family_graph();
+  /** \brief Retrieve the id of an individual in the family graph
+      \param obj The individual
+      \return The id, or -1 if the individual is not in the graph */
+int gom_get_individual_id(const struct individual* obj);
+  /** \brief Retrieve the id of a family in the family graph
+      \param obj The family
+      \return The id, or -1 if the family is not in the graph */
+int gom_get_family_id(const struct family* obj);
+  /** @} */
+
+  /** \addtogroup gom_traverse */
+  /** @{ */
+  /** \brief Direction of a traversal. */
+enum _TRAVERSE_DIR {
+  TRAVERSE_ANCESTORS,     /**< Go to the parents */
+  TRAVERSE_DESCENDANTS    /**< Go to the children */
+};
+
+  /** \brief Direction of a traversal. */
+  typedef enum _TRAVERSE_DIR Gom_traverse_dir;
+
+  /** \brief Order of a traversal. */
+enum _TRAVERSE_ORDER {
+  TRAVERSE_BREADTH_FIRST, /**< Generation per generation */
+  TRAVERSE_DEPTH_FIRST    /**< Line per line */
+};
+
+  /** \brief Order of a traversal. */
+  typedef enum _TRAVERSE_ORDER Gom_traverse_order;
+
+  /** \brief Callback for gom_traverse(); return nonzero to stop */
+typedef int (*Gom_traverse_cb) (struct individual* ind, int id,
+				int generation, void* data);
+
+  /** \brief Visit the ancestors or descendants of an individual */
+int gom_traverse(struct individual* start, Gom_traverse_dir dir,
+		 Gom_traverse_order order, int max_generations,
+		 int pedigree_mask, Gom_traverse_cb cb, void* data);
+  /** \brief Find a shortest path between two individuals */
+int gom_get_relationship_path(struct individual* from, struct individual* to,
+			      int max_length, int pedigree_mask, int** path);
+  /** \brief Count the ancestors or descendants of every individual */
+int gom_count_relatives(Gom_traverse_dir dir, int max_generations,
+			int pedigree_mask, int nr_of_threads, int* counts);
+  /** @} */
+
   /** \addtogroup gom_add_rec */
   /** @{ */
   /** \brief Add a submission record
@@ -0,0 +1,312 @@
+/* Test program for the family graph of the Gedcom library.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+#include "gom.h"
+#include "output.h"
+#include "portability.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include "gedcom.h"
+
+void show_help ()
+{
+  printf("gedcom-parse test program for the family graph of libgom\n\n");
+  printf("Usage:  graphtest [options] file\n");
+  printf("Options:\n");
+  printf("  -h    Show this help text\n");
+  printf("  -t    Test the traversals instead of showing the graph\n");
+  printf("  -q    No output to standard output\n");
+  printf("  -o <outfile>  File to generate output to (def. testgedcom.out)\n");
+}
+
+void gedcom_message_handler(Gedcom_msg_type type, char *msg)
+{
+  output(1, "%s\n", msg);
+}
+
+void show_ints(const char* name, const int* values, int nr)
+{
+  int i;
+  output(0, "%s:", name);
+  for (i = 0; i < nr; i++)
+    output(0, " %d", values[i]);
+  output(0, "\n");
+}
+
+void show_bytes(const char* name, const unsigned char* values, int nr)
+{
+  int i;
+  output(0, "%s:", name);
+  for (i = 0; i < nr; i++)
+    output(0, " %d", values[i]);
+  output(0, "\n");
+}
+
+int show_graph()
+{
+  const struct family_graph* g = gom_get_family_graph();
+  int nr_ind, nr_fam, i;
+
+  if (!g)
+    return 1;
+  nr_ind = g->nr_of_individuals;
+  nr_fam = g->nr_of_families;
+
+  output(0, "\n=== Individuals: %d\n", nr_ind);
+  for (i = 0; i < nr_ind; i++) {
+    output(0, "%d: %s\n", i, g->individuals[i]->xrefstr);
+    if (gom_get_individual_id(g->individuals[i]) != i)
+      return 2;
+  }
+  output(0, "\n=== Families: %d\n", nr_fam);
+  for (i = 0; i < nr_fam; i++) {
+    output(0, "%d: %s\n", i, g->families[i]->xrefstr);
+    if (gom_get_family_id(g->families[i]) != i)
+      return 3;
+  }
+
+  output(0, "\n=== Arrays\n");
+  show_ints("husband", g->husband, nr_fam);
+  show_ints("wife", g->wife, nr_fam);
+  show_ints("family_children_start", g->family_children_start, nr_fam + 1);
+  show_ints("family_children", g->family_children,
+	    g->family_children_start[nr_fam]);
+  show_bytes("family_children_pedigree", g->family_children_pedigree,
+	     g->family_children_start[nr_fam]);
+  show_ints("parents_start", g->parents_start, nr_ind + 1);
+  show_ints("parents", g->parents, g->parents_start[nr_ind]);
+  show_bytes("parents_pedigree", g->parents_pedigree,
+	     g->parents_start[nr_ind]);
+  show_ints("children_start", g->children_start, nr_ind + 1);
+  show_ints("children", g->children, g->children_start[nr_ind]);
+  show_bytes("children_pedigree", g->children_pedigree,
+	     g->children_start[nr_ind]);
+  show_ints("spouses_start", g->spouses_start, nr_ind + 1);
+  show_ints("spouses", g->spouses, g->spouses_start[nr_ind]);
+
+  if (gom_get_individual_id(NULL) != -1)
+    return 4;
+  if (gom_get_family_id(NULL) != -1)
+    return 5;
+
+  return 0;
+}
+
+int show_visit(struct individual* ind, int id, int generation, void* data)
+{
+  int* visited = (int*)data;
+  output(0, " %s(%d)", ind->xrefstr, generation);
+  visited[id] = 1;
+  return 0;
+}
+
+/* Traverses in both orders, and checks that the same individuals are
+   visited */
+int test_traverse(const char* xref, Gom_traverse_dir dir, int max_generations,
+		  int pedigree_mask)
+{
+  const struct family_graph* g = gom_get_family_graph();
+  struct individual* start = gom_get_individual_by_xref(xref);
+  int *bf_visited, *df_visited;
+  int bf_count, df_count, i, result = 0;
+
+  if (!g || !start)
+    return 10;
+  bf_visited = (int*)calloc(g->nr_of_individuals, sizeof(int));
+  df_visited = (int*)calloc(g->nr_of_individuals, sizeof(int));
+  if (!bf_visited || !df_visited)
+    return 11;
+
+  output(0, "\n=== %s of %s, max generations %d, pedigree mask %d\n",
+	 (dir == TRAVERSE_ANCESTORS ? "Ancestors" : "Descendants"),
+	 xref, max_generations, pedigree_mask);
+  output(0, "Breadth-first:");
+  bf_count = gom_traverse(start, dir, TRAVERSE_BREADTH_FIRST, max_generations,
+			  pedigree_mask, show_visit, bf_visited);
+  output(0, "\nVisited: %d\n", bf_count);
+  output(0, "Depth-first:");
+  df_count = gom_traverse(start, dir, TRAVERSE_DEPTH_FIRST, max_generations,
+			  pedigree_mask, show_visit, df_visited);
+  output(0, "\nVisited: %d\n", df_count);
+
+  if (bf_count != df_count)
+    result = 12;
+  for (i = 0; i < g->nr_of_individuals; i++)
+    if (bf_visited[i] != df_visited[i])
+      result = 13;
+  free(bf_visited);
+  free(df_visited);
+  return result;
+}
+
+int test_path(const char* from_xref, const char* to_xref)
+{
+  const struct family_graph* g = gom_get_family_graph();
+  int* path;
+  int length, i;
+
+  length = gom_get_relationship_path(gom_get_individual_by_xref(from_xref),
+				     gom_get_individual_by_xref(to_xref),
+				     -1, PEDIGREE_ANY, &path);
+  if (!g || length <= 0)
+    return 20;
+  output(0, "\n=== Path from %s to %s:", from_xref, to_xref);
+  for (i = 0; i < length; i++)
+    output(0, " %s", g->individuals[path[i]]->xrefstr);
+  output(0, "\n");
+  free(path);
+  return 0;
+}
+
+int test_count(Gom_traverse_dir dir)
+{
+  const struct family_graph* g = gom_get_family_graph();
+  int *counts1, *counts2;
+  int i, result = 0;
+
+  if (!g)
+    return 30;
+  counts1 = (int*)calloc(g->nr_of_individuals, sizeof(int));
+  counts2 = (int*)calloc(g->nr_of_individuals, sizeof(int));
+  if (!counts1 || !counts2)
+    return 31;
+  if (gom_count_relatives(dir, -1, PEDIGREE_ANY, 1, counts1) != 0
+      || gom_count_relatives(dir, -1, PEDIGREE_ANY, 2, counts2) != 0)
+    result = 32;
+  else {
+    output(0, "\n=== Number of %s:",
+	   (dir == TRAVERSE_ANCESTORS ? "ancestors" : "descendants"));
+    for (i = 0; i < g->nr_of_individuals; i++) {
+      output(0, " %d", counts1[i]);
+      if (counts1[i] != counts2[i])
+	result = 33;
+    }
+    output(0, "\n");
+  }
+  free(counts1);
+  free(counts2);
+  return result;
+}
+
+int test_traversals()
+{
+  int result = 0;
+  if (!result)
+    result = test_traverse("@I1@", TRAVERSE_ANCESTORS, -1, PEDIGREE_ANY);
+  if (!result)
+    result = test_traverse("@I1@", TRAVERSE_ANCESTORS, 2, PEDIGREE_ANY);
+  if (!result)
+    result = test_traverse("@I1@", TRAVERSE_ANCESTORS, 3, PEDIGREE_ANY);
+  if (!result)
+    result = test_traverse("@I11@", TRAVERSE_DESCENDANTS, -1, PEDIGREE_ANY);
+  if (!result)
+    result = test_traverse("@I11@", TRAVERSE_DESCENDANTS, 3, PEDIGREE_ANY);
+  if (!result)
+    result = test_traverse("@I11@", TRAVERSE_DESCENDANTS, 4, PEDIGREE_BIRTH);
+  if (!result)
+    result = test_path("@I6@", "@I9@");
+  if (!result)
+    result = test_path("@I1@", "@I10@");
+  if (!result)
+    result = test_count(TRAVERSE_ANCESTORS);
+  if (!result)
+    result = test_count(TRAVERSE_DESCENDANTS);
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  int result      = 0;
+  int traversals  = 0;
+  char* outfilename = NULL;
+  char* file_name = NULL;
+
+  if (argc > 1) {
+    int i;
+    for (i=1; i<argc; i++) {
+      if (!strncmp(argv[i], "-h", 3)) {
+	show_help();
+	exit(1);
+      }
+      else if (!strncmp(argv[i], "-t", 3)) {
+	traversals = 1;
+      }
+      else if (!strncmp(argv[i], "-q", 3)) {
+	output_set_quiet(1);
+      }
+      else if (!strncmp(argv[i], "-o", 3)) {
+	i++;
+	if (i < argc) {
+	  outfilename = argv[i];
+	}
+	else {
+	  printf ("Missing output file name\n");
+	  show_help();
+	  exit(1);
+	}
+      }
+      else if (strncmp(argv[i], "-", 1)) {
+	file_name = argv[i];
+	break;
+      }
+      else {
+	printf ("Unrecognized option: %s\n", argv[i]);
+	show_help();
+	exit(1);
+      }
+    }
+  }
+
+  if (!file_name) {
+    printf("No file name given\n");
+    show_help();
+    exit(1);
+  }
+
+  gedcom_init();
+  setlocale(LC_ALL, "");
+  gedcom_set_message_handler(gedcom_message_handler);
+
+  output_open(outfilename);
+  output(0, "\n=== Parsing file %s\n", simple_base_name(file_name));
+  result = gom_parse_file(file_name);
+  if (result == 0) {
+    output(1, "Parse succeeded\n");
+    if (traversals)
+      result = test_traversals();
+    else
+      result = show_graph();
+  }
+  else {
+    output(1, "Parse failed\n");
+  }
+  if (result == 0) {
+    output(1, "Test succeeded\n");
+  }
+  else {
+    output(1, "Test failed: %d\n", result);
+  }
+  output_close();
+  return result;
+}
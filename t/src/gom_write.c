@@ -27,11 +27,16 @@
 #include "portability.h"
 #include <locale.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define WRITE_GEDCOM "gom_write.ged"
 #define PROG_NAME "writegomtest"
 #define PROG_VERSION "3.14"
 #define TIMESTAMP 1000000000L
+#define SNAPSHOT_FILE "gom_write.snap"
 
 void gedcom_message_handler(Gedcom_msg_type type, char *msg)
 {
@@ -59,6 +64,13 @@ void show_help ()
   printf("        <unicode_enc> can be: HILO, LOHI, HILO_BOM, LOHI_BOM\n");
   printf("  -t <terminator>  Line terminator\n");
   printf("        <terminator> can be CR, LF, CR_LF, LF_CR\n");
+  printf("  -fd   Write via a handle on a file descriptor\n");
+  printf("  -ff   Write via a handle on a stdio stream\n");
+  printf("  -fm   Write via a handle on memory, and then to the file\n");
+  printf("  -p    Parse with 2 worker threads (in the order of the file)\n");
+  printf("  -s    Save the model in a snapshot and load it again before writing\n");
+  printf("  -sc   Save the model in a snapshot, damage it, and check that it\n"
+	 "        can't be loaded (the input file is then parsed again)\n");
 }
 
 int update_header(char* encoding)
@@ -112,6 +124,87 @@ int test_timestamps()
   return result;
 }
 
+/* Writes the model to the file, via one of the gedcom_write_open
+   functions: 'n' is for the file name, 'd' for a file descriptor, 'f' for a
+   stdio stream and 'm' for memory */
+int write_file(char* gedfilename, char sink, int* total_conv_fails)
+{
+  Gedcom_write_hndl hndl = NULL;
+  FILE* file  = NULL;
+  int fd      = -1;
+  char* buffer = NULL;
+  size_t size = 0;
+  int result  = 1;
+
+  if (sink == 'n')
+    return gom_write_file(gedfilename, total_conv_fails);
+  else if (sink == 'd') {
+    fd = open(gedfilename, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd >= 0)
+      hndl = gedcom_write_open_fd(fd);
+  }
+  else if (sink == 'f') {
+    file = fopen(gedfilename, "wb");
+    if (file)
+      hndl = gedcom_write_open_file(file);
+  }
+  else if (sink == 'm')
+    hndl = gedcom_write_open_mem(&buffer, &size);
+
+  if (hndl) {
+    result = gom_write_hndl(hndl);
+    result |= gedcom_write_close(hndl, total_conv_fails);
+  }
+  if (fd >= 0)
+    close(fd);
+  if (file)
+    fclose(file);
+  if (buffer) {
+    file = fopen(gedfilename, "wb");
+    if (!file || fwrite(buffer, 1, size, file) != size)
+      result = 1;
+    if (file)
+      fclose(file);
+    free(buffer);
+  }
+  return result;
+}
+
+/* Overwrites the end of the snapshot file, keeping its size */
+int damage_snapshot()
+{
+  char garbage[16];
+  FILE* file = fopen(SNAPSHOT_FILE, "r+b");
+  int result = 1;
+  memset(garbage, 0xFF, sizeof(garbage));
+  if (file) {
+    if (fseek(file, -(long)sizeof(garbage), SEEK_END) == 0
+	&& fwrite(garbage, 1, sizeof(garbage), file) == sizeof(garbage))
+      result = 0;
+    fclose(file);
+  }
+  return result;
+}
+
+/* Saves the model in a snapshot and loads it again; if damage is set, the
+   snapshot is damaged, and the load must fail */
+int test_snapshot(int damage)
+{
+  int result = gom_save_snapshot(SNAPSHOT_FILE);
+  if (result == 0 && damage) {
+    result = damage_snapshot();
+    if (result == 0) {
+      output(1, "Loading damaged snapshot...\n");
+      if (gom_load_snapshot(SNAPSHOT_FILE) == 0)
+	result = 200;
+    }
+  }
+  else if (result == 0)
+    result = gom_load_snapshot(SNAPSHOT_FILE);
+  remove(SNAPSHOT_FILE);
+  return result;
+}
+
 int main(int argc, char* argv[])
 {
   int result;
@@ -123,6 +216,9 @@ int main(int argc, char* argv[])
   Encoding enc      = ONE_BYTE;
   Enc_bom bom       = WITHOUT_BOM;
   Enc_line_end end  = END_LF;
+  char sink         = 'n';
+  int snapshot      = 0;
+  int workers       = 0;
   
   if (argc > 1) {
     int i;
@@ -167,6 +263,20 @@ int main(int argc, char* argv[])
 	  exit(1);
 	}
       }
+      else if (!strncmp(argv[i], "-fd", 4)
+	       || !strncmp(argv[i], "-ff", 4)
+	       || !strncmp(argv[i], "-fm", 4)) {
+	sink = argv[i][2];
+      }
+      else if (!strncmp(argv[i], "-p", 3)) {
+	workers = 2;
+      }
+      else if (!strncmp(argv[i], "-s", 3)) {
+	snapshot = 1;
+      }
+      else if (!strncmp(argv[i], "-sc", 4)) {
+	snapshot = 2;
+      }
       else if (!strncmp(argv[i], "-e", 3)) {
 	i++;
 	if (i < argc) {
@@ -235,11 +345,18 @@ int main(int argc, char* argv[])
   gedcom_init();
   setlocale(LC_ALL, "");
   gedcom_set_message_handler(gedcom_message_handler);
+  gedcom_set_parallel_parse(workers, CB_FILE_ORDER);
 
   output_open(outfilename);
 
   if (infilename) {
     result = gom_parse_file(infilename);
+    if (result == 0 && snapshot)
+      result |= test_snapshot(snapshot == 2);
+    if (result == 0 && snapshot == 2) {
+      output(1, "Parsing file again...\n");
+      result |= gom_parse_file(infilename);
+    }
   }
   else {
     gedcom_write_set_encoding(ENC_MANUAL, encoding, enc, bom);
@@ -252,7 +369,7 @@ int main(int argc, char* argv[])
     result |= test_timestamps();
   if (result == 0) {
     output(1, "Writing file...\n");
-    result |= gom_write_file(gedfilename, &total_conv_fails);
+    result |= write_file(gedfilename, sink, &total_conv_fails);
   }
   if (result == 0 && total_conv_fails == 0) {
     output(1, "Re-parsing file...\n");
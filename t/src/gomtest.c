@@ -26,6 +26,7 @@
 #include "dump_gom.h"
 #include "portability.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <locale.h>
 #include "gedcom.h"
 
@@ -41,6 +42,8 @@ void show_help ()
   printf("  -fn   No fail on errors\n");
   printf("  -dg   Debug setting: only libgedcom debug messages\n");
   printf("  -da   Debug setting: libgedcom + yacc debug messages\n");
+  printf("  -a    Build the model in arena mode\n");
+  printf("  -m    Parse the file from a buffer in memory\n");
   printf("  -q    No output to standard output\n");
   printf("  -o <outfile>  File to generate output to (def. testgedcom.out)\n");
 }
@@ -56,6 +59,8 @@ int main(int argc, char* argv[])
   int compat_enabled = 1;
   int debug_level = 0;
   int result      = 0;
+  int from_memory = 0;
+  int arena_mode  = 0;
   char* outfilename = NULL;
   char* file_name = NULL;
 
@@ -74,6 +79,10 @@ int main(int argc, char* argv[])
 	mech = IGNORE_ERRORS;
       else if (!strncmp(argv[i], "-nc", 4))
 	compat_enabled = 0;
+      else if (!strncmp(argv[i], "-m", 3))
+	from_memory = 1;
+      else if (!strncmp(argv[i], "-a", 3))
+	arena_mode = 1;
       else if (!strncmp(argv[i], "-h", 3)) {
 	show_help();
 	exit(1);
@@ -116,10 +125,22 @@ int main(int argc, char* argv[])
   gedcom_set_compat_handling(compat_enabled);
   gedcom_set_error_handling(mech);
   gedcom_set_message_handler(gedcom_message_handler);
+  gom_set_arena_mode(arena_mode);
 
   output_open(outfilename);
   output(0, "\n=== Parsing file %s\n", simple_base_name(file_name));
-  result = gom_parse_file(file_name);
+  if (from_memory) {
+    size_t size;
+    char* buffer = read_file(file_name, &size);
+    if (buffer) {
+      result = gom_parse_buffer(buffer, size);
+      free(buffer);
+    }
+    else
+      result = 1;
+  }
+  else
+    result = gom_parse_file(file_name);
   if (result == 0) {
     output(1, "Parse succeeded\n");
   }
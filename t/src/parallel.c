@@ -0,0 +1,282 @@
+/* Test program for the parallel parse of the Gedcom library.
+   Copyright (C) 2026 The Genes Development Team
+   This file is part of the Gedcom parser library.
+
+   The Gedcom parser library is free software; you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The Gedcom parser library is distributed in the hope that it will be
+   useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the Gedcom parser library; if not, write to the
+   Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307 USA.  */
+
+/* $Id$ */
+/* $Name$ */
+
+/* The callbacks of this program can be called from several threads at the
+   same time (with CB_UNORDERED), so they only update some totals and
+   collect the messages, under a lock.  Everything is shown at the end, in
+   a form that doesn't depend on the order of the callbacks, so that the
+   output is the same as for a normal parse. */
+
+#include "config.h"
+#include "gedcom.h"
+#include "output.h"
+#include "portability.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
+#define NR_OF_WORKERS 2
+
+#ifdef HAVE_LIBPTHREAD
+pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_t main_thread;
+#define LOCK   pthread_mutex_lock(&lock)
+#define UNLOCK pthread_mutex_unlock(&lock)
+#else
+#define LOCK
+#define UNLOCK
+#endif
+
+unsigned long rec_count[NR_OF_RECS];
+unsigned long elt_count   = 0;
+unsigned long rec_sum     = 0;
+unsigned long elt_sum     = 0;
+int other_threads = 0;
+char** messages   = NULL;
+int nr_of_messages  = 0;
+int max_messages    = 0;
+
+void show_help ()
+{
+  printf("gedcom-parse test program for the parallel parse of libgedcom\n\n");
+  printf("Usage:  paralleltest [options] file\n");
+  printf("Options:\n");
+  printf("  -h    Show this help text\n");
+  printf("  -pf   Parse with %d workers, callbacks in the order of the file\n",
+	 NR_OF_WORKERS);
+  printf("  -pu   Parse with %d workers, callbacks from the workers\n",
+	 NR_OF_WORKERS);
+  printf("  -q    No output to standard output\n");
+  printf("  -o <outfile>  File to generate output to (def. testgedcom.out)\n");
+}
+
+/* A hash of the line, added to the totals (so that the order doesn't
+   matter) */
+unsigned long hash_line(int level, const char* tag, const char* xref,
+			const char* value)
+{
+  unsigned long h = 2166136261UL + level;
+  const char* parts[3];
+  int i;
+  parts[0] = tag;
+  parts[1] = xref;
+  parts[2] = value;
+  for (i = 0; i < 3; i++) {
+    const char* p = parts[i];
+    for (; p && *p; p++)
+      h = ((h ^ (unsigned char)*p) * 16777619UL) & 0xFFFFFFFFUL;
+    h = ((h ^ '|') * 16777619UL) & 0xFFFFFFFFUL;
+  }
+  return h;
+}
+
+void check_thread()
+{
+#ifdef HAVE_LIBPTHREAD
+  if (!pthread_equal(pthread_self(), main_thread))
+    other_threads = 1;
+#endif
+}
+
+void gedcom_message_handler(Gedcom_msg_type type, char *msg)
+{
+  const char* prefix = "";
+  char* text;
+  if (type == MESSAGE)
+    prefix = "MESSAGE: ";
+  else if (type == WARNING)
+    prefix = "WARNING: ";
+  else if (type == ERROR)
+    prefix = "ERROR: ";
+  text = (char*)malloc(strlen(prefix) + strlen(msg) + 1);
+  if (!text)
+    return;
+  strcpy(text, prefix);
+  strcat(text, msg);
+
+  LOCK;
+  check_thread();
+  if (nr_of_messages == max_messages) {
+    int new_max = max_messages ? max_messages * 2 : 64;
+    char** new_messages = (char**)realloc(messages, new_max * sizeof(char*));
+    if (new_messages) {
+      messages     = new_messages;
+      max_messages = new_max;
+    }
+  }
+  if (nr_of_messages < max_messages)
+    messages[nr_of_messages++] = text;
+  else
+    free(text);
+  UNLOCK;
+}
+
+Gedcom_ctxt rec_start(Gedcom_rec rec, int level, Gedcom_val xref, char *tag,
+		      char *raw_value, int tag_value,
+		      Gedcom_val parsed_value)
+{
+  char* xref_str = NULL;
+  unsigned long h;
+  if (! GEDCOM_IS_NULL(xref))
+    xref_str = GEDCOM_XREF_PTR(xref)->string;
+  h = hash_line(level, tag, xref_str, raw_value);
+  LOCK;
+  check_thread();
+  rec_count[rec]++;
+  rec_sum = (rec_sum + h) & 0xFFFFFFFFUL;
+  UNLOCK;
+  return (Gedcom_ctxt)int_to_void_ptr(tag_value);
+}
+
+void default_cb(Gedcom_elt elt, Gedcom_ctxt ctxt, int level, char *tag,
+		char *raw_value, int tag_value)
+{
+  unsigned long h = hash_line(level, tag, NULL, raw_value);
+  LOCK;
+  check_thread();
+  elt_count++;
+  elt_sum = (elt_sum + h) & 0xFFFFFFFFUL;
+  UNLOCK;
+}
+
+int compare_messages(const void* a, const void* b)
+{
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+void show_results()
+{
+  int i;
+  qsort(messages, nr_of_messages, sizeof(char*), compare_messages);
+  for (i = 0; i < nr_of_messages; i++) {
+    output(1, "%s\n", messages[i]);
+    free(messages[i]);
+  }
+  free(messages);
+  messages       = NULL;
+  nr_of_messages = 0;
+  max_messages   = 0;
+
+  output(0, "Records:");
+  for (i = 0; i < NR_OF_RECS; i++)
+    output(0, " %lu", rec_count[i]);
+  output(0, "\nElements: %lu\n", elt_count);
+  output(0, "Checksum of the records: %08lx\n", rec_sum);
+  output(0, "Checksum of the elements: %08lx\n", elt_sum);
+}
+
+void subscribe_callbacks()
+{
+  int rec;
+  for (rec = REC_HEAD; rec <= REC_USER; rec++)
+    gedcom_subscribe_to_record((Gedcom_rec)rec, rec_start, NULL);
+  gedcom_set_default_callback(default_cb);
+}
+
+int main(int argc, char* argv[])
+{
+  int workers = 0;
+  Gedcom_cb_order order = CB_FILE_ORDER;
+  int result      = 0;
+  char* outfilename = NULL;
+  char* file_name = NULL;
+
+  if (argc > 1) {
+    int i;
+    for (i=1; i<argc; i++) {
+      if (!strncmp(argv[i], "-h", 3)) {
+	show_help();
+	exit(1);
+      }
+      else if (!strncmp(argv[i], "-pf", 4)) {
+	workers = NR_OF_WORKERS;
+	order   = CB_FILE_ORDER;
+      }
+      else if (!strncmp(argv[i], "-pu", 4)) {
+	workers = NR_OF_WORKERS;
+	order   = CB_UNORDERED;
+      }
+      else if (!strncmp(argv[i], "-q", 3)) {
+	output_set_quiet(1);
+      }
+      else if (!strncmp(argv[i], "-o", 3)) {
+	i++;
+	if (i < argc) {
+	  outfilename = argv[i];
+	}
+	else {
+	  printf ("Missing output file name\n");
+	  show_help();
+	  exit(1);
+	}
+      }
+      else if (strncmp(argv[i], "-", 1)) {
+	file_name = argv[i];
+	break;
+      }
+      else {
+	printf ("Unrecognized option: %s\n", argv[i]);
+	show_help();
+	exit(1);
+      }
+    }
+  }
+
+  if (!file_name) {
+    printf("No file name given\n");
+    show_help();
+    exit(1);
+  }
+
+#ifdef HAVE_LIBPTHREAD
+  main_thread = pthread_self();
+#endif
+  gedcom_init();
+  setlocale(LC_ALL, "");
+  gedcom_set_message_handler(gedcom_message_handler);
+  gedcom_set_parallel_parse(workers, order);
+  subscribe_callbacks();
+
+  output_open(outfilename);
+  output(0, "\n=== Parsing file %s\n", simple_base_name(file_name));
+  result = gedcom_parse_file(file_name);
+  show_results();
+#ifdef HAVE_LIBPTHREAD
+  /* The callbacks must come from the workers only if asked for */
+  if (other_threads != (workers > 0 && order == CB_UNORDERED)) {
+    output(1, "Callbacks from the wrong thread\n");
+    result |= 1;
+  }
+#endif
+  if (result == 0) {
+    output(1, "Parse succeeded\n");
+  }
+  else {
+    output(1, "Parse failed\n");
+  }
+  output_close();
+  return result;
+}
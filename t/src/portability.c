@@ -21,6 +21,8 @@
 /* $Id$ */
 /* $Name$ */
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "config.h"
 
@@ -83,3 +85,25 @@ char* simple_base_name(char* filename)
   }
   return runner;
 }
+
+/* Reads a whole file into a newly allocated buffer, to test the parsing
+   from memory; returns NULL on errors */
+char* read_file(char* filename, size_t* size)
+{
+  FILE* file = fopen(filename, "rb");
+  char* buffer = NULL;
+  long len;
+  if (file) {
+    if (fseek(file, 0, SEEK_END) == 0 && (len = ftell(file)) >= 0
+	&& fseek(file, 0, SEEK_SET) == 0) {
+      buffer = (char*)malloc(len + 1);
+      if (buffer && fread(buffer, 1, len, file) != (size_t)len) {
+	free(buffer);
+	buffer = NULL;
+      }
+      *size = len;
+    }
+    fclose(file);
+  }
+  return buffer;
+}
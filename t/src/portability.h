@@ -24,10 +24,13 @@
 #ifndef __PORTABILITY_H
 #define __PORTABILITY_H
 
+#include <stddef.h>
+
 long int void_ptr_to_int(void* ptr);
 void*    int_to_void_ptr(int t);
 char*    str_val(char* input);
 char*    ptr_val(void* ptr);
 char*    simple_base_name(char* filename);
+char*    read_file(char* filename, size_t* size);
 
 #endif /* __PORTABILITY_H */
@@ -33,6 +33,7 @@
 #include "utf8tools.h"
 
 #define BOGUS_FILE_NAME "bogus.ged"
+#define DATE_CACHE_SIZE 16
 int total_conv_fails = 0;
 
 void show_help ()
@@ -50,6 +51,13 @@ void show_help ()
   printf("  -2    Run the test parse 2 times instead of once\n");
   printf("  -3    Run the test parse 3 times instead of once\n");
   printf("  -b    Parse a bogus file (bogus.ged) before parsing the main file\n");
+  printf("  -l    Report each kind of message only once, and show the message\n"
+	 "        statistics after each parse\n");
+  printf("  -c    Enable the date cache, and show its statistics after each\n"
+	 "        parse\n");
+  printf("  -r    Also subscribe to the header, submitter and individual records\n"
+	 "        with a batch callback\n");
+  printf("  -m    Parse the file from a buffer in memory\n");
   printf("  -q    No output to standard output\n");
   printf("  -o <outfile>  File to generate output to (def. testgedcom.out)\n");
 }
@@ -237,6 +245,53 @@ void subscribe_callbacks()
   gedcom_subscribe_to_element(ELT_SUB_FAM_EVT_AGE, age_start, NULL);
 }
 
+void batch_cb(Gedcom_rec rec, const struct batch_line* lines,
+		  int nr_of_lines)
+{
+  int i;
+  output(1, "Batch of record %d, %d lines:\n", rec, nr_of_lines);
+  for (i = 0; i < nr_of_lines; i++) {
+    Gedcom_val val = lines[i].parsed_value;
+    output(1, "  %d %s (element %d, xref %s) '%s': ",
+	   lines[i].level, lines[i].tag, lines[i].id,
+	   str_val((char*)lines[i].xref), str_val((char*)lines[i].raw_value));
+    if (GEDCOM_IS_STRING(val))
+      output(1, "string '%s'\n", GEDCOM_STRING(val));
+    else if (GEDCOM_IS_XREF_PTR(val))
+      output(1, "xref %s\n", GEDCOM_XREF_PTR(val)->string);
+    else if (GEDCOM_IS_DATE(val)) {
+      struct date_value dv = GEDCOM_DATE(val);
+      output(1, "date '%s'\n", gedcom_date_to_string(&dv));
+    }
+    else if (GEDCOM_IS_AGE(val)) {
+      struct age_value age = GEDCOM_AGE(val);
+      output(1, "age '%s'\n", gedcom_age_to_string(&age));
+    }
+    else
+      output(1, "null\n");
+  }
+}
+
+void show_date_cache_stats()
+{
+  unsigned long hits, misses;
+  gedcom_get_date_cache_stats(&hits, &misses);
+  output(0, "=== Date cache hits: %lu, misses: %lu\n", hits, misses);
+}
+
+void show_message_stats()
+{
+  unsigned long reported, suppressed;
+  int length;
+  gedcom_get_message_stats(&reported, &suppressed);
+  output(0, "=== Messages reported: %lu, suppressed: %lu\n",
+	 reported, suppressed);
+  length = gedcom_message("Message %d from the test program", 1);
+  output(0, "=== Length of the message: %d\n", length);
+  length = gedcom_message("Message %d from the test program", 2);
+  output(0, "=== Length of the message: %d\n", length);
+}
+
 void gedcom_message_handler(Gedcom_msg_type type, char *msg)
 {
   if (type == MESSAGE)
@@ -255,6 +310,10 @@ int main(int argc, char* argv[])
   int debug_level = 0;
   int run_times   = 1;
   int bogus       = 0;
+  int limit       = 0;
+  int from_memory = 0;
+  int date_cache  = 0;
+  int batch       = 0;
   int result      = 0;
   char* outfilename = NULL;
   char* file_name = NULL;
@@ -287,6 +346,18 @@ int main(int argc, char* argv[])
       else if (!strncmp(argv[i], "-b", 3)) {
 	bogus = 1;
       }
+      else if (!strncmp(argv[i], "-c", 3)) {
+	date_cache = 1;
+      }
+      else if (!strncmp(argv[i], "-r", 3)) {
+	batch = 1;
+      }
+      else if (!strncmp(argv[i], "-m", 3)) {
+	from_memory = 1;
+      }
+      else if (!strncmp(argv[i], "-l", 3)) {
+	limit = 1;
+      }
       else if (!strncmp(argv[i], "-q", 3)) {
 	output_set_quiet(1);
       }
@@ -326,18 +397,43 @@ int main(int argc, char* argv[])
   gedcom_set_compat_options(COMPAT_ALLOW_OUT_OF_CONTEXT);
   gedcom_set_error_handling(mech);
   gedcom_set_message_handler(gedcom_message_handler);
+  gedcom_set_message_limit(limit);
+  if (date_cache)
+    gedcom_set_date_cache(DATE_CACHE_SIZE);
   gedcom_set_default_callback(default_cb);
   
   subscribe_callbacks();
+  if (batch) {
+    gedcom_subscribe_to_record_batch(REC_HEAD, batch_cb);
+    gedcom_subscribe_to_record_batch(REC_SUBM, batch_cb);
+    gedcom_subscribe_to_record_batch(REC_INDI, batch_cb);
+  }
   output_open(outfilename);
   if (bogus) {
     output(0, "\n=== Parsing bogus file %s\n", BOGUS_FILE_NAME);
     gedcom_parse_file(BOGUS_FILE_NAME);
+    if (limit)
+      show_message_stats();
   }
   while (run_times-- > 0) {
     output(0, "\n=== Parsing file %s\n", simple_base_name(file_name));
-    result |= gedcom_parse_file(file_name);
+    if (from_memory) {
+      size_t size;
+      char* buffer = read_file(file_name, &size);
+      if (buffer) {
+	result |= gedcom_parse_buffer(buffer, size);
+	free(buffer);
+      }
+      else
+	result |= 1;
+    }
+    else
+      result |= gedcom_parse_file(file_name);
     output(0, "\n=== Total conversion failures: %d\n", total_conv_fails);
+    if (limit)
+      show_message_stats();
+    if (date_cache)
+      show_date_cache_stats();
   }
   if (result == 0) {
     output(1, "Parse succeeded\n");
@@ -40,13 +40,18 @@ fi
 
 outfile=$test_name.out
 logfile=check.out
-reffile=$srcdir/output/$test_name.ref
+# A test can use the reference output of another test
+if [ -z "$reference" ]
+then
+  reference=$test_name
+fi
+reffile=$srcdir/output/$reference.ref
 options="$options -o $outfile"
 
 if [ "$gedcom_out" ]
 then
   gedfile=$test_name.ged
-  gedreffile=$srcdir/output/$test_name.ged
+  gedreffile=$srcdir/output/$reference.ged
   options="$options -w $gedfile"
 fi
 
@@ -47,6 +47,7 @@ void show_help ()
   printf("Usage:  updategomtest [options]\n");
   printf("Options:\n");
   printf("  -h    Show this help text\n");
+  printf("  -a    Build the model in arena mode\n");
   printf("  -q    No output to standard output\n");
   printf("  -o <outfile>  File to generate output to (def. testgedcom.out)\n");
 }
@@ -337,6 +338,17 @@ int test_add_delete_functions()
   result = gom_remove_personal_name(&(ind2->name), name);
   if (result != 0) return 136;
 
+  if (gom_get_family_by_xref("@FAM1@") != fam1) return 140;
+  if (gom_get_individual_by_xref("@IND1@") != ind1) return 141;
+  if (gom_get_individual_by_xref("@IND4@") != ind4) return 142;
+  if (gom_get_multimedia_by_xref("@OBJ1@") != mm1) return 143;
+  if (gom_get_note_by_xref("@NOTE1@") != note1) return 144;
+  if (gom_get_repository_by_xref("@REPO1@") != repo1) return 145;
+  if (gom_get_source_by_xref("@SOUR1@") != sour1) return 146;
+  if (gom_get_submitter_by_xref("@SUBM2@") != subm2) return 147;
+  if (gom_get_user_rec_by_xref("@USER1@") != user1) return 148;
+  if (gom_get_family_by_xref("@IND1@") != NULL) return 149;
+
   output(1, "Intermediate output:\n");
   show_data();
 
@@ -375,6 +387,28 @@ int test_add_delete_functions()
 
   result = gom_delete_user_rec(user1);
   if (result != 0) return 161;
+
+  /* The deleted records can't be found anymore, the others still can */
+  if (gom_get_family_by_xref("@FAM1@") != NULL) return 170;
+  if (gom_get_individual_by_xref("@IND1@") != NULL) return 171;
+  if (gom_get_individual_by_xref("@IND2@") != NULL) return 172;
+  if (gom_get_multimedia_by_xref("@OBJ1@") != NULL) return 173;
+  if (gom_get_note_by_xref("@NOTE1@") != NULL) return 174;
+  if (gom_get_repository_by_xref("@REPO1@") != NULL) return 175;
+  if (gom_get_source_by_xref("@SOUR1@") != NULL) return 176;
+  if (gom_get_submitter_by_xref("@SUBM2@") != NULL) return 177;
+  if (gom_get_user_rec_by_xref("@USER1@") != NULL) return 178;
+  if (gom_get_individual_by_xref("@IND3@") != ind3) return 179;
+  if (gom_get_individual_by_xref("@IND4@") != ind4) return 180;
+  if (gom_get_submitter_by_xref("@SUBMITTER@") == NULL) return 181;
+
+  /* A deleted cross-reference can be used again */
+  ind1 = gom_new_individual("@IND1@");
+  if (!ind1) return 182;
+  if (gom_get_individual_by_xref("@IND1@") != ind1) return 183;
+  result = gom_delete_individual(ind1);
+  if (result != 0) return 184;
+  if (gom_get_individual_by_xref("@IND1@") != NULL) return 185;
   
   return 0;
 }
@@ -382,6 +416,7 @@ int test_add_delete_functions()
 int main(int argc, char* argv[])
 {
   int result;
+  int arena_mode = 0;
   char* outfilename = NULL;
   
   if (argc > 1) {
@@ -394,6 +429,9 @@ int main(int argc, char* argv[])
       else if (!strncmp(argv[i], "-q", 3)) {
 	output_set_quiet(1);
       }
+      else if (!strncmp(argv[i], "-a", 3)) {
+	arena_mode = 1;
+      }
       else if (!strncmp(argv[i], "-o", 3)) {
 	i++;
 	if (i < argc) {
@@ -416,6 +454,7 @@ int main(int argc, char* argv[])
   gedcom_init();
   setlocale(LC_ALL, "");
   gedcom_set_message_handler(gedcom_message_handler);
+  gom_set_arena_mode(arena_mode);
 
   output_open(outfilename);
   
@@ -48,9 +48,11 @@ struct convert {
   char*   unknown;
 };
 
+/* The buffers are not zeroed: the output of the conversions is always
+   terminated explicitly */
 static void reset_conv_buffer(conv_buffer_t buf)
 {
-  memset(buf->buffer, 0, buf->size);
+  buf->buffer[0] = '\0';
 }
 
 conv_buffer_t create_conv_buffer(int size)
@@ -92,13 +94,42 @@ static char* grow_conv_buffer(conv_buffer_t buf, char* curr_pos)
     buf->buffer = new_buffer;
     buf->size   = new_size;
     curr_pos    = buf->buffer + outlen;
-    memset(curr_pos, 0, buf->size - (curr_pos - buf->buffer));
     return curr_pos;
   }
   else
     return NULL;
 }
 
+/* Terminates the output of a conversion, which ends at outptr */
+static char* terminate_conv_buffer(conv_buffer_t buf, char* outptr,
+				   size_t outsize)
+{
+  if (outsize == 0) {
+    outptr = grow_conv_buffer(buf, outptr);
+    if (!outptr) {
+      errno = ENOMEM;
+      return NULL;
+    }
+  }
+  *outptr = '\0';
+  return buf->buffer;
+}
+
+char* fill_conv_buffer(conv_buffer_t buf, const char* input, size_t input_len)
+{
+  if (!buf || !input)
+    return NULL;
+  while (input_len + 1 > buf->size) {
+    if (!grow_conv_buffer(buf, buf->buffer)) {
+      errno = ENOMEM;
+      return NULL;
+    }
+  }
+  memcpy(buf->buffer, input, input_len);
+  buf->buffer[input_len] = '\0';
+  return buf->buffer;
+}
+
 convert_t initialize_utf8_conversion(const char* charset, int external_outbuf)
 {
   struct convert *conv = NULL;
@@ -220,7 +251,6 @@ char* convert_from_utf8(convert_t conv, const char* input, int* conv_fails,
   outbuf  = conv->outbuf;
   outptr  = outbuf->buffer;
   outsize = outbuf->size;
-  reset_conv_buffer(conv->outbuf);
   nconv = iconv(conv->from_utf8, &inptr, &insize, &outptr, &outsize);
   while (nconv == (size_t)-1) {
     if (errno == E2BIG) {
@@ -260,7 +290,7 @@ char* convert_from_utf8(convert_t conv, const char* input, int* conv_fails,
     nconv = iconv(conv->from_utf8, &inptr, &insize, &outptr, &outsize);
   }
   if (output_len) *output_len = outptr - outbuf->buffer;
-  return outbuf->buffer;
+  return terminate_conv_buffer(outbuf, outptr, outsize);
 }
 
 char* convert_to_utf8(convert_t conv, const char* input, size_t input_len)
@@ -279,7 +309,6 @@ char* convert_to_utf8(convert_t conv, const char* input, size_t input_len)
   outbuf  = conv->outbuf;
   outptr  = outbuf->buffer;
   outsize = outbuf->size;
-  reset_conv_buffer(conv->outbuf);
   nconv = iconv(conv->to_utf8, &inptr, &input_len, &outptr, &outsize);
   while (nconv == (size_t)-1) {
     if (errno == E2BIG) {
@@ -301,26 +330,28 @@ char* convert_to_utf8(convert_t conv, const char* input, size_t input_len)
     }
     nconv = iconv(conv->to_utf8, &inptr, &input_len, &outptr, &outsize);
   }
-  return outbuf->buffer;  
+  return terminate_conv_buffer(outbuf, outptr, outsize);
 }
 
 char* convert_to_utf8_incremental(convert_t conv,
 				  const char* input, size_t input_len)
 {
   size_t res;
-  struct conv_buffer* outbuf = conv->outbuf;
-  struct conv_buffer* inbuf  = conv->inbuf;
-  size_t outsize = outbuf->size;
-  char* wrptr = outbuf->buffer;
-  ICONV_CONST char* rdptr = (ICONV_CONST char*) inbuf->buffer;
-  char* retval = outbuf->buffer;
+  struct conv_buffer* outbuf;
+  struct conv_buffer* inbuf;
+  size_t outsize;
+  char* wrptr;
+  ICONV_CONST char* rdptr;
+  char* retval;
 
   if (!conv || !conv->outbuf)
     return NULL;
+
+  outbuf = conv->outbuf;
+  inbuf  = conv->inbuf;
   
   if (!input) {
     iconv(conv->to_utf8, NULL, NULL, NULL, NULL);
-    reset_conv_buffer(inbuf);
     conv->insize = 0;
     return NULL;
   }
@@ -332,11 +363,25 @@ char* convert_to_utf8_incremental(convert_t conv,
   memcpy(inbuf->buffer + conv->insize, input, input_len);
   conv->insize += input_len;
 
-  /* set up output buffer (empty it) */
-  reset_conv_buffer(outbuf);
+  /* set up output buffer (no need to empty it, the output is terminated
+     explicitly below) */
+  rdptr   = (ICONV_CONST char*) inbuf->buffer;
+  wrptr   = outbuf->buffer;
+  outsize = outbuf->size;
 
-  /* do the conversion */
+  /* do the conversion, growing the output buffer if needed (values can be
+     longer than a line in compatibility mode) */
   res = iconv(conv->to_utf8, &rdptr, &conv->insize, &wrptr, &outsize);
+  while (res == (size_t)-1 && errno == E2BIG) {
+    wrptr = grow_conv_buffer(outbuf, wrptr);
+    if (!wrptr) {
+      errno = ENOMEM;
+      return NULL;
+    }
+    outsize = outbuf->size - (wrptr - outbuf->buffer);
+    res = iconv(conv->to_utf8, &rdptr, &conv->insize, &wrptr, &outsize);
+  }
+  retval = outbuf->buffer;
   if (res == (size_t)-1) {
     if (errno == EILSEQ) {
       /* restart from an empty state and return NULL */
@@ -352,8 +397,13 @@ char* convert_to_utf8_incremental(convert_t conv,
     }
   }
 
+  /* terminate the output */
+  if (!terminate_conv_buffer(outbuf, wrptr, outsize))
+    return NULL;
+  if (retval)
+    retval = outbuf->buffer;
+
   /* then shift what is left over to the head of the input buffer */
   memmove(inbuf->buffer, rdptr, conv->insize);
-  memset(inbuf->buffer + conv->insize, 0, inbuf->size - conv->insize);
   return retval;
 }
@@ -113,3 +113,85 @@ char* nth_utf8_char(char* str, int n)
   }
   return str;
 }
+
+/* The input is tested a word at a time for bytes with the high bit set;
+   the word is loaded via memcpy, so that the input needn't be aligned */
+#define HIGH_BITS  (((unsigned long)-1 / 0xFF) * 0x80)
+
+size_t ascii_length(const char* str, size_t len)
+{
+  size_t i = 0;
+
+  if (!str) return 0;
+
+  while (i + sizeof(unsigned long) <= len) {
+    unsigned long word;
+    memcpy(&word, str + i, sizeof(word));
+    if (word & HIGH_BITS)
+      break;
+    i += sizeof(word);
+  }
+  while (i < len && (str[i] & 0x80) == 0)
+    i++;
+  return i;
+}
+
+/* Returns the length of the UTF-8 sequence starting at str (of which len
+   bytes are available), 0 if it is not valid, or -1 if it is valid but
+   incomplete.  Overlong forms, surrogates and values beyond U+10FFFF are
+   not valid */
+static int utf8_sequence_length(const unsigned char* str, size_t len)
+{
+  unsigned char c = str[0];
+  unsigned char min = 0x80, max = 0xBF;
+  int seq_len, i;
+
+  if (c < 0x80)
+    return 1;
+  else if (c >= 0xC2 && c <= 0xDF)
+    seq_len = 2;
+  else if (c >= 0xE0 && c <= 0xEF) {
+    seq_len = 3;
+    if (c == 0xE0) min = 0xA0;
+    if (c == 0xED) max = 0x9F;
+  }
+  else if (c >= 0xF0 && c <= 0xF4) {
+    seq_len = 4;
+    if (c == 0xF0) min = 0x90;
+    if (c == 0xF4) max = 0x8F;
+  }
+  else
+    return 0;
+
+  for (i = 1; i < seq_len; i++) {
+    if ((size_t)i >= len)
+      return -1;
+    if (str[i] < min || str[i] > max)
+      return 0;
+    min = 0x80;
+    max = 0xBF;
+  }
+  return seq_len;
+}
+
+size_t utf8_valid_length(const char* str, size_t len, int* incomplete)
+{
+  size_t i = 0;
+
+  if (incomplete) *incomplete = 0;
+  if (!str) return 0;
+
+  while (i < len) {
+    int seq_len;
+    i += ascii_length(str + i, len - i);
+    if (i == len)
+      break;
+    seq_len = utf8_sequence_length((const unsigned char*)str + i, len - i);
+    if (seq_len <= 0) {
+      if (incomplete) *incomplete = (seq_len < 0);
+      break;
+    }
+    i += seq_len;
+  }
+  return i;
+}
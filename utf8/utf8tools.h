@@ -41,6 +41,13 @@ int   utf8_strlen(const char* input);
   /* Returns 1 if string is valid UTF-8 string, 0 otherwise */
 int   is_utf8_string(const char* input);
 
+  /* Return the length of the part of the input (of len bytes) that is
+     respectively ASCII and valid UTF-8.  For the latter, incomplete (if
+     not NULL) is set to 1 if the rest of the input is an incomplete, but
+     so far valid, UTF-8 character */
+size_t ascii_length(const char* input, size_t len);
+size_t utf8_valid_length(const char* input, size_t len, int* incomplete);
+
   /* Returns respectively a pointer to the next or the nth UTF-8 character.
      The value n = 0 is the first character of the input, i.e.
      next_utf8_char(input) is the same as nth_utf8_char(input, 1) */
@@ -50,6 +57,9 @@ char* nth_utf8_char(char* input, int n);
   /* Functions for creating and freeing conversion buffers yourself */
 conv_buffer_t create_conv_buffer(int size);
 void free_conv_buffer(conv_buffer_t buf);
+  /* Copies input (which must already be in UTF-8) into the buffer, growing
+     it if needed; returns the (null-terminated) contents of the buffer */
+char* fill_conv_buffer(conv_buffer_t buf, const char* input, size_t input_len);
   
   /* General conversion interface (is bidirectional) */
   /* Pass 0 for external_outbuf unless you want to control the